@@ -7,17 +7,84 @@
             "src/main.cpp",
             "src/obs_interface.cpp",
             "src/utils.cpp",
+            "src/jpeg_writer.cpp",
+            "src/convert.cpp",
+            "src/slice_pool.cpp",
+            "src/audio_meter.cpp",
+            "src/arena.cpp",
+            "src/process_watcher.cpp",
+            "src/mp4_edit.cpp",
         ],
         'include_dirs': [
             "<!@(node -p \"require('node-addon-api').include\")",
             "include"
         ],
-        'libraries': [
-            "../bin/64bit/obs.lib"
+        'dependencies': [
+            "<!(node -p \"require('node-addon-api').gyp\")"
+        ],
+        'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+        'conditions': [
+            ['OS=="win"', {
+                'sources': [ "src/preview_window_win.cpp", "src/process_list_win.cpp" ],
+                'libraries': [ "../bin/64bit/obs.lib" ],
+            }],
+            # Headless build against the fake libobs, for CI and benchmarking.
+            ['OS=="linux"', {
+                'sources': [ "src/preview_window_headless.cpp", "src/process_list_headless.cpp" ],
+                'dependencies': [ "fake_libobs" ],
+            }],
+        ],
+    }, {
+        # Microbenchmarks for the conversion helpers in utils.cpp, arena.cpp,
+        # convert.cpp, slice_pool.cpp and audio_meter.cpp, see
+        # test/bench/native.js. Not shipped in dist.
+        "target_name": "noobs_bench",
+        "cflags!": [ "-fno-exceptions" ],
+        "cflags_cc!": [ "-fno-exceptions" ],
+        "sources": [
+            "src/utils.cpp",
+            "src/convert.cpp",
+            "src/slice_pool.cpp",
+            "src/audio_meter.cpp",
+            "src/arena.cpp",
+            "test/bench/native/bench_utils.cpp",
+        ],
+        'include_dirs': [
+            "<!@(node -p \"require('node-addon-api').include\")",
+            "include",
+            "src"
         ],
         'dependencies': [
             "<!(node -p \"require('node-addon-api').gyp\")"
         ],
         'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
-    }]
-}
\ No newline at end of file
+        'conditions': [
+            ['OS=="win"', {
+                'libraries': [ "../bin/64bit/obs.lib" ],
+            }],
+            ['OS=="linux"', {
+                'dependencies': [ "fake_libobs" ],
+            }],
+        ],
+    }],
+    'conditions': [
+        ['OS=="linux"', {
+            'targets': [{
+                "target_name": "fake_libobs",
+                "type": "static_library",
+                "cflags": [ "-fPIC" ],
+                "cflags!": [ "-fno-exceptions" ],
+                "cflags_cc!": [ "-fno-exceptions" ],
+                "sources": [
+                    "test/fake-libobs/base.cpp",
+                    "test/fake-libobs/core.cpp",
+                    "test/fake-libobs/data.cpp",
+                    "test/fake-libobs/mp4.cpp",
+                    "test/fake-libobs/outputs.cpp",
+                    "test/fake-libobs/sources.cpp",
+                ],
+                'include_dirs': [ "include" ],
+            }],
+        }],
+    ],
+}
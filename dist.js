@@ -19,6 +19,12 @@ const addonSrc = path.resolve(__dirname, 'build', 'Release', packageName);
 const addonDest = path.join(distRoot, packageName);
 fs.copyFileSync(addonSrc, addonDest);
 
+// The headless build links the fake libobs statically, there is nothing
+// else to ship.
+if (process.platform !== 'win32') {
+  process.exit(0);
+}
+
 // Now copy the .dll files we need.
 const binSrc = path.resolve(__dirname, 'bin', '64bit');
 const binDst = path.resolve(__dirname, 'dist', 'bin');
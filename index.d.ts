@@ -136,12 +136,40 @@ export type ObsProperty =
   | ObsGenericProperty;
 
 export type Signal = {
-  type: string; // Either "output" or "volmeter" or "source".
+  type: string; // Either "output", "volmeter", "source", "preview", "snapshot" or "capture".
   id: string; // Signal identifier, e.g. "stop"
   code: number; // 0 for success, other values for errors
   value?: number; // Currently only used for volmeters.
 };
 
+export type CaptureRule = {
+  exe: string; // Executable to watch for, case insensitive, e.g. "WowClassic.exe".
+  source: string; // Game or window capture source to point at its window.
+};
+
+export type AudioLevels = {
+  peak: number[]; // Sample peak per channel in dBFS, the highest since the last call.
+  truePeak: number[]; // 4x oversampled peak per channel in dBTP, the highest since the last call.
+  rms: number[]; // RMS per channel in dBFS since the last call.
+  loudness: number; // Short-term loudness in LUFS over the last 3 seconds, -Infinity when silent.
+};
+
+export type MemoryCounter = {
+  live: number; // Allocated and not yet freed.
+  total: number; // Ever allocated.
+};
+
+export type MemoryStats = {
+  libobsAllocs: number; // Live libobs allocations, from bnum_allocs.
+  residentBytes: number;
+  peakResidentBytes: number;
+  virtualBytes: number;
+  replayBufferBytes: number; // Estimated bytes held by the replay buffer, 0 when not buffering.
+  signals: MemoryCounter; // Signals queued for the JS callback.
+  conversions: MemoryCounter; // Temporaries created converting settings, live should stay at 0.
+  registry: Record<string, number>; // Entries in each source map, e.g. sources, filters, volmeters.
+};
+
 export type SceneItemPosition = {
   x: number; // X position in pixels
   y: number; // Y position in pixels
@@ -153,6 +181,25 @@ export type SceneItemPosition = {
   cropBottom: number; // Pixels to crop from the bottom
 };
 
+export type SceneTransforms = {
+  names: string[]; // Source names, in draw order.
+  transforms: Float64Array; // 10 doubles per name, laid out as for GetSourceTransform.
+};
+
+export type SceneSnapshot = SceneTransforms & {
+  version: number; // Goes up when an item is added, removed, moved or resized.
+  visible: Uint8Array; // 1 per visible item.
+};
+
+export type ScaleType = 'point' | 'bilinear' | 'bicubic' | 'lanczos' | 'area';
+
+export type VideoContextOptions = {
+  fpsDen?: number; // FPS denominator, e.g. ResetVideoContext(60000, ...) with fpsDen 1001 for 59.94. Defaults to 1.
+  outputWidth?: number; // Encoded width, defaults to the base width.
+  outputHeight?: number; // Encoded height, defaults to the base height.
+  scaleType?: ScaleType; // Filter used to scale from base to output size. Defaults to bilinear.
+};
+
 export type SourceDimensions = {
   height: number; // Height in pixels, before scaling
   width: number; // Width in pixels, before scaling
@@ -170,16 +217,27 @@ interface Noobs {
   // Recording functions.
   SetBuffering(buffering: boolean): void; // In buffering mode, the recording is stored in memory and can be converted to a file later.
   StartBuffer(): void;
-  StartRecording(offset: number): void;
+  StartRecording(offset?: number, exact?: boolean): void; // Offset is in seconds, fractions allowed. Exact starts playback at the offset rather than the keyframe before it, using an edit list.
   StopRecording(): void;
   ForceStopRecording(): void;
   GetLastRecording(): string;
+  AddMarker(label: string): number | null; // Mark the current point of the recording, returns the seconds into the file or null if not recording. Written as MP4 chapters and a "-markers.json" sidecar when it stops.
   SetRecordingDir(recordingPath: string): void;
-  ResetVideoContext(fps: number, width: number, height: number): void;
+  ResetVideoContext(fps: number, width: number, height: number, options?: VideoContextOptions): void; // Width and height are the base canvas size.
+  ResetAudioContext(sampleRate: number, channels: number): void; // 44100 or 48000, 1 to 8 channels. Audio sources must be deleted first.
 
   // Encoder functions.
   ListVideoEncoders(): string[]; // Returns a list of available video encoders.
   SetVideoEncoder(id: string, settings: ObsData): void; // Create the video encoder to use.
+  SetKeyframeInterval(bufferingSec: number, recordingSec: number): void; // Keyframe spacing in each mode, set in whichever key the encoder uses and overriding its settings. Whole seconds up to 20, 0 leaves it to the settings. Defaults to 1 and 2.
+  ListAudioEncoders(): string[]; // Returns a list of available audio encoders.
+  SetAudioEncoder(id: string, settings: ObsData): void; // Set the audio encoder used for every track, e.g. ffmpeg_opus.
+  SetProxyEncoder(id: string, settings: ObsData, width: number, height: number): void; // Also write a scaled proxy file on each recording. Starts from the StartRecording call, ignoring any offset.
+  ClearProxyEncoder(): void; // Stop writing proxy files.
+  GetLastProxyRecording(): string; // Returns the last proxy file path.
+  SetSnapshotInterval(seconds: number, width?: number, height?: number): void; // JPEG poster frames at the start and every interval of a recording, 0 disables. Defaults to 480x270.
+  GetLastSnapshots(): string[]; // Snapshot files written for the last recording.
+  GetMemoryStats(): MemoryStats; // Cheap enough to poll, for spotting leaks over long sessions.
 
   // Source management functions.
   CreateSource(name: string, type: string): string; // Returns the name of the source, which may vary in the event of a name conflict.
@@ -187,28 +245,52 @@ interface Noobs {
   GetSourceSettings(name: string): ObsData;
   SetSourceSettings(name: string, settings: ObsData): void;
   GetSourceProperties(name: string): ObsProperty[];
+  SetLazySources(enabled: boolean): void; // Defer creating new video sources until they're added to a scene or prewarmed. Audio sources are never deferred.
+  Prewarm(name: string): void; // Create a deferred source ahead of adding it to a scene.
+  SetCaptureRules(rules: CaptureRule[], intervalMs?: number): void; // Watch for processes natively, default every 2000ms, and retarget capture sources when one starts. Signals "capture" with the source name, code 1 when the source hooks and 0 when it unhooks. An empty array stops watching.
 
   // Audio source management functions.
   SetMuteAudioInputs(mute: boolean): void; // Mute or unmute all audio inputs.
   SetSourceVolume(name: string, volume: number): void; // Set the volume for a specific audio source (0.0 to 1.0).
+  SetSourceAudioTrack(name: string, track: number): void; // Assign an audio source to a track (0 to 5) in the output file. Sources start on track 0.
   SetVolmeterEnabled(enabled: boolean): void; // Enable or disable the volume meter.
+  GetAudioLevels(name: string): AudioLevels | null; // Levels before the source volume, null if not an audio source.
   SetAudioSuppression(enabled: boolean): void; // Enable or disable audio suppression (noise gate).
   SetForceMono(enabled: boolean): void; // Enable or disable the force mono audio setting.
 
-  // Scene management functions.
+  // Scene management functions. Item calls act on the selected scene, "Base Scene" to start with.
+  CreateScene(name: string): void; // Sources in every scene keep capturing, so switching to one is instant. Throws if a source, deferred or not, has the name.
+  DeleteScene(name: string): void; // Deleting the selected scene selects "Base Scene", which can't be deleted.
+  SelectScene(name: string): void; // Switch what's output from the next frame, recordings carry on.
+  ListScenes(): string[];
+  GetCurrentScene(): string;
   AddSourceToScene(sourceName: string): void;
   RemoveSourceFromScene(sourceName: string): void;
   GetSourcePos(name: string): SceneItemPosition & SourceDimensions;
   SetSourcePos(name: string, pos: SceneItemPosition): void;
 
+  // Typed array versions for pointer move rate callers, nothing is allocated per call. Each
+  // source is 10 doubles: x, y, scaleX, scaleY, cropLeft, cropRight, cropTop, cropBottom,
+  // width, height. Setting reads the first 8.
+  GetSourceTransform(name: string, target: Float64Array): boolean; // False if the source is not in the scene.
+  SetSourceTransform(name: string, values: Float64Array): void;
+  GetSceneTransforms(target?: Float64Array): SceneTransforms; // Every scene item in draw order, into target if it's big enough.
+  GetSceneSnapshot(sinceVersion?: number): SceneSnapshot | null; // Null if the scene is still at sinceVersion.
+
   // Preview functions.
   InitPreview(hwnd: Buffer): void;
-  ConfigurePreview(x: number, y: number, width: number, height: number): void;
+  ConfigurePreview(x: number, y: number, width: number, height: number, fps?: number | 'auto'): void; // fps caps the preview draw rate, 0 is uncapped, 'auto' backs off when frames lag.
   ShowPreview(): void;
   HidePreview(): void;
   DisablePreview(): void;
   GetPreviewInfo(): { canvasWidth: number; canvasHeight: number; previewWidth: number; previewHeight: number };
   SetDrawSourceOutline(enabled: boolean): void;
+
+  // Windowless preview, frames are RGBA at the requested (even) size. Every divisor'th
+  // canvas frame is delivered and signalled as { type: 'preview', id: 'frame', code: seq }.
+  StartFramePreview(width: number, height: number, divisor?: number): void;
+  StopFramePreview(): void;
+  ReadFramePreview(target: Uint8Array | Uint8ClampedArray, lastSeq?: number): number; // Copies the frame if newer than lastSeq, returns its sequence number.
   GetDrawSourceOutlineEnabled(): boolean;
 }
 
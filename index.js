@@ -1,7 +1,9 @@
 const path = require('path');
 
-process.env.Path += ';';
-process.env.Path += path.resolve(__dirname, 'dist', 'bin').replace('app.asar', 'app.asar.unpacked');
+if (process.platform === 'win32') {
+  process.env.Path += ';';
+  process.env.Path += path.resolve(__dirname, 'dist', 'bin').replace('app.asar', 'app.asar.unpacked');
+}
 
 const packageName = 'noobs.node';
 const noobs = require(`./dist/${packageName}`);
@@ -0,0 +1,73 @@
+#include "arena.h"
+#include <algorithm>
+
+#define ARENA_BLOCK_SIZE 4096 // Plenty for a source name and a settings object.
+
+void* Arena::alloc(size_t size, size_t align) {
+  while (true) {
+    if (block < blocks.size()) {
+      Block& current = blocks[block];
+      size_t start = (used + align - 1) & ~(align - 1);
+
+      if (start + size <= current.size) {
+        used = start + size;
+        return current.data.get() + start;
+      }
+    }
+
+    // Move on to the next block, replacing it if it's too small. Blocks
+    // come from new[] so are aligned for anything up to max_align_t.
+    size_t next = blocks.empty() ? 0 : block + 1;
+
+    if (next == blocks.size()) {
+      size_t block_size = std::max<size_t>(ARENA_BLOCK_SIZE, size);
+      blocks.push_back({ std::unique_ptr<char[]>(new char[block_size]), block_size });
+    } else if (blocks[next].size < size) {
+      blocks[next] = { std::unique_ptr<char[]>(new char[size]), size };
+    }
+
+    block = next;
+    used = 0;
+  }
+}
+
+Arena::Mark Arena::mark() const {
+  return { block, used };
+}
+
+void Arena::reset(Mark mark) {
+  block = mark.block;
+  used = mark.used;
+}
+
+size_t Arena::capacity() const {
+  size_t total = 0;
+
+  for (const Block& b : blocks)
+    total += b.size;
+
+  return total;
+}
+
+Arena& call_arena() {
+  static thread_local Arena arena;
+  return arena;
+}
+
+ArenaScope::ArenaScope() : arena(call_arena()), start(arena.mark()) {}
+
+ArenaScope::~ArenaScope() {
+  arena.reset(start);
+}
+
+std::string_view arena_utf8(Napi::Value value) {
+  napi_env env = value.Env();
+  size_t length = 0;
+
+  if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok)
+    return "";
+
+  char* buffer = static_cast<char*>(call_arena().alloc(length + 1, 1));
+  napi_get_value_string_utf8(env, value, buffer, length + 1, &length);
+  return std::string_view(buffer, length);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <napi.h>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for temporaries that only live as long as a binding call,
+// like the UTF-8 copies of JS strings we pass on to libobs. Blocks are kept
+// when it's reset, so once warmed up a call makes no heap allocations.
+class Arena {
+  public:
+    struct Mark {
+      size_t block;
+      size_t used;
+    };
+
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+    Mark mark() const;
+    void reset(Mark mark); // Free everything allocated since mark was taken.
+    size_t capacity() const; // Bytes held across all blocks.
+
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data;
+      size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block = 0; // Index of the block being filled.
+    size_t used = 0; // Bytes used in it.
+};
+
+Arena& call_arena(); // The calling thread's arena, in practice the JS thread's.
+
+// Resets the arena to where it was when the scope opened. Bindings open one
+// before touching the arena, nested scopes only free their own allocations.
+class ArenaScope {
+  public:
+    ArenaScope();
+    ~ArenaScope();
+
+  private:
+    Arena& arena;
+    Arena::Mark start;
+};
+
+// Copy a JS string into the arena, null terminated so data() can go straight
+// to libobs. Valid until the enclosing ArenaScope closes, empty if value is
+// not a string.
+std::string_view arena_utf8(Napi::Value value);
@@ -0,0 +1,312 @@
+#include "audio_meter.h"
+#include "convert.h"
+#include <media-io/audio-math.h>
+#include <util/simde/x86/sse2.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define LOUDNESS_BLOCKS 30 // 100ms blocks in the 3 second short-term window.
+
+// The 48 tap interpolation filter, a windowed sinc cut off at the original
+// Nyquist rate. Stored by tap then phase, so one vector multiply gives a tap's
+// contribution to all four oversampled outputs.
+struct TruePeakFilter {
+  alignas(16) float coef[METER_TP_TAPS][METER_TP_PHASES];
+
+  TruePeakFilter() {
+    const int length = METER_TP_TAPS * METER_TP_PHASES;
+    const double centre = (length - 1) / 2.0;
+    double h[length];
+    double sum = 0;
+
+    for (int m = 0; m < length; m++) {
+      double t = (m - centre) / METER_TP_PHASES;
+      double sinc = t == 0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+      double blackman = 0.42 - 0.5 * cos(2 * M_PI * (m + 0.5) / length) + 0.08 * cos(4 * M_PI * (m + 0.5) / length);
+      h[m] = sinc * blackman;
+      sum += h[m];
+    }
+
+    // Unity gain at DC for each phase, zero stuffing loses a factor of 4.
+    for (int k = 0; k < METER_TP_TAPS; k++)
+      for (int p = 0; p < METER_TP_PHASES; p++)
+        coef[k][p] = (float)(h[k * METER_TP_PHASES + p] * METER_TP_PHASES / sum);
+  }
+};
+
+static const TruePeakFilter& true_peak_filter() {
+  static const TruePeakFilter filter;
+  return filter;
+}
+
+void meter_peak_sumsq_scalar(const float* samples, uint32_t count, float* peak, float* sumsq) {
+  float p = 0, s = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    p = std::max(p, fabsf(samples[i]));
+    s += samples[i] * samples[i];
+  }
+
+  *peak = p;
+  *sumsq = s;
+}
+
+void meter_peak_sumsq_sse2(const float* samples, uint32_t count, float* peak, float* sumsq) {
+  const simde__m128 abs_mask = simde_mm_castsi128_ps(simde_mm_set1_epi32(0x7FFFFFFF));
+  simde__m128 p = simde_mm_setzero_ps();
+  simde__m128 s = simde_mm_setzero_ps();
+  uint32_t simd_count = count & ~3u;
+
+  for (uint32_t i = 0; i < simd_count; i += 4) {
+    simde__m128 x = simde_mm_loadu_ps(samples + i);
+    p = simde_mm_max_ps(p, simde_mm_and_ps(x, abs_mask));
+    s = simde_mm_add_ps(s, simde_mm_mul_ps(x, x));
+  }
+
+  alignas(16) float lanes_p[4], lanes_s[4];
+  simde_mm_store_ps(lanes_p, p);
+  simde_mm_store_ps(lanes_s, s);
+
+  float tail_p, tail_s;
+  meter_peak_sumsq_scalar(samples + simd_count, count - simd_count, &tail_p, &tail_s);
+
+  *peak = std::max({ lanes_p[0], lanes_p[1], lanes_p[2], lanes_p[3], tail_p });
+  *sumsq = (lanes_s[0] + lanes_s[1]) + (lanes_s[2] + lanes_s[3]) + tail_s;
+}
+
+float meter_true_peak_scalar(const float* samples, uint32_t count) {
+  const TruePeakFilter& filter = true_peak_filter();
+  float peak = 0;
+
+  for (uint32_t n = 0; n < count; n++) {
+    const float* newest = samples + n + METER_TP_TAPS - 1;
+
+    for (int p = 0; p < METER_TP_PHASES; p++) {
+      float y = 0;
+
+      for (int k = 0; k < METER_TP_TAPS; k++)
+        y += newest[-k] * filter.coef[k][p];
+
+      peak = std::max(peak, fabsf(y));
+    }
+  }
+
+  return peak;
+}
+
+// All four phases of one input sample per iteration, each lane summing its
+// taps in the same order as the scalar loop.
+float meter_true_peak_sse2(const float* samples, uint32_t count) {
+  const TruePeakFilter& filter = true_peak_filter();
+  const simde__m128 abs_mask = simde_mm_castsi128_ps(simde_mm_set1_epi32(0x7FFFFFFF));
+  simde__m128 coef[METER_TP_TAPS];
+  simde__m128 peak = simde_mm_setzero_ps();
+
+  for (int k = 0; k < METER_TP_TAPS; k++)
+    coef[k] = simde_mm_load_ps(filter.coef[k]);
+
+  for (uint32_t n = 0; n < count; n++) {
+    const float* newest = samples + n + METER_TP_TAPS - 1;
+    simde__m128 y = simde_mm_setzero_ps();
+
+    for (int k = 0; k < METER_TP_TAPS; k++)
+      y = simde_mm_add_ps(y, simde_mm_mul_ps(simde_mm_set1_ps(newest[-k]), coef[k]));
+
+    peak = simde_mm_max_ps(peak, simde_mm_and_ps(y, abs_mask));
+  }
+
+  alignas(16) float lanes[4];
+  simde_mm_store_ps(lanes, peak);
+  return std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+}
+
+struct MeterKernel {
+  void (*peak_sumsq)(const float*, uint32_t, float*, float*);
+  float (*true_peak)(const float*, uint32_t);
+  const char* name;
+};
+
+static const MeterKernel& meter_kernel() {
+  static const MeterKernel kernel = cpu_has_sse2()
+    ? MeterKernel{ meter_peak_sumsq_sse2, meter_true_peak_sse2, "sse2" }
+    : MeterKernel{ meter_peak_sumsq_scalar, meter_true_peak_scalar, "scalar" };
+
+  return kernel;
+}
+
+void meter_peak_sumsq(const float* samples, uint32_t count, float* peak, float* sumsq) {
+  meter_kernel().peak_sumsq(samples, count, peak, sumsq);
+}
+
+float meter_true_peak(const float* samples, uint32_t count) {
+  return meter_kernel().true_peak(samples, count);
+}
+
+const char* audio_meter_kernel() {
+  return meter_kernel().name;
+}
+
+// BS.1770 channel weights for the libobs speaker layouts, which order
+// channels FL, FR, FC, LFE, then the rears and sides. The LFE is ignored and
+// surrounds count for about 1.5 dB more.
+static double loudness_weight(uint32_t channels, uint32_t c) {
+  switch (channels) {
+    case 3: return c == 2 ? 0.0 : 1.0; // 2.1
+    case 4: return c == 3 ? 1.41 : 1.0; // 4.0, FL FR FC RC.
+    case 5: return c == 3 ? 0.0 : (c == 4 ? 1.41 : 1.0); // 4.1
+    case 6:
+    case 8: return c == 3 ? 0.0 : (c >= 4 ? 1.41 : 1.0); // 5.1 and 7.1
+    default: return 1.0;
+  }
+}
+
+AudioMeter::AudioMeter(uint32_t sample_rate, uint32_t channels)
+  : chans(channels), block_frames(sample_rate / 10), blocks(LOUDNESS_BLOCKS, 0.0) {
+  for (uint32_t c = 0; c < channels; c++) {
+    chans[c].history.assign(METER_TP_TAPS - 1, 0.0f);
+    chans[c].weight = loudness_weight(channels, c);
+  }
+
+  // K-weighting for any sample rate, the high shelf then the high pass of
+  // BS.1770, derived the same way as libebur128.
+  double f0 = 1681.974450955533;
+  double gain = 3.999843853973347;
+  double q = 0.7071752369554196;
+  double k = tan(M_PI * f0 / sample_rate);
+  double vh = pow(10.0, gain / 20.0);
+  double vb = pow(vh, 0.4996667741545416);
+  double a0 = 1.0 + k / q + k * k;
+
+  pre_filter.b0 = (vh + vb * k / q + k * k) / a0;
+  pre_filter.b1 = 2.0 * (k * k - vh) / a0;
+  pre_filter.b2 = (vh - vb * k / q + k * k) / a0;
+  pre_filter.a1 = 2.0 * (k * k - 1.0) / a0;
+  pre_filter.a2 = (1.0 - k / q + k * k) / a0;
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = tan(M_PI * f0 / sample_rate);
+  a0 = 1.0 + k / q + k * k;
+
+  rlb_filter.b0 = 1.0;
+  rlb_filter.b1 = -2.0;
+  rlb_filter.b2 = 1.0;
+  rlb_filter.a1 = 2.0 * (k * k - 1.0) / a0;
+  rlb_filter.a2 = (1.0 - k / q + k * k) / a0;
+}
+
+uint32_t AudioMeter::channels() const {
+  return (uint32_t)chans.size();
+}
+
+void AudioMeter::process(const float* const planes[], uint32_t frames, bool muted) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (muted && silence.size() < frames)
+    silence.resize(frames, 0.0f);
+
+  for (uint32_t c = 0; c < chans.size(); c++) {
+    Channel& chan = chans[c];
+    const float* samples = muted ? silence.data() : planes[c];
+
+    float peak, sumsq;
+    meter_peak_sumsq(samples, frames, &peak, &sumsq);
+    chan.peak = std::max(chan.peak, peak);
+    chan.sumsq += sumsq;
+
+    // Keep the tail of the last block in front of this one so the
+    // interpolation filter runs across the join.
+    chan.history.resize(METER_TP_TAPS - 1 + frames);
+    memcpy(chan.history.data() + METER_TP_TAPS - 1, samples, frames * sizeof(float));
+    chan.true_peak = std::max(chan.true_peak, meter_true_peak(chan.history.data(), frames));
+    memmove(chan.history.data(), chan.history.data() + frames, (METER_TP_TAPS - 1) * sizeof(float));
+  }
+
+  // The K-weighting filters are recursive so stay scalar, but are cheap
+  // next to the true peak filter.
+  for (uint32_t offset = 0; offset < frames;) {
+    uint32_t count = std::min(frames - offset, block_frames - block_pos);
+
+    for (uint32_t c = 0; c < chans.size(); c++) {
+      const float* samples = muted ? silence.data() : planes[c];
+      process_channel(chans[c], samples + offset, count);
+    }
+
+    offset += count;
+    block_pos += count;
+
+    if (block_pos == block_frames)
+      close_block();
+  }
+
+  frames_read += frames;
+}
+
+void AudioMeter::process_channel(Channel& chan, const float* samples, uint32_t frames) {
+  const Biquad& f1 = pre_filter;
+  const Biquad& f2 = rlb_filter;
+  double sum = 0;
+
+  for (uint32_t i = 0; i < frames; i++) {
+    double x = samples[i];
+    double y1 = f1.b0 * x + chan.pre[0];
+    chan.pre[0] = f1.b1 * x - f1.a1 * y1 + chan.pre[1];
+    chan.pre[1] = f1.b2 * x - f1.a2 * y1;
+
+    double y2 = f2.b0 * y1 + chan.rlb[0];
+    chan.rlb[0] = f2.b1 * y1 - f2.a1 * y2 + chan.rlb[1];
+    chan.rlb[1] = f2.b2 * y1 - f2.a2 * y2;
+
+    sum += y2 * y2;
+  }
+
+  chan.block_sumsq += sum;
+}
+
+void AudioMeter::close_block() {
+  double energy = 0;
+
+  for (Channel& chan : chans) {
+    energy += chan.weight * chan.block_sumsq / block_frames;
+    chan.block_sumsq = 0;
+  }
+
+  blocks[block_next] = energy;
+  block_next = (block_next + 1) % LOUDNESS_BLOCKS;
+  block_count = std::min<size_t>(block_count + 1, LOUDNESS_BLOCKS);
+  block_pos = 0;
+}
+
+MeterLevels AudioMeter::read() {
+  std::lock_guard<std::mutex> lock(mutex);
+  MeterLevels levels;
+
+  for (Channel& chan : chans) {
+    float rms = frames_read ? (float)sqrt(chan.sumsq / frames_read) : 0.0f;
+    levels.peak.push_back(mul_to_db(chan.peak));
+    levels.truePeak.push_back(mul_to_db(chan.true_peak));
+    levels.rms.push_back(mul_to_db(rms));
+
+    chan.peak = 0;
+    chan.true_peak = 0;
+    chan.sumsq = 0;
+  }
+
+  frames_read = 0;
+
+  // 10 log10 of the mean energy, mul_to_db works in amplitude.
+  double energy = 0;
+
+  for (size_t i = 0; i < block_count; i++)
+    energy += blocks[i];
+
+  energy = block_count ? energy / block_count : 0.0;
+  levels.loudness = -0.691f + mul_to_db((float)sqrt(energy));
+
+  return levels;
+}
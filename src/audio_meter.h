@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Metering over the planar float audio libobs hands to audio capture
+// callbacks. The volmeter only gives us a sample peak and magnitude per
+// channel, this adds RMS, true peak (BS.1770 style 4x oversampling) and
+// short-term loudness (K-weighted, 3 second window, no gating).
+
+#define METER_TP_PHASES 4
+#define METER_TP_TAPS 12 // Per phase, so a 48 tap interpolation filter.
+
+// The per channel kernels. Like convert.h the vector versions are exposed
+// for the correctness checks and benchmarks, meter_* picks one on first use.
+void meter_peak_sumsq(const float* samples, uint32_t count, float* peak, float* sumsq);
+void meter_peak_sumsq_scalar(const float* samples, uint32_t count, float* peak, float* sumsq);
+void meter_peak_sumsq_sse2(const float* samples, uint32_t count, float* peak, float* sumsq);
+
+// Largest absolute value of the 4x oversampled signal. samples holds
+// METER_TP_TAPS - 1 samples of history followed by count new ones.
+float meter_true_peak(const float* samples, uint32_t count);
+float meter_true_peak_scalar(const float* samples, uint32_t count);
+float meter_true_peak_sse2(const float* samples, uint32_t count);
+
+const char* audio_meter_kernel(); // Name of the implementation meter_* uses.
+
+struct MeterLevels {
+  std::vector<float> peak; // dBFS per channel, the highest since the last read.
+  std::vector<float> truePeak; // dBTP per channel, the highest since the last read.
+  std::vector<float> rms; // dBFS per channel, over everything since the last read.
+  float loudness; // Short-term LUFS over the last 3 seconds.
+};
+
+class AudioMeter {
+  public:
+    AudioMeter(uint32_t sample_rate, uint32_t channels);
+
+    // From the audio thread. Muted audio is metered as silence, like it is
+    // recorded. The data is from before the source's volume is applied.
+    void process(const float* const planes[], uint32_t frames, bool muted);
+
+    MeterLevels read(); // Resets the peaks and RMS.
+    uint32_t channels() const;
+
+  private:
+    struct Biquad {
+      double b0, b1, b2, a1, a2;
+    };
+
+    struct Channel {
+      float peak = 0;
+      float true_peak = 0;
+      double sumsq = 0;
+      std::vector<float> history; // METER_TP_TAPS - 1 samples, then the current block.
+      double pre[2] = {}; // Direct form II transposed state of each K-weighting stage.
+      double rlb[2] = {};
+      double block_sumsq = 0; // K-weighted, for the current 100ms block.
+      double weight = 1.0;
+    };
+
+    std::mutex mutex;
+    std::vector<Channel> chans;
+    Biquad pre_filter, rlb_filter;
+    uint64_t frames_read = 0; // Frames since the last read, for RMS.
+    uint32_t block_frames; // 100ms at the sample rate.
+    uint32_t block_pos = 0;
+    std::vector<double> blocks; // Ring of the last 30 block energies.
+    size_t block_next = 0;
+    size_t block_count = 0;
+    std::vector<float> silence;
+
+    void process_channel(Channel& chan, const float* samples, uint32_t frames);
+    void close_block();
+};
@@ -0,0 +1,143 @@
+#include "convert.h"
+#include <util/simde/x86/sse2.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CONVERT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// BT.709 full range coefficients in 4.12 fixed point. The scalar and SSE2
+// paths use the same integer maths so they produce identical output.
+#define K_RV 6450  // 1.5748
+#define K_GU -767  // -0.1873
+#define K_GV -1917 // -0.4681
+#define K_BU 7601  // 1.8556
+#define K_SHIFT 12
+#define K_ROUND (1 << (K_SHIFT - 1))
+
+static inline uint8_t clamp_u8(int32_t v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+static inline void yuv_to_rgba(int32_t y, int32_t u, int32_t v, uint8_t* out) {
+  int32_t base = (y << K_SHIFT) + K_ROUND;
+  out[0] = clamp_u8((base + K_RV * v) >> K_SHIFT);
+  out[1] = clamp_u8((base + K_GU * u + K_GV * v) >> K_SHIFT);
+  out[2] = clamp_u8((base + K_BU * u) >> K_SHIFT);
+  out[3] = 255;
+}
+
+static void nv12_row_scalar(const uint8_t* y_row, const uint8_t* uv_row, uint32_t x, uint32_t width, uint8_t* out) {
+  for (; x < width; x++) {
+    const uint8_t* uv = uv_row + (x / 2) * 2;
+    yuv_to_rgba(y_row[x], uv[0] - 128, uv[1] - 128, out + x * 4);
+  }
+}
+
+void nv12_to_rgba_scalar(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                         uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize) {
+  for (uint32_t y = start_y; y < end_y; y++) {
+    const uint8_t* y_row = input[0] + (size_t)y * in_linesize[0];
+    const uint8_t* uv_row = input[1] + (size_t)(y / 2) * in_linesize[1];
+    nv12_row_scalar(y_row, uv_row, 0, width, output + (size_t)y * out_linesize);
+  }
+}
+
+// Eight pixels at a time. Each pixel gets a 32 bit lane holding its (u, v)
+// pair, so one madd per channel does both chroma multiplies.
+void nv12_to_rgba_sse2(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                       uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize) {
+  const simde__m128i zero = simde_mm_setzero_si128();
+  const simde__m128i alpha = simde_mm_set1_epi8((char)0xFF);
+  const simde__m128i bias = simde_mm_set1_epi16(128);
+  const simde__m128i round = simde_mm_set1_epi32(K_ROUND);
+  const simde__m128i k_r = simde_mm_set1_epi32((int32_t)((uint32_t)(uint16_t)K_RV << 16)); // (0, rv)
+  const simde__m128i k_g = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)K_GV << 16) | (uint16_t)K_GU));
+  const simde__m128i k_b = simde_mm_set1_epi32((int32_t)(uint16_t)K_BU); // (bu, 0)
+
+  uint32_t simd_width = width & ~7u;
+
+  for (uint32_t y = start_y; y < end_y; y++) {
+    const uint8_t* y_row = input[0] + (size_t)y * in_linesize[0];
+    const uint8_t* uv_row = input[1] + (size_t)(y / 2) * in_linesize[1];
+    uint8_t* out = output + (size_t)y * out_linesize;
+
+    for (uint32_t x = 0; x < simd_width; x += 8) {
+      simde__m128i luma = simde_mm_unpacklo_epi8(simde_mm_loadl_epi64((const simde__m128i*)(y_row + x)), zero);
+      simde__m128i chroma = simde_mm_unpacklo_epi8(simde_mm_loadl_epi64((const simde__m128i*)(uv_row + x)), zero);
+      chroma = simde_mm_sub_epi16(chroma, bias);
+
+      simde__m128i uv_lo = simde_mm_unpacklo_epi32(chroma, chroma); // Pixels 0-3.
+      simde__m128i uv_hi = simde_mm_unpackhi_epi32(chroma, chroma); // Pixels 4-7.
+
+      simde__m128i y_lo = simde_mm_add_epi32(simde_mm_slli_epi32(simde_mm_unpacklo_epi16(luma, zero), K_SHIFT), round);
+      simde__m128i y_hi = simde_mm_add_epi32(simde_mm_slli_epi32(simde_mm_unpackhi_epi16(luma, zero), K_SHIFT), round);
+
+#define CHANNEL(k)                                                                                         \
+  simde_mm_packs_epi32(                                                                                    \
+    simde_mm_srai_epi32(simde_mm_add_epi32(y_lo, simde_mm_madd_epi16(uv_lo, k)), K_SHIFT),                 \
+    simde_mm_srai_epi32(simde_mm_add_epi32(y_hi, simde_mm_madd_epi16(uv_hi, k)), K_SHIFT))
+
+      simde__m128i r = CHANNEL(k_r);
+      simde__m128i g = CHANNEL(k_g);
+      simde__m128i b = CHANNEL(k_b);
+
+#undef CHANNEL
+
+      r = simde_mm_packus_epi16(r, r);
+      g = simde_mm_packus_epi16(g, g);
+      b = simde_mm_packus_epi16(b, b);
+
+      simde__m128i rg = simde_mm_unpacklo_epi8(r, g);
+      simde__m128i ba = simde_mm_unpacklo_epi8(b, alpha);
+
+      simde_mm_storeu_si128((simde__m128i*)(out + x * 4), simde_mm_unpacklo_epi16(rg, ba));
+      simde_mm_storeu_si128((simde__m128i*)(out + x * 4 + 16), simde_mm_unpackhi_epi16(rg, ba));
+    }
+
+    nv12_row_scalar(y_row, uv_row, simd_width, width, out);
+  }
+}
+
+bool cpu_has_sse2() {
+#ifdef CONVERT_X86
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2);
+#endif
+#else
+  return false;
+#endif
+}
+
+typedef void (*nv12_to_rgba_fn)(const uint8_t* const[], const uint32_t[], uint32_t, uint32_t, uint32_t, uint8_t*, uint32_t);
+
+struct Nv12Kernel {
+  nv12_to_rgba_fn fn;
+  const char* name;
+};
+
+static const Nv12Kernel& nv12_kernel() {
+  static const Nv12Kernel kernel = cpu_has_sse2()
+    ? Nv12Kernel{ nv12_to_rgba_sse2, "sse2" }
+    : Nv12Kernel{ nv12_to_rgba_scalar, "scalar" };
+
+  return kernel;
+}
+
+void nv12_to_rgba(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                  uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize) {
+  nv12_kernel().fn(input, in_linesize, width, start_y, end_y, output, out_linesize);
+}
+
+const char* nv12_to_rgba_kernel() {
+  return nv12_kernel().name;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// Pixel format conversions for frames we receive from raw video callbacks.
+// Like libobs' format-conversion.h they work on rows [start_y, end_y) of
+// the whole frame, so a frame can be split into bands.
+
+// NV12 (full range BT.709) to packed RGBA with opaque alpha.
+void nv12_to_rgba(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                  uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize);
+
+// The individual implementations, nv12_to_rgba picks the best one for the
+// CPU on first use. Exposed for the correctness checks and benchmarks.
+void nv12_to_rgba_scalar(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                         uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize);
+void nv12_to_rgba_sse2(const uint8_t* const input[], const uint32_t in_linesize[], uint32_t width,
+                       uint32_t start_y, uint32_t end_y, uint8_t* output, uint32_t out_linesize);
+
+bool cpu_has_sse2(); // False on non-x86 builds, where SSE2 is only emulated.
+const char* nv12_to_rgba_kernel(); // Name of the implementation nv12_to_rgba uses.
@@ -0,0 +1,346 @@
+#include "jpeg_writer.h"
+#include <algorithm>
+#include <cmath>
+
+// Tables from ITU T.81 Annex K.
+static const uint8_t zigzag[64] = {
+  0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+static const uint8_t luma_quant[64] = {
+  16, 11, 10, 16, 24, 40, 51, 61,
+  12, 12, 14, 19, 26, 58, 60, 55,
+  14, 13, 16, 24, 40, 57, 69, 56,
+  14, 17, 22, 29, 51, 87, 80, 62,
+  18, 22, 37, 56, 68, 109, 103, 77,
+  24, 35, 55, 64, 81, 104, 113, 92,
+  49, 64, 78, 87, 103, 121, 120, 101,
+  72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+static const uint8_t chroma_quant[64] = {
+  17, 18, 24, 47, 99, 99, 99, 99,
+  18, 21, 26, 66, 99, 99, 99, 99,
+  24, 26, 56, 99, 99, 99, 99, 99,
+  47, 66, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+static const uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_vals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t ac_luma_vals[162] = {
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+  0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+  0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+  0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+  0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+  0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+  0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa,
+};
+
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_vals[162] = {
+  0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+  0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+  0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+  0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+  0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+  0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+  0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa,
+};
+
+struct HuffCode {
+  uint16_t code;
+  uint8_t length;
+};
+
+struct HuffTable {
+  HuffCode codes[256] = {};
+};
+
+static void build_huffman(const uint8_t bits[16], const uint8_t* vals, HuffTable& table) {
+  uint16_t code = 0;
+  size_t k = 0;
+
+  for (int length = 1; length <= 16; length++) {
+    for (int i = 0; i < bits[length - 1]; i++) {
+      table.codes[vals[k++]] = { code++, (uint8_t)length };
+    }
+
+    code <<= 1;
+  }
+}
+
+struct HuffTables {
+  HuffTable dc_luma, dc_chroma, ac_luma, ac_chroma;
+
+  HuffTables() {
+    build_huffman(dc_luma_bits, dc_vals, dc_luma);
+    build_huffman(dc_chroma_bits, dc_vals, dc_chroma);
+    build_huffman(ac_luma_bits, ac_luma_vals, ac_luma);
+    build_huffman(ac_chroma_bits, ac_chroma_vals, ac_chroma);
+  }
+};
+
+// Scale a base table like libjpeg does, returned in zigzag order.
+static void scale_quant(const uint8_t base[64], int quality, uint8_t out[64]) {
+  quality = std::clamp(quality, 1, 100);
+  int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+  for (int i = 0; i < 64; i++) {
+    int q = (base[zigzag[i]] * scale + 50) / 100;
+    out[i] = (uint8_t)std::clamp(q, 1, 255);
+  }
+}
+
+class BitWriter {
+  public:
+    BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void put(uint32_t code, int length) {
+      buffer = (buffer << length) | (code & ((1u << length) - 1));
+      count += length;
+
+      while (count >= 8) {
+        uint8_t byte = (uint8_t)(buffer >> (count - 8));
+        out.push_back(byte);
+
+        // A literal 0xFF in entropy coded data must be followed by a zero.
+        if (byte == 0xFF)
+          out.push_back(0);
+
+        count -= 8;
+      }
+    }
+
+    void flush() {
+      // Pad the last byte with ones.
+      if (count > 0)
+        put(0x7F, 8 - count);
+    }
+
+  private:
+    std::vector<uint8_t>& out;
+    uint32_t buffer = 0;
+    int count = 0;
+};
+
+struct DctTable {
+  float c[8][8];
+
+  DctTable() {
+    for (int u = 0; u < 8; u++) {
+      float scale = u == 0 ? std::sqrt(0.5f) : 1.0f;
+
+      for (int x = 0; x < 8; x++) {
+        c[u][x] = 0.5f * scale * std::cos((2 * x + 1) * u * 3.14159265f / 16.0f);
+      }
+    }
+  }
+};
+
+// Forward DCT on a level shifted 8x8 block, separable rows then columns.
+static void fdct(const float in[64], float out[64]) {
+  static const DctTable dct;
+  const auto& table = dct.c;
+
+  float tmp[64];
+
+  for (int y = 0; y < 8; y++) {
+    for (int u = 0; u < 8; u++) {
+      float sum = 0.0f;
+      for (int x = 0; x < 8; x++)
+        sum += table[u][x] * in[y * 8 + x];
+      tmp[y * 8 + u] = sum;
+    }
+  }
+
+  for (int u = 0; u < 8; u++) {
+    for (int v = 0; v < 8; v++) {
+      float sum = 0.0f;
+      for (int y = 0; y < 8; y++)
+        sum += table[v][y] * tmp[y * 8 + u];
+      out[v * 8 + u] = sum;
+    }
+  }
+}
+
+static int magnitude_bits(int value) {
+  int bits = 0;
+  value = value < 0 ? -value : value;
+
+  while (value) {
+    bits++;
+    value >>= 1;
+  }
+
+  return bits;
+}
+
+static void encode_block(BitWriter& bw, const float block[64], const uint8_t quant[64],
+                         const HuffTable& dc, const HuffTable& ac, int& prev_dc) {
+  float coef[64];
+  fdct(block, coef);
+
+  int q[64];
+  for (int i = 0; i < 64; i++)
+    q[i] = (int)std::lround(coef[zigzag[i]] / quant[i]);
+
+  int diff = q[0] - prev_dc;
+  prev_dc = q[0];
+
+  int bits = magnitude_bits(diff);
+  bw.put(dc.codes[bits].code, dc.codes[bits].length);
+  if (bits)
+    bw.put(diff < 0 ? diff - 1 : diff, bits);
+
+  int run = 0;
+
+  for (int i = 1; i < 64; i++) {
+    if (q[i] == 0) {
+      run++;
+      continue;
+    }
+
+    while (run > 15) {
+      bw.put(ac.codes[0xF0].code, ac.codes[0xF0].length); // 16 zeros.
+      run -= 16;
+    }
+
+    bits = magnitude_bits(q[i]);
+    const HuffCode& hc = ac.codes[(run << 4) | bits];
+    bw.put(hc.code, hc.length);
+    bw.put(q[i] < 0 ? q[i] - 1 : q[i], bits);
+    run = 0;
+  }
+
+  if (run > 0)
+    bw.put(ac.codes[0x00].code, ac.codes[0x00].length); // End of block.
+}
+
+static void put_u16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(v >> 8);
+  out.push_back(v & 0xFF);
+}
+
+static void put_dht(std::vector<uint8_t>& out, uint8_t id, const uint8_t bits[16], const uint8_t* vals) {
+  size_t count = 0;
+  for (int i = 0; i < 16; i++)
+    count += bits[i];
+
+  out.push_back(id);
+  out.insert(out.end(), bits, bits + 16);
+  out.insert(out.end(), vals, vals + count);
+}
+
+void encode_jpeg_nv12(const Nv12Frame& frame, int quality, std::vector<uint8_t>& out) {
+  static const HuffTables huff;
+  const HuffTable& dc_luma = huff.dc_luma;
+  const HuffTable& dc_chroma = huff.dc_chroma;
+  const HuffTable& ac_luma = huff.ac_luma;
+  const HuffTable& ac_chroma = huff.ac_chroma;
+
+  uint8_t yq[64], cq[64];
+  scale_quant(luma_quant, quality, yq);
+  scale_quant(chroma_quant, quality, cq);
+
+  out.clear();
+
+  // SOI and JFIF header.
+  const uint8_t header[] = {
+    0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+    0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+  };
+  out.insert(out.end(), header, header + sizeof(header));
+
+  // Quantization tables.
+  out.push_back(0xFF); out.push_back(0xDB);
+  put_u16(out, 2 + 2 * 65);
+  out.push_back(0x00);
+  out.insert(out.end(), yq, yq + 64);
+  out.push_back(0x01);
+  out.insert(out.end(), cq, cq + 64);
+
+  // Frame header, luma sampled 2x2 against chroma for 4:2:0.
+  const uint8_t sof[] = {
+    0xFF, 0xC0, 0x00, 17, 8,
+    (uint8_t)(frame.height >> 8), (uint8_t)frame.height,
+    (uint8_t)(frame.width >> 8), (uint8_t)frame.width,
+    3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1,
+  };
+  out.insert(out.end(), sof, sof + sizeof(sof));
+
+  // Huffman tables.
+  out.push_back(0xFF); out.push_back(0xC4);
+  put_u16(out, 2 + 4 * 17 + 12 + 12 + 162 + 162);
+  put_dht(out, 0x00, dc_luma_bits, dc_vals);
+  put_dht(out, 0x10, ac_luma_bits, ac_luma_vals);
+  put_dht(out, 0x01, dc_chroma_bits, dc_vals);
+  put_dht(out, 0x11, ac_chroma_bits, ac_chroma_vals);
+
+  // Scan header.
+  const uint8_t sos[] = {
+    0xFF, 0xDA, 0x00, 12, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0,
+  };
+  out.insert(out.end(), sos, sos + sizeof(sos));
+
+  BitWriter bw(out);
+  int prev_y = 0, prev_cb = 0, prev_cr = 0;
+  uint32_t cw = (frame.width + 1) / 2;
+  uint32_t ch = (frame.height + 1) / 2;
+  float block[64];
+
+  // Each MCU is 16x16 pixels, four luma blocks then one of each chroma.
+  // Edges repeat the last row and column.
+  for (uint32_t my = 0; my < frame.height; my += 16) {
+    for (uint32_t mx = 0; mx < frame.width; mx += 16) {
+      for (uint32_t b = 0; b < 4; b++) {
+        uint32_t bx = mx + (b & 1) * 8;
+        uint32_t by = my + (b >> 1) * 8;
+
+        for (uint32_t y = 0; y < 8; y++) {
+          const uint8_t* row = frame.y + (size_t)std::min(by + y, frame.height - 1) * frame.yStride;
+          for (uint32_t x = 0; x < 8; x++)
+            block[y * 8 + x] = row[std::min(bx + x, frame.width - 1)] - 128.0f;
+        }
+
+        encode_block(bw, block, yq, dc_luma, ac_luma, prev_y);
+      }
+
+      for (uint32_t c = 0; c < 2; c++) {
+        for (uint32_t y = 0; y < 8; y++) {
+          const uint8_t* row = frame.uv + (size_t)std::min(my / 2 + y, ch - 1) * frame.uvStride;
+          for (uint32_t x = 0; x < 8; x++)
+            block[y * 8 + x] = row[std::min(mx / 2 + x, cw - 1) * 2 + c] - 128.0f;
+        }
+
+        if (c == 0)
+          encode_block(bw, block, cq, dc_chroma, ac_chroma, prev_cb);
+        else
+          encode_block(bw, block, cq, dc_chroma, ac_chroma, prev_cr);
+      }
+    }
+  }
+
+  bw.flush();
+
+  out.push_back(0xFF);
+  out.push_back(0xD9);
+}
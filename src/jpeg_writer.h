@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal baseline JPEG encoder for NV12 frames. NV12 is already 4:2:0
+// YCbCr, so planes go straight into the DCT with no colour conversion. The
+// frame must be full range BT.601 to match what JFIF decoders expect.
+struct Nv12Frame {
+  const uint8_t* y;
+  uint32_t yStride;
+  const uint8_t* uv; // Interleaved Cb, Cr at half resolution.
+  uint32_t uvStride;
+  uint32_t width;
+  uint32_t height;
+};
+
+void encode_jpeg_nv12(const Nv12Frame& frame, int quality, std::vector<uint8_t>& out); // Quality 1 to 100.
@@ -1,8 +1,10 @@
 #include <napi.h>
-#include <windows.h>
 #include <obs.h>
+#include <algorithm>
+#include <cmath>
 #include "obs_interface.h"
 #include "utils.h"
+#include "arena.h"
 
 ObsInterface* obs = nullptr;
 
@@ -60,18 +62,64 @@ Napi::Value ObsResetVideoContext(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();
   }
 
-  bool valid = info.Length() == 3 && info[0].IsNumber() && info[1].IsNumber() && info[2].IsNumber();
+  bool valid = (info.Length() == 3 || info.Length() == 4) && 
+    info[0].IsNumber() && // FPS, or the numerator if fpsDen is set
+    info[1].IsNumber() && // Base width
+    info[2].IsNumber() && // Base height
+    (info.Length() == 3 || info[3].IsObject()); // Optional output options
 
   if (!valid) {
     Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsResetVideo").ThrowAsJavaScriptException();
     return info.Env().Undefined();
   }
 
-  int fps = info[0].As<Napi::Number>().Int32Value();
-  int width = info[1].As<Napi::Number>().Int32Value();
-  int height = info[2].As<Napi::Number>().Int32Value();
+  VideoContext ctx;
+  ctx.fpsNum = info[0].As<Napi::Number>().Uint32Value();
+  ctx.fpsDen = 1;
+  ctx.baseWidth = info[1].As<Napi::Number>().Uint32Value();
+  ctx.baseHeight = info[2].As<Napi::Number>().Uint32Value();
+  ctx.outputWidth = ctx.baseWidth;
+  ctx.outputHeight = ctx.baseHeight;
+  ctx.scaleType = OBS_SCALE_BILINEAR;
 
-  obs->setVideoContext(fps, width, height);
+  if (info.Length() == 4) {
+    Napi::Object options = info[3].As<Napi::Object>();
+
+    if (options.Get("fpsDen").IsNumber())
+      ctx.fpsDen = options.Get("fpsDen").As<Napi::Number>().Uint32Value();
+
+    if (options.Get("outputWidth").IsNumber())
+      ctx.outputWidth = options.Get("outputWidth").As<Napi::Number>().Uint32Value();
+
+    if (options.Get("outputHeight").IsNumber())
+      ctx.outputHeight = options.Get("outputHeight").As<Napi::Number>().Uint32Value();
+
+    if (options.Get("scaleType").IsString())
+      ctx.scaleType = scale_type_from_string(options.Get("scaleType").As<Napi::String>().Utf8Value());
+  }
+
+  obs->setVideoContext(ctx);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsResetAudioContext(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsResetAudioContext called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 && info[0].IsNumber() && info[1].IsNumber();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsResetAudioContext").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  int sampleRate = info[0].As<Napi::Number>().Int32Value();
+  int channels = info[1].As<Napi::Number>().Int32Value();
+
+  obs->setAudioContext(sampleRate, channels);
   return info.Env().Undefined();
 }
 
@@ -124,6 +172,216 @@ Napi::Value ObsSetVideoEncoder(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+Napi::Value ObsSetKeyframeInterval(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetKeyframeInterval called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 &&
+    info[0].IsNumber() && // Seconds while buffering, 0 for the encoder settings
+    info[1].IsNumber(); // Seconds while recording straight to file
+
+  double buffering = valid ? info[0].As<Napi::Number>().DoubleValue() : 0;
+  double recording = valid ? info[1].As<Napi::Number>().DoubleValue() : 0;
+
+  // Encoders only take whole seconds, NaN fails every comparison.
+  valid = valid &&
+    buffering >= 0 && buffering <= KEYINT_MAX_SEC && buffering == std::floor(buffering) &&
+    recording >= 0 && recording <= KEYINT_MAX_SEC && recording == std::floor(recording);
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetKeyframeInterval").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  obs->setKeyframeInterval((uint32_t)buffering, (uint32_t)recording);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsListAudioEncoders(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsListAudioEncoders called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 0;
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsListAudioEncoders").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  auto encoders = obs->listAvailableAudioEncoders();
+  Napi::Array result = Napi::Array::New(info.Env(), encoders.size());
+
+  for (size_t i = 0; i < encoders.size(); ++i) {
+    result[i] = Napi::String::New(info.Env(), encoders[i]);
+  }
+
+  return result;
+}
+
+Napi::Value ObsSetAudioEncoder(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetAudioEncoder called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 &&
+    info[0].IsString() && // Encoder ID
+    info[1].IsObject(); // Settings object
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetAudioEncoder").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string id = info[0].As<Napi::String>().Utf8Value();
+  Napi::Object obj = info[1].As<Napi::Object>();
+
+  obs_data_t* settings = napi_to_data(obj);
+  obs->setAudioEncoder(id, settings);
+
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsSetProxyEncoder(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetProxyEncoder called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 4 &&
+    info[0].IsString() && // Encoder ID
+    info[1].IsObject() && // Settings object
+    info[2].IsNumber() && // Width
+    info[3].IsNumber();   // Height
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetProxyEncoder").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string id = info[0].As<Napi::String>().Utf8Value();
+  Napi::Object obj = info[1].As<Napi::Object>();
+  int width = info[2].As<Napi::Number>().Int32Value();
+  int height = info[3].As<Napi::Number>().Int32Value();
+
+  obs_data_t* settings = napi_to_data(obj);
+  obs->setProxyEncoder(id, settings, width, height);
+
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsClearProxyEncoder(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsClearProxyEncoder called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  obs->clearProxyEncoder();
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsGetLastProxyRecording(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsGetLastProxyRecording called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string lastProxy = obs->getLastProxyRecording();
+  return Napi::String::New(info.Env(), lastProxy);
+}
+
+Napi::Value ObsSetSnapshotInterval(const Napi::CallbackInfo& info) {
+  blog(LOG_INFO, "ObsSetSnapshotInterval called");
+
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetSnapshotInterval called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = (info.Length() == 1 || info.Length() == 3) &&
+    info[0].IsNumber() && // Interval in seconds, 0 to disable
+    (info.Length() == 1 || (info[1].IsNumber() && info[2].IsNumber())); // Width, height
+
+  int seconds = valid ? info[0].As<Napi::Number>().Int32Value() : 0;
+  int width = valid && info.Length() == 3 ? info[1].As<Napi::Number>().Int32Value() : 480;
+  int height = valid && info.Length() == 3 ? info[2].As<Napi::Number>().Int32Value() : 270;
+
+  // NV12 needs even dimensions.
+  valid = valid && seconds >= 0 &&
+    width > 0 && height > 0 && width <= 4096 && height <= 4096 &&
+    width % 2 == 0 && height % 2 == 0;
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetSnapshotInterval").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  obs->setSnapshots(seconds, width, height);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsGetLastSnapshots(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsGetLastSnapshots called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  auto snapshots = obs->getLastSnapshots();
+  Napi::Array result = Napi::Array::New(info.Env(), snapshots.size());
+
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    result[i] = Napi::String::New(info.Env(), snapshots[i]);
+  }
+
+  return result;
+}
+
+Napi::Value ObsGetMemoryStats(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsGetMemoryStats called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  Napi::Env env = info.Env();
+  MemoryStats stats = obs->getMemoryStats();
+
+  auto counter = [&](const MemCounter& c) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("live", Napi::Number::New(env, (double)c.live.load(std::memory_order_relaxed)));
+    obj.Set("total", Napi::Number::New(env, (double)c.total.load(std::memory_order_relaxed)));
+    return obj;
+  };
+
+  Napi::Object registry = Napi::Object::New(env);
+
+  for (const auto& kv : stats.registry)
+    registry.Set(kv.first, Napi::Number::New(env, (double)kv.second));
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("libobsAllocs", Napi::Number::New(env, (double)stats.libobsAllocs));
+  result.Set("residentBytes", Napi::Number::New(env, (double)stats.residentBytes));
+  result.Set("peakResidentBytes", Napi::Number::New(env, (double)stats.peakResidentBytes));
+  result.Set("virtualBytes", Napi::Number::New(env, (double)stats.virtualBytes));
+  result.Set("replayBufferBytes", Napi::Number::New(env, (double)stats.replayBufferBytes));
+  result.Set("signals", counter(mem_stats::signals));
+  result.Set("conversions", counter(mem_stats::conversions));
+  result.Set("registry", registry);
+  return result;
+}
+
 Napi::Value ObsSetBuffering(const Napi::CallbackInfo& info) {
   blog(LOG_INFO, "ObsSetBuffering called");
 
@@ -166,13 +424,23 @@ Napi::Value ObsStartRecording(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();
   }
 
-  int offset = 0;
+  double offset = 0;
+  bool exact = false;
+
+  if (info.Length() >= 1 && info[0].IsNumber()) {
+    offset = info[0].As<Napi::Number>().DoubleValue(); // Seconds, fractions allowed.
+  }
 
-  if (info.Length() == 1 && info[0].IsNumber()) {
-    offset = info[0].As<Napi::Number>().Int32Value();
+  if (std::isnan(offset) || offset < 0) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsStartRecording").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
   }
 
-  obs->startRecording(offset);
+  if (info.Length() >= 2 && info[1].IsBoolean()) {
+    exact = info[1].As<Napi::Boolean>().Value();
+  }
+
+  obs->startRecording(offset, exact);
   return info.Env().Undefined();
 }
 
@@ -209,6 +477,29 @@ Napi::Value ObsGetLastRecording(const Napi::CallbackInfo& info) {
   return Napi::String::New(info.Env(), lastRecording);
 }
 
+Napi::Value ObsAddMarker(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsAddMarker called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsAddMarker").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string label = info[0].As<Napi::String>().Utf8Value();
+  double seconds = 0;
+
+  if (!obs->addMarker(label, &seconds))
+    return info.Env().Null();
+
+  return Napi::Number::New(info.Env(), seconds);
+}
+
 Napi::Value ObsInitPreview(const Napi::CallbackInfo& info) {
   blog(LOG_INFO, "ObsInitPreview called");
 
@@ -227,13 +518,13 @@ Napi::Value ObsInitPreview(const Napi::CallbackInfo& info) {
 
   Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
 
-  if (buffer.Length() < sizeof(HWND)) {
-    Napi::TypeError::New(info.Env(), "Buffer too small for HWND").ThrowAsJavaScriptException();
+  if (buffer.Length() < sizeof(void*)) {
+    Napi::TypeError::New(info.Env(), "Buffer too small for window handle").ThrowAsJavaScriptException();
     return info.Env().Undefined();
   }
 
-  HWND hwnd = *reinterpret_cast<HWND*>(buffer.Data());
-  obs->initPreview(hwnd);
+  void* handle = *reinterpret_cast<void**>(buffer.Data());
+  obs->initPreview(handle);
   return info.Env().Undefined();
 }
 
@@ -246,12 +537,29 @@ Napi::Value ObsConfigurePreview(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();
   }
 
-  bool valid = info.Length() == 4 &&
+  bool valid = (info.Length() == 4 || info.Length() == 5) &&
     info[0].IsNumber() && // X
     info[1].IsNumber() && // Y
     info[2].IsNumber() && // Width
     info[3].IsNumber(); // Height
 
+  // Optional preview fps, a number (0 for uncapped) or 'auto'.
+  bool hasFps = info.Length() == 5 && !info[4].IsUndefined();
+  bool autoFps = false;
+  int fps = 0;
+
+  if (valid && hasFps) {
+    if (info[4].IsString()) {
+      autoFps = info[4].As<Napi::String>().Utf8Value() == "auto";
+      valid = autoFps;
+    } else if (info[4].IsNumber()) {
+      fps = info[4].As<Napi::Number>().Int32Value();
+      valid = fps >= 0;
+    } else {
+      valid = false;
+    }
+  }
+
   if (!valid) {
     Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsConfigurePreview").ThrowAsJavaScriptException();
     return info.Env().Undefined();
@@ -262,6 +570,9 @@ Napi::Value ObsConfigurePreview(const Napi::CallbackInfo& info) {
   int width = info[2].As<Napi::Number>().Int32Value();
   int height = info[3].As<Napi::Number>().Int32Value();
 
+  if (hasFps)
+    obs->setPreviewFps(fps, autoFps);
+
   obs->configurePreview(x, y, width, height);
   return info.Env().Undefined();
 }
@@ -376,7 +687,8 @@ Napi::Value ObsGetSourceSettings(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();  
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
 
   obs_data_t* settings = obs->getSourceSettings(name);
   Napi::Object result = data_to_napi(info.Env(), settings);
@@ -399,7 +711,8 @@ Napi::Value ObsSetSourceSettings(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();  
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
 
   Napi::Object obj = info[1].As<Napi::Object>();
   obs_data_t* settings = napi_to_data(obj);
@@ -423,7 +736,8 @@ Napi::Value ObsGetSourceProperties(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();  
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
   obs_properties_t* properties = obs->getSourceProperties(name);
   Napi::Object result = properties_to_napi(info.Env(), properties);
   obs_properties_destroy(properties);
@@ -459,7 +773,8 @@ Napi::Value ObsSetSourceVolume(const Napi::CallbackInfo& info) {
   }
 
   bool valid = info.Length() == 2 && info[0].IsString() && info[1].IsNumber();
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
   float volume = info[1].As<Napi::Number>().FloatValue();
 
   if (!valid || (volume < 0.0f || volume > 1.0f)) {
@@ -471,6 +786,27 @@ Napi::Value ObsSetSourceVolume(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+Napi::Value ObsSetSourceAudioTrack(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetSourceAudioTrack called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 && info[0].IsString() && info[1].IsNumber();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetSourceAudioTrack").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  int track = info[1].As<Napi::Number>().Int32Value();
+
+  obs->setSourceAudioTrack(name, track);
+  return info.Env().Undefined();
+}
+
 Napi::Value ObsSetVolmeterEnabled(const Napi::CallbackInfo& info) {
   if (!obs) {
     blog(LOG_ERROR, "ObsSetVolmeterEnabled called but obs is not initialized");
@@ -491,6 +827,46 @@ Napi::Value ObsSetVolmeterEnabled(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+Napi::Value ObsGetAudioLevels(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsGetAudioLevels called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsGetAudioLevels").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  MeterLevels levels;
+
+  if (!obs->getAudioLevels(name, levels))
+    return info.Env().Null(); // Not an audio source.
+
+  Napi::Env env = info.Env();
+  size_t channels = levels.peak.size();
+  Napi::Array peak = Napi::Array::New(env, channels);
+  Napi::Array truePeak = Napi::Array::New(env, channels);
+  Napi::Array rms = Napi::Array::New(env, channels);
+
+  for (size_t c = 0; c < channels; c++) {
+    peak[c] = Napi::Number::New(env, levels.peak[c]);
+    truePeak[c] = Napi::Number::New(env, levels.truePeak[c]);
+    rms[c] = Napi::Number::New(env, levels.rms[c]);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("peak", peak);
+  result.Set("truePeak", truePeak);
+  result.Set("rms", rms);
+  result.Set("loudness", Napi::Number::New(env, levels.loudness));
+  return result;
+}
+
 Napi::Value ObsSetAudioSuppression(const Napi::CallbackInfo& info) {
   if (!obs) {
     blog(LOG_ERROR, "ObsSetAudioSuppression called but obs is not initialized");
@@ -529,6 +905,171 @@ Napi::Value ObsSetForceMono(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+Napi::Value ObsSetLazySources(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetLazySources called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsBoolean();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetLazySources").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool enabled = info[0].As<Napi::Boolean>().Value();
+  obs->setLazySources(enabled);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsPrewarm(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsPrewarm called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsPrewarm").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  obs->prewarmSource(name);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsSetCaptureRules(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSetCaptureRules called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = (info.Length() == 1 || info.Length() == 2) &&
+    info[0].IsArray() && // Rules
+    (info.Length() == 1 || info[1].IsNumber()); // Optional interval in milliseconds
+
+  std::vector<CaptureRule> rules;
+
+  if (valid) {
+    Napi::Array array = info[0].As<Napi::Array>();
+
+    for (uint32_t i = 0; i < array.Length() && valid; i++) {
+      Napi::Value value = array.Get(i);
+      valid = value.IsObject();
+
+      if (!valid)
+        break;
+
+      Napi::Object rule = value.As<Napi::Object>();
+      Napi::Value exe = rule.Get("exe");
+      Napi::Value source = rule.Get("source");
+      valid = exe.IsString() && source.IsString();
+
+      if (valid)
+        rules.push_back({ exe.As<Napi::String>().Utf8Value(), source.As<Napi::String>().Utf8Value() });
+    }
+  }
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetCaptureRules").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  uint32_t interval = info.Length() == 2 ? info[1].As<Napi::Number>().Uint32Value() : CAPTURE_WATCH_INTERVAL_MS;
+  obs->setCaptureRules(rules, interval);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsCreateScene(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsCreateScene called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsCreateScene").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  obs->createScene(name);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsDeleteScene(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsDeleteScene called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsDeleteScene").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  obs->deleteScene(name);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsSelectScene(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsSelectScene called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 1 && info[0].IsString();
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSelectScene").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>().Utf8Value();
+  obs->selectScene(name);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsListScenes(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsListScenes called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  std::vector<std::string> scenes = obs->listScenes();
+  Napi::Array result = Napi::Array::New(info.Env(), scenes.size());
+
+  for (size_t i = 0; i < scenes.size(); ++i) {
+    result.Set(i, Napi::String::New(info.Env(), scenes[i]));
+  }
+
+  return result;
+}
+
+Napi::Value ObsGetCurrentScene(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    blog(LOG_ERROR, "ObsGetCurrentScene called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  return Napi::String::New(info.Env(), obs->getCurrentScene());
+}
+
 Napi::Value ObsAddSourceToScene(const Napi::CallbackInfo& info) {
   if (!obs) {
     blog(LOG_ERROR, "ObsAddSourceToScene called but obs is not initialized");
@@ -582,7 +1123,8 @@ Napi::Value ObsGetSourcePos(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();  
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
 
   vec2 pos; vec2 size; vec2 scale; obs_sceneitem_crop crop;
   obs->getSourcePos(name, &pos, &size, &scale, &crop);
@@ -621,7 +1163,8 @@ Napi::Value ObsSetSourcePos(const Napi::CallbackInfo& info) {
     return info.Env().Undefined();  
   }
 
-  std::string name = info[0].As<Napi::String>().Utf8Value();
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
 
   Napi::Object position = info[1].As<Napi::Object>();
   float x = position.Get("x").As<Napi::Number>().FloatValue();
@@ -642,6 +1185,234 @@ Napi::Value ObsSetSourcePos(const Napi::CallbackInfo& info) {
   return info.Env().Undefined();
 }
 
+// A Float64Array holding at least length doubles.
+static bool is_float64_array(const Napi::Value& value, size_t length) {
+  return value.IsTypedArray() &&
+    value.As<Napi::TypedArray>().TypedArrayType() == napi_float64_array &&
+    value.As<Napi::TypedArray>().ElementLength() >= length;
+}
+
+Napi::Value ObsGetSourceTransform(const Napi::CallbackInfo& info) {
+  // Called per pointer move while dragging, so no logging here.
+  if (!obs) {
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 &&
+    info[0].IsString() && // Source name
+    is_float64_array(info[1], SOURCE_TRANSFORM_STRIDE); // Target
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsGetSourceTransform").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
+  double* target = info[1].As<Napi::Float64Array>().Data();
+  return Napi::Boolean::New(info.Env(), obs->getSourceTransform(name, target));
+}
+
+Napi::Value ObsSetSourceTransform(const Napi::CallbackInfo& info) {
+  // Called per pointer move while dragging, so no logging here.
+  if (!obs) {
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 2 &&
+    info[0].IsString() && // Source name
+    is_float64_array(info[1], SOURCE_TRANSFORM_STRIDE - 2); // Position, scale and crop
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsSetSourceTransform").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  ArenaScope scope;
+  std::string_view name = arena_utf8(info[0]);
+  const double* values = info[1].As<Napi::Float64Array>().Data();
+
+  vec2 pos = { (float)values[0], (float)values[1] };
+  vec2 scale = { (float)values[2], (float)values[3] };
+  obs_sceneitem_crop crop = { (int)values[4], (int)values[6], (int)values[5], (int)values[7] }; // Left, top, right, bottom.
+
+  obs->setSourcePos(name, &pos, &scale, &crop);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsGetSceneTransforms(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 0 ||
+    (info.Length() == 1 && is_float64_array(info[0], 0)); // Optional target
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsGetSceneTransforms").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  Napi::Env env = info.Env();
+  std::vector<const char*> names;
+  Napi::Float64Array transforms;
+  size_t capacity = 0;
+
+  if (info.Length() == 1) {
+    transforms = info[0].As<Napi::Float64Array>();
+    capacity = transforms.ElementLength() / SOURCE_TRANSFORM_STRIDE;
+  }
+
+  size_t count = obs->getSceneTransforms(capacity ? transforms.Data() : nullptr, capacity, names);
+
+  if (info.Length() == 0 || count > capacity) {
+    // No target or it's too small, hand back a new one sized to fit.
+    transforms = Napi::Float64Array::New(env, count * SOURCE_TRANSFORM_STRIDE);
+    size_t fitted = count;
+    count = std::min(obs->getSceneTransforms(transforms.Data(), fitted, names), fitted);
+  }
+
+  Napi::Array js_names = Napi::Array::New(env, count);
+
+  for (size_t i = 0; i < count; i++)
+    js_names.Set(i, Napi::String::New(env, names[i]));
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("names", js_names);
+  result.Set("transforms", transforms);
+  return result;
+}
+
+Napi::Value ObsGetSceneSnapshot(const Napi::CallbackInfo& info) {
+  if (!obs) {
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = info.Length() == 0 ||
+    (info.Length() == 1 && info[0].IsNumber()); // Version the caller already has
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsGetSceneSnapshot").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  Napi::Env env = info.Env();
+
+  // Nothing has changed since the caller's snapshot, save walking the scene.
+  if (info.Length() == 1 && (uint64_t)info[0].As<Napi::Number>().Int64Value() == obs->getSceneVersion())
+    return env.Null();
+
+  SceneSnapshot snapshot;
+  obs->getSceneSnapshot(snapshot);
+  size_t count = snapshot.names.size();
+
+  Napi::Array names = Napi::Array::New(env, count);
+  Napi::Float64Array transforms = Napi::Float64Array::New(env, snapshot.transforms.size());
+  Napi::Uint8Array visible = Napi::Uint8Array::New(env, count);
+
+  for (size_t i = 0; i < count; i++) {
+    names.Set(i, Napi::String::New(env, snapshot.names[i]));
+    visible[i] = snapshot.visible[i];
+  }
+
+  std::copy(snapshot.transforms.begin(), snapshot.transforms.end(), transforms.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("version", Napi::Number::New(env, (double)snapshot.version));
+  result.Set("names", names);
+  result.Set("transforms", transforms);
+  result.Set("visible", visible);
+  return result;
+}
+
+Napi::Value ObsStartFramePreview(const Napi::CallbackInfo& info) {
+  blog(LOG_INFO, "ObsStartFramePreview called");
+
+  if (!obs) {
+    blog(LOG_ERROR, "ObsStartFramePreview called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = (info.Length() == 2 || info.Length() == 3) &&
+    info[0].IsNumber() && // Width
+    info[1].IsNumber() && // Height
+    (info.Length() == 2 || info[2].IsNumber()); // Frame rate divisor
+
+  int width = valid ? info[0].As<Napi::Number>().Int32Value() : 0;
+  int height = valid ? info[1].As<Napi::Number>().Int32Value() : 0;
+  int divisor = valid && info.Length() == 3 ? info[2].As<Napi::Number>().Int32Value() : 1;
+
+  // Frames come from libobs as NV12, which needs even dimensions.
+  valid = valid && width > 0 && height > 0 && width <= 4096 && height <= 4096 &&
+    width % 2 == 0 && height % 2 == 0 && divisor > 0;
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsStartFramePreview").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  obs->startFramePreview(width, height, divisor);
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsStopFramePreview(const Napi::CallbackInfo& info) {
+  blog(LOG_INFO, "ObsStopFramePreview called");
+
+  if (!obs) {
+    blog(LOG_ERROR, "ObsStopFramePreview called but obs is not initialized");
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  obs->stopFramePreview();
+  return info.Env().Undefined();
+}
+
+Napi::Value ObsReadFramePreview(const Napi::CallbackInfo& info) {
+  // Called per animation frame, so no logging here.
+  if (!obs) {
+    Napi::Error::New(info.Env(), "Obs not initialized").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  bool valid = (info.Length() == 1 || info.Length() == 2) &&
+    info[0].IsTypedArray() && // Target, Uint8Array or Uint8ClampedArray
+    (info.Length() == 1 || info[1].IsNumber()); // Last sequence number read
+
+  if (valid) {
+    napi_typedarray_type type = info[0].As<Napi::TypedArray>().TypedArrayType();
+    valid = type == napi_uint8_array || type == napi_uint8_clamped_array;
+  }
+
+  if (!valid) {
+    Napi::TypeError::New(info.Env(), "Invalid arguments passed to ObsReadFramePreview").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  Napi::TypedArray target = info[0].As<Napi::TypedArray>();
+  uint64_t lastSeq = info.Length() == 2 ? (uint64_t)info[1].As<Napi::Number>().Int64Value() : 0;
+  size_t size = obs->getFramePreviewSize();
+
+  if (size == 0) {
+    Napi::Error::New(info.Env(), "Frame preview not started").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  if (target.ByteLength() < size) {
+    Napi::RangeError::New(info.Env(), "Target too small for frame").ThrowAsJavaScriptException();
+    return info.Env().Undefined();
+  }
+
+  uint8_t* dst = (uint8_t*)target.ArrayBuffer().Data() + target.ByteOffset();
+  uint64_t seq = obs->readFramePreview(dst, lastSeq);
+  return Napi::Number::New(info.Env(), (double)seq);
+}
+
 Napi::Value ObsSetDrawSourceOutline(const Napi::CallbackInfo& info) {
   bool valid =  info.Length() == 1 && info[0].IsBoolean();
     if (!valid) {
@@ -664,8 +1435,19 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("Shutdown", Napi::Function::New(env, ObsShutdown));
   exports.Set("SetRecordingDir", Napi::Function::New(env, ObsSetRecordingDir));
   exports.Set("ResetVideoContext", Napi::Function::New(env, ObsResetVideoContext));
+  exports.Set("ResetAudioContext", Napi::Function::New(env, ObsResetAudioContext));
   exports.Set("ListVideoEncoders", Napi::Function::New(env, ObsListVideoEncoders));
   exports.Set("SetVideoEncoder", Napi::Function::New(env, ObsSetVideoEncoder));
+  exports.Set("SetKeyframeInterval", Napi::Function::New(env, ObsSetKeyframeInterval));
+  exports.Set("ListAudioEncoders", Napi::Function::New(env, ObsListAudioEncoders));
+  exports.Set("SetAudioEncoder", Napi::Function::New(env, ObsSetAudioEncoder));
+  exports.Set("SetProxyEncoder", Napi::Function::New(env, ObsSetProxyEncoder));
+  exports.Set("ClearProxyEncoder", Napi::Function::New(env, ObsClearProxyEncoder));
+  exports.Set("GetLastProxyRecording", Napi::Function::New(env, ObsGetLastProxyRecording));
+
+  exports.Set("SetSnapshotInterval", Napi::Function::New(env, ObsSetSnapshotInterval));
+  exports.Set("GetLastSnapshots", Napi::Function::New(env, ObsGetLastSnapshots));
+  exports.Set("GetMemoryStats", Napi::Function::New(env, ObsGetMemoryStats));
 
   exports.Set("SetBuffering", Napi::Function::New(env, ObsSetBuffering));
   exports.Set("StartBuffer", Napi::Function::New(env, ObsStartBuffer));
@@ -673,6 +1455,7 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("StopRecording", Napi::Function::New(env, ObsStopRecording));
   exports.Set("ForceStopRecording", Napi::Function::New(env, ObsForceStopRecording));
   exports.Set("GetLastRecording", Napi::Function::New(env, ObsGetLastRecording));
+  exports.Set("AddMarker", Napi::Function::New(env, ObsAddMarker));
 
   exports.Set("CreateSource", Napi::Function::New(env, ObsCreateSource));
   exports.Set("DeleteSource", Napi::Function::New(env, ObsDeleteSource));
@@ -681,14 +1464,28 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("GetSourceProperties", Napi::Function::New(env, ObsGetSourceProperties));
   exports.Set("SetMuteAudioInputs", Napi::Function::New(env, ObsSetMuteAudioInputs));
   exports.Set("SetSourceVolume", Napi::Function::New(env, ObsSetSourceVolume));
+  exports.Set("SetSourceAudioTrack", Napi::Function::New(env, ObsSetSourceAudioTrack));
   exports.Set("SetVolmeterEnabled", Napi::Function::New(env, ObsSetVolmeterEnabled));
+  exports.Set("GetAudioLevels", Napi::Function::New(env, ObsGetAudioLevels));
   exports.Set("SetAudioSuppression", Napi::Function::New(env, ObsSetAudioSuppression));
   exports.Set("SetForceMono", Napi::Function::New(env, ObsSetForceMono));
-
+  exports.Set("SetLazySources", Napi::Function::New(env, ObsSetLazySources));
+  exports.Set("Prewarm", Napi::Function::New(env, ObsPrewarm));
+  exports.Set("SetCaptureRules", Napi::Function::New(env, ObsSetCaptureRules));
+
+  exports.Set("CreateScene", Napi::Function::New(env, ObsCreateScene));
+  exports.Set("DeleteScene", Napi::Function::New(env, ObsDeleteScene));
+  exports.Set("SelectScene", Napi::Function::New(env, ObsSelectScene));
+  exports.Set("ListScenes", Napi::Function::New(env, ObsListScenes));
+  exports.Set("GetCurrentScene", Napi::Function::New(env, ObsGetCurrentScene));
   exports.Set("AddSourceToScene", Napi::Function::New(env, ObsAddSourceToScene));
   exports.Set("RemoveSourceFromScene", Napi::Function::New(env, ObsRemoveSourceFromScene));
   exports.Set("GetSourcePos", Napi::Function::New(env, ObsGetSourcePos));
   exports.Set("SetSourcePos", Napi::Function::New(env, ObsSetSourcePos));
+  exports.Set("GetSourceTransform", Napi::Function::New(env, ObsGetSourceTransform));
+  exports.Set("SetSourceTransform", Napi::Function::New(env, ObsSetSourceTransform));
+  exports.Set("GetSceneTransforms", Napi::Function::New(env, ObsGetSceneTransforms));
+  exports.Set("GetSceneSnapshot", Napi::Function::New(env, ObsGetSceneSnapshot));
 
   exports.Set("InitPreview", Napi::Function::New(env, ObsInitPreview));
   exports.Set("ConfigurePreview", Napi::Function::New(env, ObsConfigurePreview));
@@ -696,6 +1493,9 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("HidePreview", Napi::Function::New(env, ObsHidePreview));
   exports.Set("DisablePreview", Napi::Function::New(env, ObsDisablePreview));
   exports.Set("GetPreviewInfo", Napi::Function::New(env, ObsGetPreviewInfo));
+  exports.Set("StartFramePreview", Napi::Function::New(env, ObsStartFramePreview));
+  exports.Set("StopFramePreview", Napi::Function::New(env, ObsStopFramePreview));
+  exports.Set("ReadFramePreview", Napi::Function::New(env, ObsReadFramePreview));
   exports.Set("GetDrawSourceOutlineEnabled", Napi::Function::New(env, ObsGetDrawSourceOutlineEnabled));
   exports.Set("SetDrawSourceOutline", Napi::Function::New(env, ObsSetDrawSourceOutline));
 
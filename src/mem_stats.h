@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Counters for what the addon allocates itself, cheap enough to bump on
+// every signal and conversion. GetMemoryStats reads them, so a live count
+// that keeps growing over a long session points at a leak.
+struct MemCounter {
+  std::atomic<int64_t> live{0}; // Allocated and not yet freed.
+  std::atomic<uint64_t> total{0}; // Ever allocated.
+
+  void alloc() {
+    live.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void free() {
+    live.fetch_sub(1, std::memory_order_relaxed);
+  }
+};
+
+namespace mem_stats {
+  inline MemCounter signals; // SignalData queued for the JS thread.
+  inline MemCounter conversions; // obs_data and arrays a conversion creates and releases itself.
+}
@@ -0,0 +1,424 @@
+#include "mp4_edit.h"
+#include <obs.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+#define CHPL_MAX_TITLE 255 // Bytes, the length is a single byte too.
+
+namespace {
+
+struct Box {
+  uint64_t size; // Including the header.
+  uint32_t header;
+  char type[4];
+};
+
+uint32_t read_u32(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+uint64_t read_u64(const uint8_t* p) {
+  return (uint64_t)read_u32(p) << 32 | read_u32(p + 4);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+  out.push_back(v >> 24);
+  out.push_back((v >> 16) & 0xff);
+  out.push_back((v >> 8) & 0xff);
+  out.push_back(v & 0xff);
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+  put_u32(out, (uint32_t)(v >> 32));
+  put_u32(out, (uint32_t)v);
+}
+
+void put_header(std::vector<uint8_t>& out, const char* type, uint64_t payload) {
+  if (payload + 8 <= UINT32_MAX) {
+    put_u32(out, (uint32_t)(payload + 8));
+    out.insert(out.end(), type, type + 4);
+  } else {
+    put_u32(out, 1);
+    out.insert(out.end(), type, type + 4);
+    put_u64(out, payload + 16);
+  }
+}
+
+// Parse the header at p, with readable bytes of it in memory and remaining
+// bytes to the end of the enclosing box or file.
+bool parse_box(const uint8_t* p, uint64_t readable, uint64_t remaining, Box& box) {
+  if (readable < 8 || remaining < 8)
+    return false;
+
+  box.size = read_u32(p);
+  box.header = 8;
+  memcpy(box.type, p + 4, 4);
+
+  if (box.size == 1) {
+    if (readable < 16)
+      return false;
+
+    box.size = read_u64(p + 8);
+    box.header = 16;
+  } else if (box.size == 0) {
+    box.size = remaining; // Runs to the end.
+  }
+
+  return box.size >= box.header && box.size <= remaining;
+}
+
+std::vector<uint8_t> build_chpl(const std::vector<Mp4Chapter>& chapters) {
+  size_t count = std::min<size_t>(chapters.size(), MP4_MAX_CHAPTERS);
+  std::vector<uint8_t> payload;
+  put_u32(payload, 0x01000000); // Version 1, no flags.
+  put_u32(payload, 0); // Reserved.
+  payload.push_back((uint8_t)count);
+
+  for (size_t i = 0; i < count; i++) {
+    const Mp4Chapter& chapter = chapters[i];
+    put_u64(payload, (uint64_t)std::max<int64_t>(chapter.usec, 0) * 10); // 100ns units.
+
+    // Don't cut a multi byte character in half.
+    size_t length = std::min<size_t>(chapter.title.size(), CHPL_MAX_TITLE);
+
+    while (length < chapter.title.size() && length > 0 && ((uint8_t)chapter.title[length] & 0xc0) == 0x80)
+      length--;
+
+    payload.push_back((uint8_t)length);
+    payload.insert(payload.end(), chapter.title.begin(), chapter.title.begin() + length);
+  }
+
+  std::vector<uint8_t> box;
+  put_header(box, "chpl", payload.size());
+  box.insert(box.end(), payload.begin(), payload.end());
+  return box;
+}
+
+// Find the first child of the given type.
+bool find_box(const uint8_t* data, uint64_t size, const char* type, Box& box, uint64_t& offset) {
+  for (offset = 0; parse_box(data + offset, size - offset, size - offset, box); offset += box.size) {
+    if (memcmp(box.type, type, 4) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+// The moov's children with the chpl swapped in, in udta if there is one.
+std::vector<uint8_t> edit_chapters(const uint8_t* children, uint64_t size, const std::vector<uint8_t>& chpl) {
+  std::vector<uint8_t> out;
+  bool has_udta = false;
+  Box box;
+
+  for (uint64_t offset = 0; parse_box(children + offset, size - offset, size - offset, box); offset += box.size) {
+    if (memcmp(box.type, "udta", 4) != 0) {
+      out.insert(out.end(), children + offset, children + offset + box.size);
+      continue;
+    }
+
+    // Keep everything in udta bar an old chpl, then add ours.
+    const uint8_t* udta = children + offset + box.header;
+    uint64_t udta_size = box.size - box.header;
+    std::vector<uint8_t> payload;
+    Box child;
+
+    for (uint64_t pos = 0; parse_box(udta + pos, udta_size - pos, udta_size - pos, child); pos += child.size) {
+      if (memcmp(child.type, "chpl", 4) != 0)
+        payload.insert(payload.end(), udta + pos, udta + pos + child.size);
+    }
+
+    payload.insert(payload.end(), chpl.begin(), chpl.end());
+    put_header(out, "udta", payload.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+    has_udta = true;
+  }
+
+  if (!has_udta) {
+    put_header(out, "udta", chpl.size());
+    out.insert(out.end(), chpl.begin(), chpl.end());
+  }
+
+  return out;
+}
+
+struct Edit {
+  uint64_t duration; // Movie timescale.
+  int64_t media_time; // Media timescale, -1 for an empty edit.
+  uint32_t rate; // 16.16, normally 1.
+};
+
+// Duration fields of mvhd, tkhd and mdhd move with the version. Offsets
+// are from the start of the payload, after the version and flags.
+uint64_t read_field(const uint8_t* p, bool wide) {
+  return wide ? read_u64(p) : read_u32(p);
+}
+
+void write_field(uint8_t* p, bool wide, uint64_t v) {
+  std::vector<uint8_t> bytes;
+
+  if (wide)
+    put_u64(bytes, v);
+  else
+    put_u32(bytes, (uint32_t)std::min<uint64_t>(v, UINT32_MAX));
+
+  memcpy(p, bytes.data(), bytes.size());
+}
+
+// A trak with the first skip of its presentation cut by its edit list.
+// Returns false if it's missing what's needed, duration is set to the new
+// track duration in the movie timescale.
+bool trim_trak(const uint8_t* trak, uint64_t size, uint32_t movie_scale, int64_t skip_usec, std::vector<uint8_t>& out, uint64_t& duration) {
+  Box tkhd, mdia, mdhd, edts;
+  uint64_t tkhd_at, mdia_at, mdhd_at, edts_at;
+
+  if (!find_box(trak, size, "tkhd", tkhd, tkhd_at) || !find_box(trak, size, "mdia", mdia, mdia_at))
+    return false;
+
+  const uint8_t* mdia_data = trak + mdia_at + mdia.header;
+
+  if (!find_box(mdia_data, mdia.size - mdia.header, "mdhd", mdhd, mdhd_at) || mdhd.size < mdhd.header + 24 || tkhd.size < tkhd.header + 36)
+    return false;
+
+  const uint8_t* tkhd_data = trak + tkhd_at + tkhd.header;
+  const uint8_t* mdhd_data = mdia_data + mdhd_at + mdhd.header;
+  bool tkhd_wide = tkhd_data[0] == 1;
+  uint32_t tkhd_duration_at = tkhd_wide ? 28 : 20;
+  uint32_t media_scale = read_u32(mdhd_data + (mdhd_data[0] == 1 ? 20 : 12));
+
+  if (!media_scale)
+    return false;
+
+  // No edit list is the same as one edit covering the whole track.
+  std::vector<Edit> edits;
+
+  if (find_box(trak, size, "edts", edts, edts_at)) {
+    const uint8_t* edts_data = trak + edts_at + edts.header;
+    Box elst;
+    uint64_t elst_at;
+
+    if (find_box(edts_data, edts.size - edts.header, "elst", elst, elst_at) && elst.size >= elst.header + 8) {
+      const uint8_t* p = edts_data + elst_at + elst.header;
+      bool wide = p[0] == 1;
+      uint32_t count = read_u32(p + 4);
+      uint32_t entry = wide ? 20 : 12;
+      p += 8;
+
+      for (uint32_t i = 0; i < count && elst.header + 8 + (uint64_t)(i + 1) * entry <= elst.size; i++, p += entry) {
+        uint64_t segment = read_field(p, wide);
+        int64_t media_time = wide ? (int64_t)read_u64(p + 8) : (int32_t)read_u32(p + 4);
+        edits.push_back({ segment, media_time, read_u32(p + (wide ? 16 : 8)) });
+      }
+    }
+  }
+
+  if (edits.empty())
+    edits.push_back({ read_field(tkhd_data + tkhd_duration_at, tkhd_wide), 0, 0x00010000 });
+
+  // Cut from the front, whole edits first, e.g. the empty edit of a track
+  // that starts late, then into the first one that's left.
+  uint64_t skip = (uint64_t)skip_usec * movie_scale / 1000000;
+
+  while (skip > 0 && !edits.empty() && edits.front().duration && edits.front().duration <= skip) {
+    skip -= edits.front().duration;
+    edits.erase(edits.begin());
+  }
+
+  if (skip > 0 && !edits.empty()) {
+    Edit& first = edits.front();
+
+    if (first.duration)
+      first.duration -= skip;
+
+    if (first.media_time >= 0)
+      first.media_time += (int64_t)((skip * media_scale + movie_scale / 2) / movie_scale);
+  }
+
+  // Version 1 entries only when the values need them.
+  bool wide = false;
+  duration = 0;
+
+  for (const Edit& edit : edits) {
+    wide = wide || edit.duration > UINT32_MAX || edit.media_time > INT32_MAX;
+    duration += edit.duration;
+  }
+
+  std::vector<uint8_t> elst;
+  put_u32(elst, wide ? 0x01000000 : 0);
+  put_u32(elst, (uint32_t)edits.size());
+
+  for (const Edit& edit : edits) {
+    if (wide) {
+      put_u64(elst, edit.duration);
+      put_u64(elst, (uint64_t)edit.media_time);
+    } else {
+      put_u32(elst, (uint32_t)edit.duration);
+      put_u32(elst, (uint32_t)(int32_t)edit.media_time);
+    }
+
+    put_u32(elst, edit.rate);
+  }
+
+  std::vector<uint8_t> new_edts;
+  put_header(new_edts, "edts", elst.size() + 8);
+  put_header(new_edts, "elst", elst.size());
+  new_edts.insert(new_edts.end(), elst.begin(), elst.end());
+
+  // The edts goes straight after the tkhd, replacing any old one.
+  std::vector<uint8_t> payload;
+  Box box;
+
+  for (uint64_t offset = 0; parse_box(trak + offset, size - offset, size - offset, box); offset += box.size) {
+    if (memcmp(box.type, "edts", 4) == 0)
+      continue;
+
+    size_t start = payload.size();
+    payload.insert(payload.end(), trak + offset, trak + offset + box.size);
+
+    if (memcmp(box.type, "tkhd", 4) == 0) {
+      write_field(payload.data() + start + box.header + tkhd_duration_at, tkhd_wide, duration);
+      payload.insert(payload.end(), new_edts.begin(), new_edts.end());
+    }
+  }
+
+  put_header(out, "trak", payload.size());
+  out.insert(out.end(), payload.begin(), payload.end());
+  return true;
+}
+
+// The moov's children with every trak trimmed, and the movie duration
+// following the longest.
+bool edit_start(const uint8_t* children, uint64_t size, int64_t skip_usec, std::vector<uint8_t>& out) {
+  Box mvhd;
+  uint64_t mvhd_at;
+
+  if (!find_box(children, size, "mvhd", mvhd, mvhd_at) || mvhd.size < mvhd.header + 24)
+    return false;
+
+  const uint8_t* mvhd_data = children + mvhd_at + mvhd.header;
+  bool mvhd_wide = mvhd_data[0] == 1;
+  uint32_t movie_scale = read_u32(mvhd_data + (mvhd_wide ? 20 : 12));
+  size_t mvhd_out = 0;
+  uint64_t movie_duration = 0;
+  Box box;
+
+  if (!movie_scale)
+    return false;
+
+  for (uint64_t offset = 0; parse_box(children + offset, size - offset, size - offset, box); offset += box.size) {
+    if (memcmp(box.type, "trak", 4) != 0) {
+      if (offset == mvhd_at)
+        mvhd_out = out.size();
+
+      out.insert(out.end(), children + offset, children + offset + box.size);
+      continue;
+    }
+
+    uint64_t duration;
+
+    if (!trim_trak(children + offset + box.header, box.size - box.header, movie_scale, skip_usec, out, duration))
+      return false;
+
+    movie_duration = std::max(movie_duration, duration);
+  }
+
+  write_field(out.data() + mvhd_out + mvhd.header + (mvhd_wide ? 24 : 16), mvhd_wide, movie_duration);
+  return true;
+}
+
+// Swap the moov for edit(children), which returns false if it can't.
+bool rewrite_moov(const std::string& path, const char* what,
+                  const std::function<bool(const uint8_t*, uint64_t, std::vector<uint8_t>&)>& edit) {
+  FILE* f = os_fopen(path.c_str(), "r+b");
+
+  if (!f) {
+    blog(LOG_ERROR, "Failed to open %s to add %s", path.c_str(), what);
+    return false;
+  }
+
+  os_fseeki64(f, 0, SEEK_END);
+  int64_t file_size = os_ftelli64(f);
+  Box moov = {};
+  int64_t moov_offset = -1;
+
+  // Only the top level headers are read, the mdat is never touched.
+  for (int64_t offset = 0; offset + 8 <= file_size;) {
+    uint8_t header[16];
+    os_fseeki64(f, offset, SEEK_SET);
+    size_t got = fread(header, 1, sizeof(header), f);
+    Box box;
+
+    if (!parse_box(header, got, (uint64_t)(file_size - offset), box))
+      break;
+
+    if (memcmp(box.type, "moov", 4) == 0) {
+      moov = box;
+      moov_offset = offset;
+    }
+
+    offset += box.size;
+  }
+
+  if (moov_offset < 0) {
+    blog(LOG_ERROR, "No moov in %s, it may not have finished writing", path.c_str());
+    fclose(f);
+    return false;
+  }
+
+  std::vector<uint8_t> children(moov.size - moov.header);
+  os_fseeki64(f, moov_offset + moov.header, SEEK_SET);
+
+  if (fread(children.data(), 1, children.size(), f) != children.size()) {
+    blog(LOG_ERROR, "Failed to read the moov of %s", path.c_str());
+    fclose(f);
+    return false;
+  }
+
+  std::vector<uint8_t> payload;
+
+  if (!edit(children.data(), children.size(), payload)) {
+    blog(LOG_ERROR, "Unexpected moov layout in %s, not adding %s", path.c_str(), what);
+    fclose(f);
+    return false;
+  }
+
+  std::vector<uint8_t> edited;
+  put_header(edited, "moov", payload.size());
+  edited.insert(edited.end(), payload.begin(), payload.end());
+
+  // The new moov goes on the end first, so until the old one is freed the
+  // file still reads as it did.
+  os_fseeki64(f, 0, SEEK_END);
+  bool ok = fwrite(edited.data(), 1, edited.size(), f) == edited.size() && fflush(f) == 0;
+
+  if (ok) {
+    os_fseeki64(f, moov_offset + 4, SEEK_SET);
+    ok = fwrite("free", 1, 4, f) == 4;
+  }
+
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok)
+    blog(LOG_ERROR, "Failed to write %s to %s", what, path.c_str());
+
+  return ok;
+}
+
+} // namespace
+
+bool mp4_add_chapters(const std::string& path, const std::vector<Mp4Chapter>& chapters) {
+  std::vector<uint8_t> chpl = build_chpl(chapters);
+
+  return rewrite_moov(path, "chapters", [&](const uint8_t* children, uint64_t size, std::vector<uint8_t>& out) {
+    out = edit_chapters(children, size, chpl);
+    return true;
+  });
+}
+
+bool mp4_trim_start(const std::string& path, int64_t skip_usec) {
+  return rewrite_moov(path, "an edit list", [&](const uint8_t* children, uint64_t size, std::vector<uint8_t>& out) {
+    return edit_start(children, size, skip_usec, out);
+  });
+}
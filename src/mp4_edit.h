@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define MP4_MAX_CHAPTERS 255 // The chpl count is a single byte.
+
+struct Mp4Chapter {
+  int64_t usec; // From the start of the file.
+  std::string title; // UTF-8, cut to 255 bytes in the file.
+};
+
+// Give a finished MP4 Nero style chapters, a chpl box in moov/udta, which
+// ffmpeg and most players read. The edited moov is appended and the old one
+// turned into a free box, so nothing that offsets point at moves and a
+// crash part way leaves the file as it was. Replaces any chapters already
+// there, at most MP4_MAX_CHAPTERS are written.
+bool mp4_add_chapters(const std::string& path, const std::vector<Mp4Chapter>& chapters);
+
+// Make players start skip_usec into a finished MP4 without re-encoding, by
+// cutting the front off every track's edit list. Decoding still starts on
+// the first keyframe, presentation starts at the skip. Edited the same way
+// as the chapters.
+bool mp4_trim_start(const std::string& path, int64_t skip_usec);
@@ -1,13 +1,42 @@
-#include <windows.h>
 #include <obs.h>
 #include "utils.h"
 #include "obs_interface.h"
+#include "jpeg_writer.h"
+#include "convert.h"
+#include "process_watcher.h"
+#include "mp4_edit.h"
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
 #include <graphics/matrix4.h>
+#include <graphics/vec3.h>
 #include <graphics/vec4.h>
 #include <util/platform.h>
 
+#ifdef _WIN32
+#define MODULE_SUFFIX ".dll"
+#define GRAPHICS_MODULE "libobs-d3d11.dll"
+#else
+#define MODULE_SUFFIX ".so"
+#define GRAPHICS_MODULE "libobs-opengl.so"
+#endif
+
+#define PREVIEW_AUTO_MAX_FPS 30
+#define PREVIEW_AUTO_MIN_FPS 5
+
+#define SNAPSHOT_QUEUE_SIZE 2 // Frames that can wait for the encoder before we drop.
+#define SNAPSHOT_QUALITY 80
+#define SNAPSHOT_CPU_PERCENT 5 // Of one core, averaged over the gap between snapshots.
+
+#define REPLAY_MAX_TIME_SEC 60
+#define REPLAY_MAX_SIZE_MB 1024
+#define CUT_MARGIN_USEC 250000 // Room before the next keyframe for packets that arrive before convert runs.
+
+#define FRAME_POOL_MIN_PIXELS (1280 * 720)
+#define FRAME_POOL_MAX_WORKERS 3 // Leave the rest of the cores to libobs and the encoders.
+
 void call_jscb(Napi::Env env, Napi::Function cb, SignalData* sd) {
   Napi::Object obj = Napi::Object::New(env);
   obj.Set("type", Napi::String::New(env, sd->type));
@@ -80,25 +109,62 @@ void ObsInterface::load_module(const char* module, const char* data, bool allowF
   }
 }
 
-void ObsInterface::setVideoContext(int fps, int width, int height) {
+void ObsInterface::setVideoContext(VideoContext ctx) {
   blog(LOG_INFO, "Reset video context");
 
-  blog(LOG_INFO, "FPS: %d", fps);
-  blog(LOG_INFO, "Width: %d", width);
-  blog(LOG_INFO, "Height: %d", height);
+  blog(LOG_INFO, "FPS: %d/%d", ctx.fpsNum, ctx.fpsDen);
+  blog(LOG_INFO, "Base: %d x %d", ctx.baseWidth, ctx.baseHeight);
+  blog(LOG_INFO, "Output: %d x %d", ctx.outputWidth, ctx.outputHeight);
+  blog(LOG_INFO, "Scale type: %d", ctx.scaleType);
 
-  if (fps <= 10) {
-    blog(LOG_WARNING, "Invalid FPS provided for reset, using default 10");
-    fps = 60;
+  if (ctx.fpsNum == 0 || ctx.fpsDen == 0 || ctx.fpsNum / ctx.fpsDen <= 10) {
+    blog(LOG_WARNING, "Invalid FPS provided for reset, using default 60");
+    ctx.fpsNum = 60;
+    ctx.fpsDen = 1;
   }
 
-  if (width <= 32 || height <= 32) {
+  if (ctx.baseWidth <= 32 || ctx.baseHeight <= 32) {
     blog(LOG_WARNING, "Invalid width or height provided for reset, using default 1920x1080");
-    width = 1920;
-    height = 1080;
+    ctx.baseWidth = 1920;
+    ctx.baseHeight = 1080;
+  }
+
+  if (ctx.outputWidth <= 32 || ctx.outputHeight <= 32) {
+    blog(LOG_WARNING, "Invalid output width or height provided for reset, using base size");
+    ctx.outputWidth = ctx.baseWidth;
+    ctx.outputHeight = ctx.baseHeight;
+  }
+
+  ScopeTimer timer("Video context reconfiguration");
+  obs_video_info current;
+
+  bool unchanged = obs_get_video_info(&current) &&
+    current.fps_num == ctx.fpsNum && current.fps_den == ctx.fpsDen &&
+    current.base_width == ctx.baseWidth && current.base_height == ctx.baseHeight &&
+    current.output_width == ctx.outputWidth && current.output_height == ctx.outputHeight &&
+    current.scale_type == ctx.scaleType;
+
+  if (unchanged) {
+    blog(LOG_INFO, "Video context unchanged, nothing to do");
+    return;
   }
 
-  int ret = reset_video(fps, width, height);
+  // A raw video callback counts as active video, so take the frame preview
+  // and snapshots down across the reset and reconnect them to whichever 
+  // output we end up on.
+  bool snapshots = snapshot_connected;
+  stop_snapshots();
+
+  if (frame_divisor)
+    disconnect_frame_preview();
+
+  int ret = reset_video(ctx);
+
+  if (frame_divisor)
+    connect_frame_preview();
+
+  if (snapshots)
+    connect_snapshots();
 
   if (ret == OBS_VIDEO_CURRENTLY_ACTIVE) {
     blog(LOG_WARNING, "Can't reset video as currently active");
@@ -110,40 +176,103 @@ void ObsInterface::setVideoContext(int fps, int width, int height) {
     throw std::runtime_error("Failed to reset video context");
   }
 
-  // Recreate the encoders as they are tied to the video context.
-  create_video_encoders();
+  // The encoders still point at the old video output, rebind them to the 
+  // new one. They pick up the new size and rate when next started, so 
+  // there's no need to recreate them.
+  obs_encoder_set_video(video_encoder, obs_get_video());
+
+  if (proxy_video_encoder) {
+    obs_encoder_set_video(proxy_video_encoder, obs_get_video());
+  }
 }
 
 
-int ObsInterface::reset_video(int fps, int width, int height) {
+int ObsInterface::reset_video(const VideoContext& ctx) {
   blog(LOG_INFO, "Reset video");
   obs_video_info ovi = {};
 
-  ovi.base_width = width;
-  ovi.base_height = height;
-  ovi.output_width = width;
-  ovi.output_height = height;
-  ovi.fps_num = fps;
-  ovi.fps_den = 1;
+  // Sources are composited at the base size, then the whole canvas is 
+  // scaled to the output size once before it reaches the encoders.
+  ovi.base_width = ctx.baseWidth;
+  ovi.base_height = ctx.baseHeight;
+  ovi.output_width = ctx.outputWidth;
+  ovi.output_height = ctx.outputHeight;
+  ovi.fps_num = ctx.fpsNum;
+  ovi.fps_den = ctx.fpsDen;
 
   ovi.output_format = VIDEO_FORMAT_NV12;
   ovi.colorspace = VIDEO_CS_DEFAULT;
   ovi.range = VIDEO_RANGE_DEFAULT;
-  ovi.scale_type = OBS_SCALE_BILINEAR;
+  ovi.scale_type = ctx.scaleType;
   ovi.adapter = 0;
   ovi.gpu_conversion = true;
-  ovi.graphics_module = "libobs-d3d11.dll"; 
+  ovi.graphics_module = GRAPHICS_MODULE;
 
   return obs_reset_video(&ovi);
 }
 
-bool ObsInterface::reset_audio() {
+bool ObsInterface::reset_audio(uint32_t sample_rate, speaker_layout speakers) {
+  blog(LOG_INFO, "Reset audio");
   struct obs_audio_info oai = {0};
-  oai.samples_per_sec = 48000;
-  oai.speakers = SPEAKERS_STEREO;
+  oai.samples_per_sec = sample_rate;
+  oai.speakers = speakers;
   return obs_reset_audio(&oai);
 }
 
+void ObsInterface::setAudioContext(int sampleRate, int channels) {
+  blog(LOG_INFO, "Reset audio context");
+  blog(LOG_INFO, "Sample rate: %d", sampleRate);
+  blog(LOG_INFO, "Channels: %d", channels);
+
+  if (obs_output_active(output) || (proxy_output && obs_output_active(proxy_output))) {
+    blog(LOG_WARNING, "Cannot reset audio while output is active");
+    throw std::runtime_error("Output is active when trying to reset audio");
+  }
+
+  if (sampleRate != 44100 && sampleRate != 48000) {
+    blog(LOG_ERROR, "Unsupported sample rate: %d", sampleRate);
+    throw std::runtime_error("Unsupported sample rate");
+  }
+
+  // The speaker_layout values line up with their channel counts.
+  speaker_layout speakers = (speaker_layout)channels;
+
+  if (channels < SPEAKERS_MONO || channels > SPEAKERS_7POINT1 || get_audio_channels(speakers) != (uint32_t)channels) {
+    blog(LOG_ERROR, "Unsupported channel count: %d", channels);
+    throw std::runtime_error("Unsupported channel count");
+  }
+
+  ScopeTimer timer("Audio context reconfiguration");
+  obs_audio_info current;
+
+  bool unchanged = obs_get_audio_info(&current) &&
+    current.samples_per_sec == (uint32_t)sampleRate && current.speakers == speakers;
+
+  if (unchanged) {
+    blog(LOG_INFO, "Audio context unchanged, nothing to do");
+    return;
+  }
+
+  if (!audio_tracks.empty()) {
+    // Existing sources keep resamplers and buffers built for the old format,
+    // libobs has no way to rebuild them in place.
+    blog(LOG_ERROR, "Cannot reset audio with %d audio sources present", (int)audio_tracks.size());
+    throw std::runtime_error("Audio sources must be deleted before resetting audio");
+  }
+
+  if (!reset_audio(sampleRate, speakers)) {
+    blog(LOG_ERROR, "Failed to reset audio context");
+    throw std::runtime_error("Failed to reset audio context");
+  }
+
+  // Rebind the encoders to the new audio output, same as for video.
+  for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (audio_encoders[i]) {
+      obs_encoder_set_audio(audio_encoders[i], obs_get_audio());
+    }
+  }
+}
+
 void ObsInterface::init_obs(const std::string& distPath) {
   blog(LOG_INFO, "Enter init_obs");
   auto success = obs_startup("en-US", NULL, NULL);
@@ -181,14 +310,14 @@ void ObsInterface::init_obs(const std::string& distPath) {
 
   // This must come before loading modules to initialize D3D11.
   // Choose some sensible defaults that can be reconfigured.
-  int rc = reset_video(60, 1920, 1080);
+  int rc = reset_video({ 60, 1, 1920, 1080, 1920, 1080, OBS_SCALE_BILINEAR });
 
   if (rc != OBS_VIDEO_SUCCESS) {
     blog(LOG_ERROR, "Failed to reset video!");
     throw std::runtime_error("Failed to reset video!");
   }
 
-  if (!reset_audio()) {
+  if (!reset_audio(48000, SPEAKERS_STEREO)) {
     blog(LOG_ERROR, "Failed to reset audio!");
     throw std::runtime_error("Failed to reset audio!");
   }
@@ -205,7 +334,7 @@ void ObsInterface::init_obs(const std::string& distPath) {
   };
 
   for (const auto& module : modules) {
-    std::string modulePath = pluginPath + module + ".dll";
+    std::string modulePath = pluginPath + module + MODULE_SUFFIX;
     std::string moduleDataPath = pluginDataPath + module;
 
     // NVENC fails if there is no NVENC hardware support.
@@ -230,6 +359,8 @@ void ObsInterface::create_output() {
 
   if (output) {
     blog(LOG_DEBUG, "Releasing existing output");
+    obs_output_remove_packet_callback(output, replay_packet_callback, this);
+    obs_output_remove_packet_callback(output, marker_packet_callback, this);
     obs_output_release(output);
   }
 
@@ -241,26 +372,37 @@ void ObsInterface::create_output() {
     throw std::runtime_error("Failed to create output!");
   }
 
+  // The replay buffer can't tell us how much it holds, so follow along.
+  if (buffering)
+    obs_output_add_packet_callback(output, replay_packet_callback, this);
+
+  // Markers are timed by the packets, not the wall clock.
+  obs_output_add_packet_callback(output, marker_packet_callback, this);
+
+  update_output_settings();
+  connect_signal_handlers(output);
+}
+
+void ObsInterface::update_output_settings() {
   obs_data_t *settings = obs_data_create();
 
   if (buffering) {
     blog(LOG_INFO, "Set replay buffer settings");
-    obs_data_set_int(settings, "max_time_sec", 60);
-    obs_data_set_int(settings, "max_size_mb", 1024);
+    obs_data_set_int(settings, "max_time_sec", REPLAY_MAX_TIME_SEC);
+    obs_data_set_int(settings, "max_size_mb", REPLAY_MAX_SIZE_MB);
     obs_data_set_string(settings, "directory", recording_path.c_str());
     obs_data_set_string(settings, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
     obs_data_set_string(settings, "extension", "mp4");
   } else {
     blog(LOG_INFO, "Set ffmpeg_muxer settings");
     // Need to specify the exact path for ffmpeg_muxer. We will write this again at start recording.
-    std::string filename = recording_path + "\\" + get_current_date_time() + ".mp4";
+    std::string filename = join_path(recording_path, get_current_date_time() + ".mp4");
     obs_data_set_string(settings, "path", filename.c_str());
     unbuffered_output_filename = filename;
   }
 
   obs_output_update(output, settings);
   obs_data_release(settings);
-  connect_signal_handlers(output);
 }
 
 void ObsInterface::setRecordingDir(const std::string& recordingPath) {
@@ -271,11 +413,17 @@ void ObsInterface::setRecordingDir(const std::string& recordingPath) {
     throw std::runtime_error("Output is active, cannot update recording path");
   }
 
-  recording_path = recordingPath;
-  create_output();
+  ScopeTimer timer("Recording directory reconfiguration");
 
-  create_video_encoders();
-  create_audio_encoders();
+  if (recordingPath == recording_path) {
+    blog(LOG_INFO, "Recording directory unchanged, nothing to do");
+    return;
+  }
+
+  // Only the output settings depend on the directory, the output and 
+  // encoders can stay as they are.
+  recording_path = recordingPath;
+  update_output_settings();
 }
 
 void ObsInterface::create_video_encoders() {
@@ -287,13 +435,26 @@ void ObsInterface::create_video_encoders() {
     video_encoder = nullptr;
   }
 
+  // Keyframe spacing bounds how precisely a buffer can be cut, so it
+  // follows the mode rather than whatever the encoder defaults to.
+  obs_data_t* settings = obs_data_create();
+  obs_data_apply(settings, video_encoder_settings);
+  uint32_t keyint = keyframe_interval();
+
+  if (keyint) {
+    blog(LOG_INFO, "Keyframe interval %u seconds while %s", keyint, buffering ? "buffering" : "recording");
+    set_keyint(settings, video_encoder_id, keyint);
+  }
+
   video_encoder = obs_video_encoder_create(
     video_encoder_id.c_str(), 
     "noobs_file_encoder", 
-    video_encoder_settings, 
+    settings, 
     NULL
   );
 
+  obs_data_release(settings);
+
   if (!video_encoder) {
     blog(LOG_ERROR, "Failed to create video encoder!");
     throw std::runtime_error("Failed to create video encoder!");
@@ -303,55 +464,212 @@ void ObsInterface::create_video_encoders() {
   obs_encoder_set_video(video_encoder, obs_get_video());
 }
 
+void ObsInterface::attach_encoders() {
+  obs_output_set_video_encoder(output, video_encoder);
+  attach_audio_encoders();
+}
+
 void ObsInterface::create_audio_encoders() {
-  blog(LOG_INFO, "Create audio encoder");
+  blog(LOG_INFO, "Create audio encoders");
+
+  for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (audio_encoders[i]) {
+      blog(LOG_DEBUG, "Releasing audio encoder for track %d", i);
+      obs_encoder_release(audio_encoders[i]);
+      audio_encoders[i] = nullptr;
+    }
+  }
+
+  // Only create encoders for mixers that have a source assigned, so unused
+  // tracks cost nothing. Track 0 always exists so files always have audio.
+  uint32_t mixers = get_active_audio_mixers();
+
+  for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (!(mixers & (1 << i))) {
+      continue;
+    }
+
+    std::string name = "audio_track_" + std::to_string(i);
+    blog(LOG_INFO, "Set audio encoder for track %d: %s", i, audio_encoder_id.c_str());
+
+    obs_encoder_t *encoder = obs_audio_encoder_create(
+      audio_encoder_id.c_str(), 
+      name.c_str(),
+      audio_encoder_settings, 
+      i, // Mixer index.
+      NULL
+    );
+
+    if (!encoder) {
+      blog(LOG_ERROR, "Failed to create audio encoder for track %d!", i);
+      throw std::runtime_error("Failed to create audio encoder!");
+    }
+
+    obs_encoder_set_audio(encoder, obs_get_audio());
+    audio_encoders[i] = encoder;
+  }
+
+  active_audio_mixers = mixers;
+  audio_tracks_dirty = false;
+  attach_audio_encoders();
+}
+
+void ObsInterface::attach_audio_encoders() {
+  size_t idx = 0;
+
+  for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (audio_encoders[i]) {
+      // Output tracks must be contiguous from zero, regardless of which
+      // mixers are in use.
+      obs_output_set_audio_encoder(output, audio_encoders[i], idx++);
+    }
+  }
+
+  // Clear any trailing slots left over from a previous larger track set.
+  for (; idx < MAX_OUTPUT_AUDIO_ENCODERS; idx++) {
+    obs_output_set_audio_encoder(output, nullptr, idx);
+  }
+
+  obs_output_set_mixers(output, active_audio_mixers);
+
+  if (proxy_output) {
+    // The proxy shares the first track encoder, so rebind it to the new one.
+    obs_output_set_audio_encoder(proxy_output, get_first_audio_encoder(), 0);
+  }
+}
+
+uint32_t ObsInterface::get_active_audio_mixers() {
+  uint32_t mixers = 1; // Track 0.
+
+  for (const auto& [name, track] : audio_tracks) {
+    mixers |= (1 << track);
+  }
+
+  return mixers;
+}
 
-  if (audio_encoder) {
-    blog(LOG_DEBUG, "Releasing audio encoder");
-    obs_encoder_release(audio_encoder);
-    audio_encoder = nullptr;
+obs_encoder_t* ObsInterface::get_first_audio_encoder() {
+  for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (audio_encoders[i]) {
+      return audio_encoders[i];
+    }
+  }
+
+  return nullptr;
+}
+
+void ObsInterface::update_audio_tracks() {
+  if (get_active_audio_mixers() == active_audio_mixers) {
+    return;
+  }
+
+  if (obs_output_active(output)) {
+    // Can't swap encoders under an active output, pick it up when the 
+    // output is next started.
+    blog(LOG_INFO, "Output active, deferring audio track update");
+    audio_tracks_dirty = true;
+    return;
+  }
+
+  create_audio_encoders();
+}
+
+void ObsInterface::create_proxy_encoders() {
+  blog(LOG_INFO, "Set proxy video encoder: %s (%d x %d)", 
+    proxy_encoder_id.c_str(), proxy_width, proxy_height);
+
+  if (!proxy_output) {
+    blog(LOG_INFO, "Creating proxy output");
+    proxy_output = obs_output_create("ffmpeg_muxer", "Proxy Output", NULL, NULL);
+
+    if (!proxy_output) {
+      blog(LOG_ERROR, "Failed to create proxy output!");
+      throw std::runtime_error("Failed to create proxy output!");
+    }
+  }
+
+  if (proxy_video_encoder) {
+    blog(LOG_DEBUG, "Releasing proxy video encoder");
+    obs_encoder_release(proxy_video_encoder);
+    proxy_video_encoder = nullptr;
   }
 
-  audio_encoder = obs_audio_encoder_create(
-    "ffmpeg_aac", 
-    "aac_file",
-    NULL, 
-    0, 
+  proxy_video_encoder = obs_video_encoder_create(
+    proxy_encoder_id.c_str(), 
+    "noobs_proxy_encoder", 
+    proxy_encoder_settings, 
     NULL
   );
 
-  if (!audio_encoder) {
-    blog(LOG_ERROR, "Failed to create audio encoder!");
-    throw std::runtime_error("Failed to create audio encoder!");
+  if (!proxy_video_encoder) {
+    blog(LOG_ERROR, "Failed to create proxy video encoder!");
+    throw std::runtime_error("Failed to create proxy video encoder!");
   }
 
-  blog(LOG_INFO, "Set audio encoder settings");
-  obs_data_t *aenc_settings = obs_data_create();
-  obs_data_set_int(aenc_settings, "bitrate", 128);
-  obs_encoder_update(audio_encoder, aenc_settings);
-  obs_data_release(aenc_settings);
+  // The proxy is scaled on the GPU from the same rendered canvas the main
+  // encoder uses, so it costs one extra downscale pass and no extra capture
+  // or colour conversion work.
+  obs_encoder_set_scaled_size(proxy_video_encoder, proxy_width, proxy_height);
+  obs_encoder_set_gpu_scale_type(proxy_video_encoder, OBS_SCALE_BICUBIC);
+  obs_encoder_set_video(proxy_video_encoder, obs_get_video());
+  obs_output_set_video_encoder(proxy_output, proxy_video_encoder);
 
-  obs_output_set_audio_encoder(output, audio_encoder, 0);
-  obs_encoder_set_audio(audio_encoder, obs_get_audio());
+  // Audio is encoded once and muxed into both files. The proxy only gets the
+  // first track, it's for scrubbing not editing.
+  obs_output_set_audio_encoder(proxy_output, get_first_audio_encoder(), 0);
 }
 
-void ObsInterface::create_scene() {
-  blog(LOG_INFO, "Create scene");
-  scene = obs_scene_create("Base Scene");
+void ObsInterface::release_proxy() {
+  if (proxy_output) {
+    if (obs_output_active(proxy_output)) {
+      blog(LOG_DEBUG, "Force stopping proxy output");
+      obs_output_force_stop(proxy_output);
+    }
 
-  if (!scene) {
-    blog(LOG_ERROR, "Failed to create scene!");
-    throw std::runtime_error("Failed to create scene!");
+    blog(LOG_DEBUG, "Releasing proxy output");
+    obs_output_release(proxy_output);
+    proxy_output = nullptr;
+  }
+
+  if (proxy_video_encoder) {
+    blog(LOG_DEBUG, "Releasing proxy video encoder");
+    obs_encoder_release(proxy_video_encoder);
+    proxy_video_encoder = nullptr;
+  }
+}
+
+void ObsInterface::start_proxy() {
+  if (!proxy_output) {
+    return;
+  }
+
+  if (obs_output_active(proxy_output)) {
+    blog(LOG_WARNING, "Proxy output already active");
+    return;
   }
 
-  obs_source_t *scene_source = obs_scene_get_source(scene);
+  obs_data_t *settings = obs_data_create();
+  std::string filename = join_path(recording_path, get_current_date_time() + "-proxy.mp4");
+  obs_data_set_string(settings, "path", filename.c_str());
+  obs_output_update(proxy_output, settings);
+  obs_data_release(settings);
+  proxy_output_filename = filename;
+
+  blog(LOG_INFO, "Starting proxy output: %s", filename.c_str());
+  bool success = obs_output_start(proxy_output);
 
-  if (!scene_source) {
-    blog(LOG_ERROR, "Failed to get scene source!");
-    throw std::runtime_error("Failed to get scene source!");
+  if (!success) {
+    // Don't fail the main recording because the proxy couldn't start.
+    const char *err = obs_output_get_last_error(proxy_output);
+    blog(LOG_ERROR, "Failed to start proxy recording: %s", err ? err : "Unknown error");
+    proxy_output_filename = "";
   }
+}
 
-  obs_set_output_source(0, scene_source); // 0 = video track
+void ObsInterface::create_scene() {
+  blog(LOG_INFO, "Create scene");
+  createScene(BASE_SCENE);
+  selectScene(BASE_SCENE);
 }
 
 void ObsInterface::volmeter_callback(void *data, 
@@ -376,13 +694,99 @@ void ObsInterface::volmeter_callback(void *data,
   self->jscb.NonBlockingCall(sd, call_jscb);
 }
 
+void ObsInterface::audio_capture_callback(void *param, obs_source_t *source, const audio_data *audio, bool muted) {
+  AudioMeter* meter = (AudioMeter*)param;
+  const float* planes[MAX_AV_PLANES];
+
+  // Source audio is always planar float by the time we see it.
+  for (uint32_t c = 0; c < meter->channels(); c++)
+    planes[c] = (const float*)audio->data[c];
+
+  meter->process(planes, audio->frames, muted);
+}
+
 std::string ObsInterface::createSource(std::string name, std::string type) {
   blog(LOG_INFO, "Create source: %s of type %s", name.c_str(), type.c_str());
+  bool audio = type == AUDIO_OUTPUT || type == AUDIO_INPUT || type == AUDIO_PROCESS;
+
+  // Either way steer clear of names deferred sources have reserved, which
+  // libobs doesn't know about.
+  std::string real_name = unique_source_name(name);
+
+  if (!lazy_sources || audio)
+    return create_source(real_name, type, nullptr);
+
+  obs_data_t* defaults = obs_get_source_defaults(type.c_str());
+
+  if (!defaults) {
+    blog(LOG_ERROR, "Failed to create source: %s", name.c_str());
+    throw std::runtime_error("Failed to create source!");
+  }
+
+  blog(LOG_INFO, "Deferring source %s until it is used", real_name.c_str());
+  obs_data_release(defaults);
+  pending_sources[real_name] = { type, obs_data_create() };
+  return real_name;
+}
+
+std::string ObsInterface::unique_source_name(const std::string& name) {
+  // Like libobs, give a duplicate a numeric suffix.
+  std::string real_name = name;
+
+  for (int i = 2; ; i++) {
+    obs_source_t* existing = obs_get_source_by_name(real_name.c_str());
+    obs_source_release(existing);
+
+    if (!existing && sources.find(real_name) == sources.end() && pending_sources.find(real_name) == pending_sources.end())
+      return real_name;
+
+    real_name = name + " " + std::to_string(i);
+  }
+}
+
+void ObsInterface::setLazySources(bool enabled) {
+  blog(LOG_INFO, "%s lazy sources", enabled ? "Enabling" : "Disabling");
+  lazy_sources = enabled;
+}
+
+void ObsInterface::prewarmSource(std::string name) {
+  blog(LOG_INFO, "Prewarm source: %s", name.c_str());
+
+  if (!create_pending(name) && sources.find(name) == sources.end())
+    blog(LOG_WARNING, "Source %s not found when prewarming", name.c_str());
+}
+
+bool ObsInterface::create_pending(std::string_view name) {
+  auto it = pending_sources.find(name);
+
+  if (it == pending_sources.end())
+    return false;
+
+  std::string real_name = it->first;
+  PendingSource pending = it->second;
+  pending_sources.erase(it);
+
+  blog(LOG_INFO, "Creating deferred source: %s", real_name.c_str());
+  ScopeTimer timer("Deferred source creation");
+  std::string created = create_source(real_name, pending.type, pending.settings);
+  obs_data_release(pending.settings);
+
+  if (created != real_name) {
+    // Something outside the addon took the name meanwhile. The client only
+    // knows the name we reserved, so don't leave a source it can't reach.
+    blog(LOG_ERROR, "Deferred source %s was created as %s", real_name.c_str(), created.c_str());
+    deleteSource(created);
+    throw std::runtime_error("Deferred source name was taken!");
+  }
+
+  return true;
+}
 
+std::string ObsInterface::create_source(const std::string& name, const std::string& type, obs_data_t* settings) {
   obs_source_t *source = obs_source_create(
     type.c_str(), // Type of source, e.g. "wasapi_input_capture"
     name.c_str(), // Name of the source, e.g. "My Audio Input"
-    NULL, // No settings.
+    settings, // Null unless the source was deferred.
     NULL  // No hotkey data.
   );
 
@@ -407,6 +811,19 @@ std::string ObsInterface::createSource(std::string name, std::string type) {
     // Store the volmeter in the volmeters map.
     volmeters[real_name] = volmeter;
     volmeter_cb_ctx[real_name] = ctx; // Track this so we can free it later.
+
+    // And our own meter for RMS, true peak and loudness. Audio can't be
+    // reset while audio sources exist, so the format is fixed from here.
+    obs_audio_info oai;
+    obs_get_audio_info(&oai);
+    AudioMeter* meter = new AudioMeter(oai.samples_per_sec, get_audio_channels(oai.speakers));
+    obs_source_add_audio_capture_callback(source, audio_capture_callback, meter);
+    audio_meters[real_name] = meter;
+
+    // Sources default to every mixer, restrict new ones to the first track
+    // so we don't mix audio nobody encodes.
+    obs_source_set_audio_mixers(source, 1 << 0);
+    audio_tracks[real_name] = 0;
   }
 
   if (type == AUDIO_INPUT && force_mono) {
@@ -450,6 +867,15 @@ std::string ObsInterface::createSource(std::string name, std::string type) {
 void ObsInterface::deleteSource(std::string name) {
   blog(LOG_INFO, "Delete source: %s", name.c_str());
 
+  auto pending_it = pending_sources.find(name);
+
+  if (pending_it != pending_sources.end()) {
+    // Never created, so there's nothing else to clean up.
+    obs_data_release(pending_it->second.settings);
+    pending_sources.erase(pending_it);
+    return;
+  }
+
   // First release a volmeter if there is one present.
   // Only audio sources have volmeters ofcourse.
   auto vol_it = volmeters.find(name);
@@ -472,6 +898,22 @@ void ObsInterface::deleteSource(std::string name) {
     volmeter_cb_ctx.erase(ctx_it);
   }
 
+  // Carry on watching for the other rules, but not this one.
+  auto target_it = std::find_if(capture_targets.begin(), capture_targets.end(), [&](const CaptureTarget& target) {
+    return target.name == name;
+  });
+
+  if (target_it != capture_targets.end()) {
+    std::vector<CaptureRule> rules;
+
+    for (const CaptureTarget& target : capture_targets) {
+      if (target.name != name)
+        rules.push_back({ target.exe, target.name });
+    }
+
+    setCaptureRules(rules, capture_interval_ms);
+  }
+
   // Now deal with the source itself.
   auto it = sources.find(name);
 
@@ -482,6 +924,16 @@ void ObsInterface::deleteSource(std::string name) {
 
   obs_source_t* source = it->second;
 
+  // libobs holds its capture callback mutex while calling us, so once
+  // removed the meter can go.
+  auto meter_it = audio_meters.find(name);
+
+  if (meter_it != audio_meters.end()) {
+    obs_source_remove_audio_capture_callback(source, audio_capture_callback, meter_it->second);
+    delete meter_it->second;
+    audio_meters.erase(meter_it);
+  }
+
   // Remove and release any filters.
   auto filter_it = filters.find(name);
   
@@ -497,16 +949,31 @@ void ObsInterface::deleteSource(std::string name) {
   obs_source_release(source);
   sources.erase(name);
   sizes.erase(name);
+  scene_version++; // Removing the source takes it out of the scene too.
+
+  if (audio_tracks.erase(name)) {
+    // Might have been the last source on a track.
+    update_audio_tracks();
+  }
   blog(LOG_INFO, "Source deleted: %s", name.c_str());
 }
 
-obs_data_t* ObsInterface::getSourceSettings(std::string name) {
-  blog(LOG_INFO, "Get source settings for: %s", name.c_str());
+obs_data_t* ObsInterface::getSourceSettings(std::string_view name) {
+  blog(LOG_INFO, "Get source settings for: %.*s", (int)name.size(), name.data());
+
+  auto pending_it = pending_sources.find(name);
+
+  if (pending_it != pending_sources.end()) {
+    // What it will be created with, over the defaults like libobs does.
+    obs_data_t* settings = obs_get_source_defaults(pending_it->second.type.c_str());
+    obs_data_apply(settings, pending_it->second.settings);
+    return settings;
+  }
 
   auto it = sources.find(name);
 
   if (it == sources.end()) {
-    blog(LOG_WARNING, "Source %s not found when getting settings", name.c_str());
+    blog(LOG_WARNING, "Source %.*s not found when getting settings", (int)name.size(), name.data());
     throw std::runtime_error("Source not found!");
   }
 
@@ -514,19 +981,27 @@ obs_data_t* ObsInterface::getSourceSettings(std::string name) {
   obs_data_t *settings = obs_source_get_settings(source);
   
   if (!settings) {
-    blog(LOG_ERROR, "Failed to get settings for source: %s", name.c_str());
+    blog(LOG_ERROR, "Failed to get settings for source: %.*s", (int)name.size(), name.data());
     throw std::runtime_error("Failed to get source settings!");
   }
 
   return settings;
 }
 
-void ObsInterface::setSourceSettings(std::string name, obs_data_t* settings) {
-  blog(LOG_INFO, "Set source settings for: %s", name.c_str());
+void ObsInterface::setSourceSettings(std::string_view name, obs_data_t* settings) {
+  blog(LOG_INFO, "Set source settings for: %.*s", (int)name.size(), name.data());
+
+  auto pending_it = pending_sources.find(name);
+
+  if (pending_it != pending_sources.end()) {
+    obs_data_apply(pending_it->second.settings, settings);
+    return;
+  }
+
   auto it = sources.find(name);
 
   if (it == sources.end()) {
-    blog(LOG_WARNING, "Source %s not found when setting settings", name.c_str());
+    blog(LOG_WARNING, "Source %.*s not found when setting settings", (int)name.size(), name.data());
     throw std::runtime_error("Source not found!");
   }
 
@@ -539,7 +1014,7 @@ void ObsInterface::setSourceSettings(std::string name, obs_data_t* settings) {
   if (vol_it != volmeters.end()) {
     // Rebind it. This avoids leaving it attached to stale audio stream
     // in the event of a device change.
-    blog(LOG_INFO, "Rebinding volmeter for source: %s", name.c_str());
+    blog(LOG_INFO, "Rebinding volmeter for source: %.*s", (int)name.size(), name.data());
     obs_volmeter_t* volmeter = vol_it->second;
     obs_volmeter_attach_source(volmeter, source);
 
@@ -549,12 +1024,27 @@ void ObsInterface::setSourceSettings(std::string name, obs_data_t* settings) {
   }
 }
 
-obs_properties_t* ObsInterface::getSourceProperties(std::string name) {
-  blog(LOG_INFO, "Get source properties for: %s", name.c_str());
+obs_properties_t* ObsInterface::getSourceProperties(std::string_view name) {
+  blog(LOG_INFO, "Get source properties for: %.*s", (int)name.size(), name.data());
+
+  auto pending_it = pending_sources.find(name);
+
+  if (pending_it != pending_sources.end()) {
+    // Lists like the window list are filled in without an instance.
+    obs_properties_t *props = obs_get_source_properties(pending_it->second.type.c_str());
+
+    if (!props) {
+      blog(LOG_ERROR, "Failed to get properties for source: %.*s", (int)name.size(), name.data());
+      throw std::runtime_error("Failed to get source properties!");
+    }
+
+    return props;
+  }
+
   auto it = sources.find(name);
 
   if (it == sources.end()) {
-    blog(LOG_WARNING, "Source %s not found when getting properties", name.c_str());
+    blog(LOG_WARNING, "Source %.*s not found when getting properties", (int)name.size(), name.data());
     throw std::runtime_error("Source not found!");
   }
 
@@ -562,7 +1052,7 @@ obs_properties_t* ObsInterface::getSourceProperties(std::string name) {
   obs_properties_t *props = obs_source_properties(source);
 
   if (!props) {
-    blog(LOG_ERROR, "Failed to get properties for source: %s", name.c_str());
+    blog(LOG_ERROR, "Failed to get properties for source: %.*s", (int)name.size(), name.data());
     throw std::runtime_error("Failed to get source properties!");
   }
 
@@ -575,6 +1065,10 @@ void ObsInterface::output_signal_handler(void *data, calldata_t *cd) {
   SignalContext* ctx = static_cast<SignalContext*>(data);
   ObsInterface* self = ctx->self;
 
+  // The file is complete by now, finish it off before JS hears it stopped.
+  if (ctx == self->stop_ctx)
+    self->finish_recording(code);
+
   SignalData* sd = new SignalData{ "output", ctx->id.c_str(), code };
   self->jscb.NonBlockingCall(sd, call_jscb);
 }
@@ -595,7 +1089,9 @@ void ObsInterface::disconnect_signal_handlers(obs_output_t *output) {
   signal_handler_disconnect(sh, "stop", output_signal_handler,  stop_ctx);
 }
 
-bool draw_source_outline(obs_scene_t *scene, obs_sceneitem_t *item, void *p) {
+bool collect_source_outline(obs_scene_t *scene, obs_sceneitem_t *item, void *p) {
+  std::vector<OutlineRect>* rects = (std::vector<OutlineRect>*)p;
+
   // Get the item position and size
   vec2 pos; vec2 scale; obs_sceneitem_crop crop;
   obs_sceneitem_get_pos(item, &pos);
@@ -608,61 +1104,95 @@ bool draw_source_outline(obs_scene_t *scene, obs_sceneitem_t *item, void *p) {
   float height = (obs_source_get_height(src) - crop.top - crop.bottom) * scale.y;
 
   if (width <= 0 || height <= 0) {
-    // Don't want to call gs_draw_sprite with zero width or height.
-    // It is obviously nonsense and leads to log spam. Just return early.
+    // Nothing sensible to outline, skip it.
     return true;
   }
 
-  // Draw rectangle around the source using the position and size
-  gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
-  gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
-  gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
+  rects->push_back({ pos.x, pos.y, width, 4.0f }); // Top border
+  rects->push_back({ pos.x, pos.y + height - 4.0f, width, 4.0f }); // Bottom border
+  rects->push_back({ pos.x, pos.y, 4.0f, height }); // Left border
+  rects->push_back({ pos.x + width - 4.0f, pos.y, 4.0f, height }); // Right border
+  rects->push_back({ pos.x + width - 25.0f, pos.y + height - 25.0f, 25.0f, 25.0f }); // Dragging point box
 
-  vec4 col = {0.733f, 0.267f, 0.125f, 1.0f}; // #BB4420
-  gs_effect_set_vec4(color, &col);
+  return true;
+}
+
+void ObsInterface::drawSourceOutlines() {
+  if (!outline_effect) {
+    // Base effects live as long as OBS does, so look them up once.
+    outline_effect = obs_get_base_effect(OBS_EFFECT_SOLID);
+    outline_color = gs_effect_get_param_by_name(outline_effect, "color");
+    outline_tech = gs_effect_get_technique(outline_effect, "Solid");
+  }
 
-  gs_technique_begin(tech);
-  gs_technique_begin_pass(tech, 0);
+  // This is the graphics thread, so outline whatever is being output rather
+  // than reading scene, which the JS thread changes on a switch.
+  obs_source_t *output_source = obs_get_output_source(0);
+  outline_rects.clear();
+  obs_scene_enum_items(obs_scene_from_source(output_source), collect_source_outline, &outline_rects);
+  obs_source_release(output_source);
 
-  gs_matrix_push();
-  gs_matrix_identity();
+  if (outline_rects.empty())
+    return;
 
-  // Top border
-  gs_matrix_push();
-  gs_matrix_translate3f(pos.x, pos.y, 0.0f);
-  gs_draw_sprite(nullptr, 0, width, 4.0f);
-  gs_matrix_pop();
+  // Two triangles per rectangle.
+  size_t verts = outline_rects.size() * 6;
 
-  // Bottom border
-  gs_matrix_push();
-  gs_matrix_translate3f(pos.x, pos.y  + height - 4.0f, 0.0f);
-  gs_draw_sprite(nullptr, 0, width, 4.0f);
-  gs_matrix_pop();
+  if (verts > outline_vb_capacity) {
+    if (outline_vb)
+      gs_vertexbuffer_destroy(outline_vb);
 
-  // Left border
-  gs_matrix_push();
-  gs_matrix_translate3f(pos.x, pos.y, 0.0f);
-  gs_draw_sprite(nullptr, 0, 4.0f, height);
-  gs_matrix_pop();
+    // Grow geometrically so adding sources one at a time doesn't
+    // recreate the buffer every time.
+    size_t capacity = std::max<size_t>(verts, outline_vb_capacity * 2);
 
-  // Right border
-  gs_matrix_push();
-  gs_matrix_translate3f(pos.x + width - 4.0f, pos.y, 0.0f);
-  gs_draw_sprite(nullptr, 0, 4.0f, height);
-  gs_matrix_pop();
+    gs_vb_data *vbd = gs_vbdata_create();
+    vbd->num = capacity;
+    vbd->points = (vec3*)bzalloc(sizeof(vec3) * capacity);
+    outline_vb = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+
+    if (!outline_vb) {
+      blog(LOG_ERROR, "Failed to create outline vertex buffer");
+      outline_vb_capacity = 0;
+      return;
+    }
+
+    outline_vb_capacity = capacity;
+  }
+
+  vec3 *points = gs_vertexbuffer_get_data(outline_vb)->points;
+
+  for (const OutlineRect& r : outline_rects) {
+    float x2 = r.x + r.cx;
+    float y2 = r.y + r.cy;
+    vec3_set(points++, r.x, r.y, 0.0f);
+    vec3_set(points++, x2, r.y, 0.0f);
+    vec3_set(points++, r.x, y2, 0.0f);
+    vec3_set(points++, x2, r.y, 0.0f);
+    vec3_set(points++, x2, y2, 0.0f);
+    vec3_set(points++, r.x, y2, 0.0f);
+  }
+
+  gs_vertexbuffer_flush(outline_vb);
+
+  vec4 col = {0.733f, 0.267f, 0.125f, 1.0f}; // #BB4420
+  gs_effect_set_vec4(outline_color, &col);
+
+  gs_load_vertexbuffer(outline_vb);
+  gs_load_indexbuffer(nullptr);
 
-  // Dragging point box (25x25 pixels in bottom-right corner)
   gs_matrix_push();
-  gs_matrix_translate3f(pos.x + width - 25.0f, pos.y  + height - 25.0f, 0.0f);
-  gs_draw_sprite(nullptr, 0, 25.0f, 25.0f);
-  gs_matrix_pop();
+  gs_matrix_identity();
 
-  gs_matrix_pop();
+  gs_technique_begin(outline_tech);
+  gs_technique_begin_pass(outline_tech, 0);
+  gs_draw(GS_TRIS, 0, (uint32_t)verts);
+  gs_technique_end_pass(outline_tech);
+  gs_technique_end(outline_tech);
 
-  gs_technique_end_pass(tech);
-  gs_technique_end(tech);
+  gs_matrix_pop();
 
-  return true;
+  gs_load_vertexbuffer(nullptr);
 }
 
 void draw_callback(void* data, uint32_t cx, uint32_t cy) {
@@ -699,17 +1229,20 @@ void draw_callback(void* data, uint32_t cx, uint32_t cy) {
 
   // Draw boxes around sources, if enabled.
   if (obsInterface->getDrawSourceOutlineEnabled()) {
-    obs_scene_t* scene = obs_get_scene_by_name("Base Scene");
-    obs_scene_enum_items(scene, draw_source_outline, NULL);
-    obs_scene_release(scene);
+    obsInterface->drawSourceOutlines();
   }
 
 	gs_projection_pop();
 	gs_viewport_pop();
+}
 
-  // Iterate over the sources and check for changes to size.
-  for (const auto& [name, source] : obsInterface->sources) {
-    SourceSize last = obsInterface->sizes[name];
+void ObsInterface::size_tick(void *data, float seconds) {
+  ObsInterface* self = (ObsInterface*)data;
+
+  // Every frame whether or not anything is drawn, as the preview may not
+  // exist or be skipping frames, and a capture can resize at any time.
+  for (const auto& [name, source] : self->sources) {
+    SourceSize last = self->sizes[name];
 
     uint32_t w = obs_source_get_width(source);
     uint32_t h = obs_source_get_height(source);
@@ -717,36 +1250,18 @@ void draw_callback(void* data, uint32_t cx, uint32_t cy) {
     if (w != last.width || h != last.height) {
       blog(LOG_INFO, "Source %s changed size from (%d x %d) to (%d x %d)",
             name.c_str(), last.width, last.height, w, h);
-      obsInterface->sourceCallback(name);
-      obsInterface->sizes[name] = { w, h };
+      self->sourceCallback(name);
+      self->sizes[name] = { w, h };
+      self->scene_version++;
     }
   }
 }
 
-void ObsInterface::initPreview(HWND parent) {
+void ObsInterface::initPreview(void* parent) {
   blog(LOG_INFO, "ObsInterface::initPreview");
 
-  if (!preview_hwnd) {
-    blog(LOG_INFO, "Creating preview child window");
-
-    preview_hwnd = CreateWindowExA(
-      0,                      // No extended styles
-      "STATIC",               // Simple static control class (ANSI string)
-      "OBS Preview",          // Window name (ANSI string)
-      WS_CHILD | WS_BORDER,   // Child + border, NOT visible initially
-      0, 0,                   // Initial position (x, y)
-      0, 0,                   // Initial size (width, height)
-      parent,                 // Parent window (your Electron app)
-      NULL,                   // No menu
-      GetModuleHandle(NULL),
-      NULL
-    );
-
-    if (!preview_hwnd) {
-      blog(LOG_ERROR, "Failed to create preview child window");
-      return;
-    }
-  }
+  if (!preview_window.create(parent))
+    return;
 
   if (!display) {
     blog(LOG_INFO, "Create OBS display in child window");
@@ -758,7 +1273,7 @@ void ObsInterface::initPreview(HWND parent) {
     gs_data.format = GS_BGRA;
     gs_data.zsformat = GS_ZS_NONE;
     gs_data.num_backbuffers = 1;
-    gs_data.window.hwnd = preview_hwnd;
+    preview_window.fill(gs_data.window);
 
     display = obs_display_create(&gs_data, 0x0);
 
@@ -768,6 +1283,7 @@ void ObsInterface::initPreview(HWND parent) {
     }
 
     obs_display_add_draw_callback(display, draw_callback, this);
+    obs_add_tick_callback(preview_tick, this);
   }
 
   obs_display_set_enabled(display, false);
@@ -776,48 +1292,41 @@ void ObsInterface::initPreview(HWND parent) {
 void ObsInterface::configurePreview(int x, int y, int width, int height) {
   blog(LOG_INFO, "ObsInterface::configurePreview");
 
-  if (!preview_hwnd || !display) {
+  if (!preview_window.valid() || !display) {
     blog(LOG_ERROR, "Preview window not initialized");
     return;
   }
 
   blog(LOG_INFO, "Moving preview child window to (%d, %d) with size (%d x %d)", x, y, width, height);
 
-  // Resize and move the existing child window.
-  bool success = SetWindowPos(
-    preview_hwnd,                  // Handle to the child window
-    NULL,                          // No Z-order change
-    x, y,                          // New position (x, y)
-    width, height,                 // New size (width, height)
-    SWP_NOACTIVATE                 // Flags
-  );
-
-  if (!success) {
+  if (!preview_window.move(x, y, width, height)) {
     blog(LOG_ERROR, "Failed to resize preview window to (%d x %d)", width, height);
     return;
   }
 
   obs_display_resize(display, width, height);
   obs_display_set_enabled(display, true);
+  preview_active = true;
 }
 
 void ObsInterface::showPreview() {
   blog(LOG_INFO, "ObsInterface::showPreview");
 
-  if (!preview_hwnd || !display) {
+  if (!preview_window.valid() || !display) {
     blog(LOG_ERROR, "Preview window not initialized");
     return;
   }
 
-  ShowWindow(preview_hwnd, SW_SHOW);
+  preview_window.show();
   obs_display_set_enabled(display, true);
+  preview_active = true;
 }
 
 void ObsInterface::hidePreview() {
   blog(LOG_INFO, "ObsInterface::hidePreview");
 
-  if (preview_hwnd) {
-    ShowWindow(preview_hwnd, SW_HIDE);
+  if (preview_window.valid()) {
+    preview_window.hide();
     blog(LOG_INFO, "Preview child window hidden");
   }
 }
@@ -831,17 +1340,206 @@ void ObsInterface::disablePreview() {
   }
 
   hidePreview();
+  preview_active = false;
   obs_display_set_enabled(display, false);
 }
 
-PreviewInfo ObsInterface::getPreviewInfo() {
-  if (!display) {
-    blog(LOG_WARNING, "Display not initialized when calling getPreviewInfo");
-    return { 1920, 1080, 1920, 1080 }; // Default values
+void ObsInterface::setPreviewFps(uint32_t fps, bool autoFps) {
+  blog(LOG_INFO, "ObsInterface::setPreviewFps %u auto %d", fps, autoFps);
+
+  if (autoFps) {
+    // Start at the cap and back off from there if we see lag. The lagged
+    // count is cumulative, so only what lags from here on counts.
+    preview_auto_fps = PREVIEW_AUTO_MAX_FPS;
+    preview_auto_restart = true;
   }
 
-  obs_video_info ovi;
-  obs_get_video_info(&ovi);
+  preview_fps = fps;
+  preview_fps_auto = autoFps;
+}
+
+uint32_t ObsInterface::update_auto_preview_fps(uint64_t now) {
+  uint32_t fps = preview_auto_fps;
+
+  if (preview_auto_restart.exchange(false)) {
+    preview_lag_check = now;
+    preview_last_lag = now;
+    preview_lagged_frames = obs_get_lagged_frames();
+    return fps;
+  }
+
+  if (now - preview_lag_check < 1000000000ULL)
+    return fps;
+
+  preview_lag_check = now;
+  uint32_t lagged = obs_get_lagged_frames();
+
+  if (lagged > preview_lagged_frames) {
+    // The encoder is falling behind, give it back some GPU time.
+    fps = std::max<uint32_t>(fps / 2, PREVIEW_AUTO_MIN_FPS);
+    preview_last_lag = now;
+    blog(LOG_INFO, "%u frames lagged, preview fps reduced to %u",
+         lagged - preview_lagged_frames, fps);
+  } else if (fps < PREVIEW_AUTO_MAX_FPS && now - preview_last_lag > 5000000000ULL) {
+    // Creep back up slowly once things have been stable for a while.
+    fps = std::min<uint32_t>(fps + 5, PREVIEW_AUTO_MAX_FPS);
+    preview_last_lag = now;
+    blog(LOG_INFO, "No lagged frames, preview fps raised to %u", fps);
+  }
+
+  preview_lagged_frames = lagged;
+  preview_auto_fps = fps;
+  return fps;
+}
+
+void ObsInterface::preview_tick(void *data, float seconds) {
+  ObsInterface* self = (ObsInterface*)data;
+
+  if (!self->display)
+    return;
+
+  // Disabled here as well as in disablePreview, so a call that lands while
+  // we're part way through is put right by the next frame at the latest.
+  if (!self->preview_active) {
+    obs_display_set_enabled(self->display, false);
+    return;
+  }
+
+  uint64_t now = os_gettime_ns();
+  uint32_t fps = self->preview_fps_auto ? self->update_auto_preview_fps(now) : self->preview_fps.load();
+
+  if (fps == 0) {
+    obs_display_set_enabled(self->display, self->preview_active);
+    return;
+  }
+
+  // Ticks run once per canvas frame before the displays render, so a
+  // disabled display skips both the draw and the present for this frame.
+  uint64_t interval = 1000000000ULL / fps;
+  bool draw = now >= self->preview_next_draw;
+
+  if (draw) {
+    self->preview_next_draw += interval;
+
+    // Don't try to catch up after a stall or a rate change.
+    if (self->preview_next_draw < now)
+      self->preview_next_draw = now + interval;
+  }
+
+  obs_display_set_enabled(self->display, draw && self->preview_active);
+}
+
+void ObsInterface::startFramePreview(uint32_t width, uint32_t height, uint32_t divisor) {
+  blog(LOG_INFO, "ObsInterface::startFramePreview %u x %u, divisor %u", width, height, divisor);
+
+  if (frame_divisor)
+    disconnect_frame_preview();
+
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex);
+    frame_buffer.assign((size_t)width * height * 4, 0);
+    frame_seq = 0;
+  }
+
+  // Take NV12 from libobs, it's half the size of RGBA to scale, and
+  // convert with our vector kernel on the way into the buffer.
+  frame_scale = {};
+  frame_scale.format = VIDEO_FORMAT_NV12;
+  frame_scale.width = width;
+  frame_scale.height = height;
+  frame_scale.range = VIDEO_RANGE_FULL;
+  frame_scale.colorspace = VIDEO_CS_709;
+  frame_divisor = divisor;
+
+  // A single core converts a 720p frame well inside a frame interval, only
+  // bigger previews are worth the wakeups.
+  uint32_t cores = std::thread::hardware_concurrency();
+
+  if ((uint64_t)width * height >= FRAME_POOL_MIN_PIXELS && cores > 1)
+    frame_pool = std::make_unique<SlicePool>(std::min<uint32_t>(cores - 1, FRAME_POOL_MAX_WORKERS));
+  else
+    frame_pool.reset();
+
+  connect_frame_preview();
+}
+
+void ObsInterface::stopFramePreview() {
+  blog(LOG_INFO, "ObsInterface::stopFramePreview");
+
+  if (!frame_divisor)
+    return;
+
+  disconnect_frame_preview();
+  frame_divisor = 0;
+  frame_pool.reset();
+
+  std::lock_guard<std::mutex> lock(frame_mutex);
+  frame_buffer.clear();
+  frame_buffer.shrink_to_fit();
+}
+
+size_t ObsInterface::getFramePreviewSize() {
+  std::lock_guard<std::mutex> lock(frame_mutex);
+  return frame_buffer.size();
+}
+
+uint64_t ObsInterface::readFramePreview(uint8_t* dst, uint64_t lastSeq) {
+  std::lock_guard<std::mutex> lock(frame_mutex);
+
+  if (frame_seq != 0 && frame_seq != lastSeq)
+    memcpy(dst, frame_buffer.data(), frame_buffer.size());
+
+  return frame_seq;
+}
+
+void ObsInterface::connect_frame_preview() {
+  // The video output does the scale and conversion for us, off the
+  // graphics thread, and only for the frames we ask for.
+  obs_add_raw_video_callback2(&frame_scale, frame_divisor, frame_preview_callback, this);
+  blog(LOG_INFO, "Frame preview converting with %s on %u threads", nv12_to_rgba_kernel(), frame_pool ? frame_pool->threads() : 1);
+}
+
+void ObsInterface::disconnect_frame_preview() {
+  obs_remove_raw_video_callback(frame_preview_callback, this);
+}
+
+void ObsInterface::frame_preview_callback(void *data, video_data *frame) {
+  ObsInterface* self = (ObsInterface*)data;
+  uint64_t seq;
+
+  {
+    std::lock_guard<std::mutex> lock(self->frame_mutex);
+    uint32_t w = self->frame_scale.width;
+    uint32_t h = self->frame_scale.height;
+
+    if (self->frame_buffer.size() != (size_t)w * h * 4)
+      return;
+
+    uint8_t* out = self->frame_buffer.data();
+
+    if (self->frame_pool) {
+      self->frame_pool->run(h, 2, [&](uint32_t start, uint32_t end) {
+        nv12_to_rgba(frame->data, frame->linesize, w, start, end, out, w * 4);
+      });
+    } else {
+      nv12_to_rgba(frame->data, frame->linesize, w, 0, h, out, w * 4);
+    }
+
+    seq = ++self->frame_seq;
+  }
+
+  SignalData* sd = new SignalData{ "preview", "frame", (long long)seq };
+  self->jscb.NonBlockingCall(sd, call_jscb);
+}
+
+PreviewInfo ObsInterface::getPreviewInfo() {
+  if (!display) {
+    blog(LOG_WARNING, "Display not initialized when calling getPreviewInfo");
+    return { 1920, 1080, 1920, 1080 }; // Default values
+  }
+
+  obs_video_info ovi;
+  obs_get_video_info(&ovi);
 
   uint32_t width, height;
 	obs_display_size(display, &width, &height);
@@ -879,6 +1577,9 @@ ObsInterface::ObsInterface(
   // Setup callback function.
   jscb = cb;
 
+  // Match the bitrate we've always used until told otherwise.
+  obs_data_set_int(audio_encoder_settings, "bitrate", 128);
+
   // Contexts for signal callbacks.
   starting_ctx = new SignalContext{ this, "starting" };
   start_ctx = new SignalContext{ this, "start" };
@@ -890,10 +1591,29 @@ ObsInterface::ObsInterface(
   create_output();
   create_video_encoders();
   create_audio_encoders();
+
+  obs_add_tick_callback(size_tick, this);
 }
 
 ObsInterface::~ObsInterface() {
   blog(LOG_DEBUG, "Destroying ObsInterface");
+  obs_remove_tick_callback(size_tick, this);
+
+  if (display) {
+    obs_remove_tick_callback(preview_tick, this);
+    obs_display_remove_draw_callback(display, draw_callback, this);
+  }
+
+  stopFramePreview();
+  stop_snapshots();
+  stop_snapshot_worker();
+  stop_process_watcher();
+
+  if (outline_vb) {
+    obs_enter_graphics();
+    gs_vertexbuffer_destroy(outline_vb);
+    obs_leave_graphics();
+  }
 
   for (auto& kv : volmeters) {
     obs_volmeter_t* volmeter = kv.second;
@@ -919,6 +1639,14 @@ ObsInterface::~ObsInterface() {
     std::string name = kv.first;
     obs_source_t* source = kv.second;
 
+    auto meter_it = audio_meters.find(name);
+
+    if (meter_it != audio_meters.end()) {
+      obs_source_remove_audio_capture_callback(source, audio_capture_callback, meter_it->second);
+      delete meter_it->second;
+      audio_meters.erase(meter_it);
+    }
+
     auto filter_it = filters.find(name);
 
     if (filter_it != filters.end()) {
@@ -934,9 +1662,25 @@ ObsInterface::~ObsInterface() {
     sources.erase(name);
   }
 
-  if (scene) {
-    blog(LOG_DEBUG, "Releasing scene");
-    obs_scene_release(scene);
+  for (const auto& [name, pending] : pending_sources)
+    obs_data_release(pending.settings);
+
+  pending_sources.clear();
+
+  for (const auto& [name, s] : scenes) {
+    blog(LOG_DEBUG, "Releasing scene: %s", name.c_str());
+    obs_source_dec_showing(obs_scene_get_source(s));
+    obs_scene_release(s);
+  }
+
+  scenes.clear();
+  scene = nullptr;
+
+  release_proxy();
+
+  if (proxy_encoder_settings) {
+    obs_data_release(proxy_encoder_settings);
+    proxy_encoder_settings = nullptr;
   }
 
   if (output) {
@@ -946,6 +1690,8 @@ ObsInterface::~ObsInterface() {
     }
       
     blog(LOG_DEBUG, "Releasing output");
+    obs_output_remove_packet_callback(output, replay_packet_callback, this);
+    obs_output_remove_packet_callback(output, marker_packet_callback, this);
     obs_output_release(output);
   }
 
@@ -954,9 +1700,11 @@ ObsInterface::~ObsInterface() {
   //   obs_encoder_release(video_encoder);
   // }
 
-  // if (audio_encoder) {
-  //   blog(LOG_DEBUG, "Releasing audio encoder");
-  //   obs_encoder_release(audio_encoder);
+  // for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+  //   if (audio_encoders[i]) {
+  //     blog(LOG_DEBUG, "Releasing audio encoder for track %d", i);
+  //     obs_encoder_release(audio_encoders[i]);
+  //   }
   // }
 
   blog(LOG_DEBUG, "Now shutting down OBS");
@@ -971,11 +1719,61 @@ ObsInterface::~ObsInterface() {
 void ObsInterface::setBuffering(bool value) {
   if (obs_output_active(output)) {
     blog(LOG_ERROR, "Cannot change buffering state while output is active");
-    throw new std::runtime_error("Cannot change buffering state while output is active");
+    throw std::runtime_error("Cannot change buffering state while output is active");
+  }
+
+  ScopeTimer timer("Buffering reconfiguration");
+
+  if (value == buffering) {
+    blog(LOG_INFO, "Buffering unchanged, nothing to do");
+    return;
   }
 
+  // The output type differs between modes so it has to be replaced, but 
+  // the existing encoders can move across to the new one. The video
+  // encoder only needs replacing if its keyframe interval changes.
+  uint32_t keyint = keyframe_interval();
   buffering = value;
   create_output();
+
+  if (keyframe_interval() != keyint)
+    create_video_encoders();
+
+  attach_encoders();
+}
+
+void ObsInterface::setKeyframeInterval(uint32_t bufferingSec, uint32_t recordingSec) {
+  if (obs_output_active(output)) {
+    blog(LOG_WARNING, "Cannot change keyframe interval while output is active");
+    throw std::runtime_error("Output is active when trying to change keyframe interval");
+  }
+
+  ScopeTimer timer("Keyframe interval reconfiguration");
+
+  if (bufferingSec == keyint_buffering_sec && recordingSec == keyint_recording_sec) {
+    blog(LOG_INFO, "Keyframe interval unchanged, nothing to do");
+    return;
+  }
+
+  keyint_buffering_sec = bufferingSec;
+  keyint_recording_sec = recordingSec;
+  create_video_encoders();
+}
+
+uint32_t ObsInterface::keyframe_interval() const {
+  return buffering ? keyint_buffering_sec : keyint_recording_sec;
+}
+
+void ObsInterface::set_keyint(obs_data_t* settings, const std::string& id, uint32_t seconds) {
+  // x264, NVENC, QSV, the built in AMF encoders and the ffmpeg ones all
+  // take whole seconds as keyint_sec. The older standalone AMF plugin
+  // names it differently and takes a double.
+  if (id.rfind("amd_amf_", 0) == 0) {
+    obs_data_set_double(settings, "Interval.Keyframe", seconds);
+    return;
+  }
+
+  obs_data_set_int(settings, "keyint_sec", seconds);
 }
 
 void ObsInterface::startBuffering() {
@@ -998,6 +1796,12 @@ void ObsInterface::startBuffering() {
     return;
   }
 
+  if (audio_tracks_dirty) {
+    create_audio_encoders();
+  }
+
+  reset_replay_window(false);
+  reset_marker_clock();
   bool success = obs_output_start(output);
 
   if (!success) {
@@ -1008,7 +1812,7 @@ void ObsInterface::startBuffering() {
   blog(LOG_INFO, "ObsInterface::startBuffering exited");
 }
 
-void ObsInterface::startRecording(int offset) {
+void ObsInterface::startRecording(double offset, bool exact) {
   blog(LOG_INFO, "ObsInterface::startRecording enter");
 
   if (recording_path == "") {
@@ -1016,6 +1820,9 @@ void ObsInterface::startRecording(int offset) {
     throw std::runtime_error("Recording path is not set");
   }
 
+  // Side files are named after the recording, minus the extension.
+  std::string stem = join_path(recording_path, get_current_date_time());
+
   if (buffering) {
     bool is_active = obs_output_active(output);
 
@@ -1024,21 +1831,33 @@ void ObsInterface::startRecording(int offset) {
       throw std::runtime_error("Buffer is not active");
     }
 
+    // The convert proc only takes whole seconds, so pick the keyframe
+    // ourselves and ask for an offset that cuts there.
+    int offset_seconds = start_markers(llround(offset * 1000000.0), exact, stem);
+
     blog(LOG_INFO, "calling save proc handler");
     calldata cd;
     calldata_init(&cd);
-    calldata_set_int(&cd, "offset_seconds", offset);
+    calldata_set_int(&cd, "offset_seconds", offset_seconds);
     proc_handler_t *ph = obs_output_get_proc_handler(output);
     bool success = proc_handler_call(ph, "convert", &cd);
     calldata_free(&cd);
 
     if (!success) {
+      cancel_markers();
       blog(LOG_ERROR, "Failed to call convert procedure handler");
       throw std::runtime_error("Failed to call convert procedure handler");
     }
+
+    reset_replay_window(true);
+
+    // The proxy has no buffer of its own, so it starts from now rather 
+    // than from the offset into the past.
+    start_proxy();
+    start_snapshots(stem);
   } else {
     obs_data_t *ffmpeg_settings = obs_data_create();
-    std::string filename = recording_path + "\\" + get_current_date_time() + ".mp4";
+    std::string filename = stem + ".mp4";
     obs_data_set_string(ffmpeg_settings,  "path", filename.c_str());
     obs_output_update(output, ffmpeg_settings);
     obs_data_release(ffmpeg_settings);
@@ -1053,14 +1872,25 @@ void ObsInterface::startRecording(int offset) {
       return;
     }
 
+    if (audio_tracks_dirty) {
+      create_audio_encoders();
+    }
+
+    reset_marker_clock();
+    start_markers(0, false, stem);
+
     blog(LOG_WARNING, "Call start");
     bool success = obs_output_start(output);
 
     if (!success) {
+      cancel_markers();
       const char *err = obs_output_get_last_error(output);
       blog(LOG_ERROR, "Failed to start recording: %s", err ? err : "Unknown error");
       throw std::runtime_error("Failed to start recording");
     }
+
+    start_proxy();
+    start_snapshots(stem);
   }
 
   blog(LOG_INFO, "ObsInterface::startRecording exit");
@@ -1076,6 +1906,14 @@ void ObsInterface::stopRecording() {
   }
 
   obs_output_stop(output);
+
+  if (proxy_output && obs_output_active(proxy_output)) {
+    obs_output_stop(proxy_output);
+  }
+
+  stop_snapshots();
+  reset_replay_window(false);
+
   blog(LOG_INFO, "ObsInterface::stopRecording exited");
 }
 
@@ -1089,6 +1927,14 @@ void ObsInterface::forceStopRecording() {
   }
 
   obs_output_force_stop(output);
+
+  if (proxy_output && obs_output_active(proxy_output)) {
+    obs_output_force_stop(proxy_output);
+  }
+
+  stop_snapshots();
+  reset_replay_window(false);
+
   blog(LOG_INFO, "ObsInterface::forceStopRecording exited");
 }
 
@@ -1124,8 +1970,96 @@ std::string ObsInterface::getLastRecording() {
   return path;
 }
 
+void ObsInterface::createScene(std::string name) {
+  blog(LOG_INFO, "Create scene: %s", name.c_str());
+
+  if (scenes.find(name) != scenes.end()) {
+    blog(LOG_WARNING, "Scene %s already exists", name.c_str());
+    return;
+  }
+
+  // libobs names are shared between scenes and sources, and a deferred
+  // source has reserved its name without libobs knowing.
+  if (pending_sources.find(name) != pending_sources.end() || sources.find(name) != sources.end()) {
+    blog(LOG_ERROR, "Scene name %s is taken by a source", name.c_str());
+    throw std::runtime_error("Scene name is taken by a source!");
+  }
+
+  obs_scene_t *created = obs_scene_create(name.c_str());
+
+  if (!created) {
+    blog(LOG_ERROR, "Failed to create scene: %s", name.c_str());
+    throw std::runtime_error("Failed to create scene!");
+  }
+
+  // Showing the scene shows its sources, so captures in a scene that isn't
+  // selected keep running (game capture keeps its hook) and a switch doesn't
+  // wait on them to start. Costs the capture work of every scene.
+  obs_source_inc_showing(obs_scene_get_source(created));
+  scenes[name] = created;
+}
+
+void ObsInterface::deleteScene(std::string name) {
+  blog(LOG_INFO, "Delete scene: %s", name.c_str());
+
+  if (name == BASE_SCENE) {
+    blog(LOG_WARNING, "The base scene can't be deleted");
+    return;
+  }
+
+  auto it = scenes.find(name);
+
+  if (it == scenes.end()) {
+    blog(LOG_WARNING, "Scene %s not found when deleting", name.c_str());
+    return;
+  }
+
+  if (it->second == scene)
+    selectScene(BASE_SCENE);
+
+  // Its sources stay, only their items in this scene go.
+  obs_source_t *source = obs_scene_get_source(it->second);
+  obs_source_dec_showing(source);
+  obs_source_remove(source);
+  obs_scene_release(it->second);
+  scenes.erase(it);
+}
+
+void ObsInterface::selectScene(std::string name) {
+  blog(LOG_INFO, "Select scene: %s", name.c_str());
+  auto it = scenes.find(name);
+
+  if (it == scenes.end()) {
+    blog(LOG_WARNING, "Scene %s not found when selecting", name.c_str());
+    return;
+  }
+
+  if (it->second == scene)
+    return;
+
+  // The graphics thread picks the new channel source up on its next frame.
+  // Outputs and encoders never see the switch, so a recording carries on.
+  obs_set_output_source(0, obs_scene_get_source(it->second)); // 0 = video track
+  scene = it->second;
+  scene_version++;
+}
+
+std::vector<std::string> ObsInterface::listScenes() {
+  std::vector<std::string> names;
+
+  for (const auto& [name, s] : scenes)
+    names.push_back(name);
+
+  return names;
+}
+
+std::string ObsInterface::getCurrentScene() {
+  return scene ? obs_source_get_name(obs_scene_get_source(scene)) : "";
+}
+
 void ObsInterface::addSourceToScene(std::string name) {
   blog(LOG_INFO, "ObsInterface::addSourceToScene called for source: %s", name.c_str());
+  create_pending(name); // Deferred sources start here, if not prewarmed.
 
   obs_sceneitem_t *item = obs_scene_find_source(scene, name.c_str());
 
@@ -1147,6 +2081,8 @@ void ObsInterface::addSourceToScene(std::string name) {
   if (!item) {
     blog(LOG_ERROR, "Failed to add source to scene: %s", name.c_str());
   }
+
+  scene_version++;
   
   blog(LOG_INFO, "ObsInterface::addSourceToScene exited");
 }
@@ -1162,29 +2098,35 @@ void ObsInterface::removeSourceFromScene(std::string name) {
   }
 
   obs_sceneitem_remove(item);
+  scene_version++;
   blog(LOG_INFO, "ObsInterface::removeSourceFromScene exited");
 }
 
-void ObsInterface::getSourcePos(std::string name, vec2* pos, vec2* size, vec2* scale, obs_sceneitem_crop* crop) 
+void ObsInterface::getSourcePos(std::string_view name, vec2* pos, vec2* size, vec2* scale, obs_sceneitem_crop* crop) 
 {
+  if (pending_sources.find(name) != pending_sources.end()) {
+    blog(LOG_WARNING, "Deferred source %.*s is not in the scene", (int)name.size(), name.data());
+    return;
+  }
+
   auto it = sources.find(name);
 
   if (it == sources.end()) {
-    blog(LOG_WARNING, "Source %s not found when getting source position", name.c_str());
+    blog(LOG_WARNING, "Source %.*s not found when getting source position", (int)name.size(), name.data());
     throw std::runtime_error("Source not found!");
   }
 
   obs_source_t* source = it->second;
 
   if (!source) {
-    blog(LOG_WARNING, "Did not find source for video source: %s", name.c_str());
+    blog(LOG_WARNING, "Did not find source for video source: %.*s", (int)name.size(), name.data());
     return;
   }
 
-  obs_sceneitem_t *item = obs_scene_find_source(scene, name.c_str());
+  obs_sceneitem_t *item = obs_scene_find_source(scene, obs_source_get_name(source));
 
   if (!item) {
-    blog(LOG_WARNING, "Did not find scene item for video source: %s", name.c_str());
+    blog(LOG_WARNING, "Did not find scene item for video source: %.*s", (int)name.size(), name.data());
     return;
   }
 
@@ -1197,17 +2139,114 @@ void ObsInterface::getSourcePos(std::string name, vec2* pos, vec2* size, vec2* s
   size->y = obs_source_get_height(source);
 }
 
-void ObsInterface::setSourcePos(std::string name, vec2* pos, vec2* scale, obs_sceneitem_crop* crop) {
-  obs_sceneitem_t *item = obs_scene_find_source(scene, name.c_str());
+void ObsInterface::setSourcePos(std::string_view name, vec2* pos, vec2* scale, obs_sceneitem_crop* crop) {
+  // Look the source up first, the scene wants a null terminated name and
+  // libobs already holds one.
+  auto it = sources.find(name);
+
+  if (it == sources.end()) {
+    blog(LOG_WARNING, "Source %.*s not found when setting source position", (int)name.size(), name.data());
+    return;
+  }
+
+  obs_sceneitem_t *item = obs_scene_find_source(scene, obs_source_get_name(it->second));
 
   if (!item) {
-    blog(LOG_WARNING, "Did not find scene item for video source: %s", name.c_str());
+    blog(LOG_WARNING, "Did not find scene item for video source: %.*s", (int)name.size(), name.data());
     return;
   }
 
   obs_sceneitem_set_pos(item, pos);
   obs_sceneitem_set_scale(item, scale);
   obs_sceneitem_set_crop(item, crop);
+  scene_version++;
+}
+
+// Pack a scene item in the SOURCE_TRANSFORM_STRIDE layout.
+static void write_transform(obs_sceneitem_t* item, double* out) {
+  vec2 pos, scale;
+  obs_sceneitem_crop crop;
+  obs_sceneitem_get_pos(item, &pos);
+  obs_sceneitem_get_scale(item, &scale);
+  obs_sceneitem_get_crop(item, &crop);
+  obs_source_t* source = obs_sceneitem_get_source(item);
+
+  out[0] = pos.x;
+  out[1] = pos.y;
+  out[2] = scale.x;
+  out[3] = scale.y;
+  out[4] = crop.left;
+  out[5] = crop.right;
+  out[6] = crop.top;
+  out[7] = crop.bottom;
+  out[8] = obs_source_get_width(source);
+  out[9] = obs_source_get_height(source);
+}
+
+bool ObsInterface::getSourceTransform(std::string_view name, double* out) {
+  // Called at pointer move rate while dragging, so no logging.
+  auto it = sources.find(name);
+
+  if (it == sources.end())
+    return false;
+
+  obs_sceneitem_t *item = obs_scene_find_source(scene, obs_source_get_name(it->second));
+
+  if (!item)
+    return false;
+
+  write_transform(item, out);
+  return true;
+}
+
+size_t ObsInterface::getSceneTransforms(double* out, size_t capacity, std::vector<const char*>& names) {
+  struct Context {
+    double* out;
+    size_t capacity;
+    std::vector<const char*>& names;
+  };
+
+  Context ctx = { out, capacity, names };
+  names.clear();
+
+  // Names are only valid while the sources are, which is fine for the JS
+  // thread as it's the only one that deletes them.
+  obs_scene_enum_items(scene, [](obs_scene_t*, obs_sceneitem_t* item, void* param) {
+    Context* ctx = static_cast<Context*>(param);
+    size_t index = ctx->names.size();
+
+    if (index < ctx->capacity)
+      write_transform(item, ctx->out + index * SOURCE_TRANSFORM_STRIDE);
+
+    ctx->names.push_back(obs_source_get_name(obs_sceneitem_get_source(item)));
+    return true;
+  }, &ctx);
+
+  return names.size();
+}
+
+uint64_t ObsInterface::getSceneVersion() {
+  return scene_version.load();
+}
+
+void ObsInterface::getSceneSnapshot(SceneSnapshot& snapshot) {
+  // Read the version first, so a change made during the walk gives a newer
+  // version than the one reported and the caller asks again.
+  snapshot.version = scene_version.load();
+  snapshot.names.clear();
+  snapshot.transforms.clear();
+  snapshot.visible.clear();
+
+  obs_scene_enum_items(scene, [](obs_scene_t*, obs_sceneitem_t* item, void* param) {
+    SceneSnapshot* snapshot = static_cast<SceneSnapshot*>(param);
+    size_t offset = snapshot->transforms.size();
+
+    snapshot->transforms.resize(offset + SOURCE_TRANSFORM_STRIDE);
+    write_transform(item, snapshot->transforms.data() + offset);
+    snapshot->names.push_back(obs_source_get_name(obs_sceneitem_get_source(item)));
+    snapshot->visible.push_back(obs_sceneitem_visible(item));
+    return true;
+  }, &snapshot);
 }
 
 std::vector<std::string> ObsInterface::listAvailableVideoEncoders()
@@ -1226,10 +2265,34 @@ std::vector<std::string> ObsInterface::listAvailableVideoEncoders()
   return encoders;
 }
 
+std::vector<std::string> ObsInterface::listAvailableAudioEncoders()
+{
+  std::vector<std::string> encoders;
+  size_t idx = 0;
+  const char *encoder_type;
+
+  while (obs_enum_encoder_types(idx++, &encoder_type)) {
+    bool audio = obs_get_encoder_type(encoder_type) == OBS_ENCODER_AUDIO;
+
+    if (audio)
+      encoders.emplace_back(encoder_type);
+  }
+
+  return encoders;
+}
+
 void ObsInterface::setVideoEncoder(std::string id, obs_data_t* settings) {
   if (obs_output_active(output)) {
     blog(LOG_WARNING, "Cannot change video encoder while output is active");
-    throw new std::runtime_error("Output is active when trying to change encoder");
+    throw std::runtime_error("Output is active when trying to change encoder");
+  }
+
+  ScopeTimer timer("Video encoder reconfiguration");
+
+  if (id == video_encoder_id && data_equal(settings, video_encoder_settings)) {
+    blog(LOG_INFO, "Video encoder unchanged, nothing to do");
+    obs_data_release(settings);
+    return;
   }
 
   video_encoder_id = id;
@@ -1238,6 +2301,318 @@ void ObsInterface::setVideoEncoder(std::string id, obs_data_t* settings) {
   create_video_encoders();
 }
 
+void ObsInterface::setAudioEncoder(std::string id, obs_data_t* settings) {
+  if (obs_output_active(output) || (proxy_output && obs_output_active(proxy_output))) {
+    blog(LOG_WARNING, "Cannot change audio encoder while output is active");
+    obs_data_release(settings);
+    throw std::runtime_error("Output is active when trying to change encoder");
+  }
+
+  if (obs_get_encoder_type(id.c_str()) != OBS_ENCODER_AUDIO) {
+    blog(LOG_ERROR, "Not an audio encoder: %s", id.c_str());
+    obs_data_release(settings);
+    throw std::runtime_error("Not an audio encoder");
+  }
+
+  ScopeTimer timer("Audio encoder reconfiguration");
+
+  if (id == audio_encoder_id && data_equal(settings, audio_encoder_settings)) {
+    blog(LOG_INFO, "Audio encoder unchanged, nothing to do");
+    obs_data_release(settings);
+    return;
+  }
+
+  audio_encoder_id = id;
+  obs_data_release(audio_encoder_settings);
+  audio_encoder_settings = settings;
+  create_audio_encoders();
+}
+
+void ObsInterface::setProxyEncoder(std::string id, obs_data_t* settings, int width, int height) {
+  blog(LOG_INFO, "Set proxy encoder: %s (%d x %d)", id.c_str(), width, height);
+
+  if (obs_output_active(output) || (proxy_output && obs_output_active(proxy_output))) {
+    blog(LOG_WARNING, "Cannot change proxy encoder while output is active");
+    obs_data_release(settings);
+    throw std::runtime_error("Output is active when trying to change proxy encoder");
+  }
+
+  if (width < 2 || height < 2) {
+    blog(LOG_ERROR, "Invalid proxy size (%d x %d)", width, height);
+    obs_data_release(settings);
+    throw std::runtime_error("Invalid proxy size");
+  }
+
+  ScopeTimer timer("Proxy encoder reconfiguration");
+
+  bool unchanged = proxy_output && id == proxy_encoder_id && 
+    data_equal(settings, proxy_encoder_settings) &&
+    proxy_width == (uint32_t)(width & ~1) && proxy_height == (uint32_t)(height & ~1);
+
+  if (unchanged) {
+    blog(LOG_INFO, "Proxy encoder unchanged, nothing to do");
+    obs_data_release(settings);
+    return;
+  }
+
+  proxy_encoder_id = id;
+
+  if (proxy_encoder_settings) {
+    obs_data_release(proxy_encoder_settings);
+  }
+
+  proxy_encoder_settings = settings;
+
+  // NV12 needs even dimensions, round down rather than let the encoder fail.
+  proxy_width = width & ~1;
+  proxy_height = height & ~1;
+
+  create_proxy_encoders();
+}
+
+void ObsInterface::clearProxyEncoder() {
+  blog(LOG_INFO, "Clear proxy encoder");
+
+  if (proxy_output && obs_output_active(proxy_output)) {
+    blog(LOG_WARNING, "Cannot clear proxy encoder while output is active");
+    throw std::runtime_error("Output is active when trying to clear proxy encoder");
+  }
+
+  release_proxy();
+  proxy_encoder_id = "";
+
+  if (proxy_encoder_settings) {
+    obs_data_release(proxy_encoder_settings);
+    proxy_encoder_settings = nullptr;
+  }
+}
+
+std::string ObsInterface::getLastProxyRecording() {
+  return proxy_output_filename;
+}
+
+void ObsInterface::setSnapshots(uint32_t intervalSec, uint32_t width, uint32_t height) {
+  blog(LOG_INFO, "ObsInterface::setSnapshots every %us at %u x %u", intervalSec, width, height);
+
+  bool recording = snapshot_connected;
+  stop_snapshots();
+  stop_snapshot_worker();
+
+  snapshot_interval_ns = (uint64_t)intervalSec * 1000000000ULL;
+
+  if (!snapshot_interval_ns)
+    return;
+
+  // Full range 601 so the planes can go into the JPEG as they are.
+  snapshot_scale = {};
+  snapshot_scale.format = VIDEO_FORMAT_NV12;
+  snapshot_scale.width = width;
+  snapshot_scale.height = height;
+  snapshot_scale.range = VIDEO_RANGE_FULL;
+  snapshot_scale.colorspace = VIDEO_CS_601;
+
+  for (int i = 0; i < SNAPSHOT_QUEUE_SIZE; i++) {
+    SnapshotFrame* snap = new SnapshotFrame();
+    snap->y.resize((size_t)width * height);
+    snap->uv.resize((size_t)width * height / 2);
+    snapshot_free.push_back(snap);
+  }
+
+  snapshot_exit = false;
+  snapshot_thread = std::thread(&ObsInterface::snapshot_worker, this);
+
+  if (recording)
+    connect_snapshots();
+}
+
+std::vector<std::string> ObsInterface::getLastSnapshots() {
+  std::lock_guard<std::mutex> lock(snapshot_mutex);
+  return snapshot_files;
+}
+
+void ObsInterface::start_snapshots(const std::string& stem) {
+  if (!snapshot_interval_ns)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    snapshot_stem = stem;
+    snapshot_index = 0;
+    snapshot_files.clear();
+  }
+
+  snapshot_pending = true;
+  snapshot_next = os_gettime_ns() + snapshot_interval_ns;
+  connect_snapshots();
+}
+
+void ObsInterface::connect_snapshots() {
+  if (snapshot_connected)
+    return;
+
+  // We only need a frame every few seconds, so ask for a couple a second 
+  // and pick from those rather than scaling every frame.
+  obs_video_info ovi;
+  obs_get_video_info(&ovi);
+  uint32_t divisor = std::max<uint32_t>(1, ovi.fps_num / (ovi.fps_den * 2));
+
+  obs_add_raw_video_callback2(&snapshot_scale, divisor, snapshot_callback, this);
+  snapshot_connected = true;
+}
+
+void ObsInterface::stop_snapshots() {
+  if (!snapshot_connected)
+    return;
+
+  obs_remove_raw_video_callback(snapshot_callback, this);
+  snapshot_connected = false;
+}
+
+void ObsInterface::rename_snapshots(const std::string& from, const std::string& to) {
+  std::unique_lock<std::mutex> lock(snapshot_mutex);
+
+  if (from == to)
+    return;
+
+  snapshot_cv.wait(lock, [this] { return snapshot_exit || (snapshot_queue.empty() && !snapshot_writing); });
+
+  for (std::string& file : snapshot_files) {
+    if (file.compare(0, from.size(), from) != 0)
+      continue; // From a later recording.
+
+    std::string renamed = to + file.substr(from.size());
+
+    if (os_rename(file.c_str(), renamed.c_str()) != 0) {
+      blog(LOG_WARNING, "Failed to rename snapshot %s", file.c_str());
+      continue;
+    }
+
+    blog(LOG_INFO, "Renamed snapshot to %s", renamed.c_str());
+    file = renamed;
+  }
+}
+
+void ObsInterface::stop_snapshot_worker() {
+  if (snapshot_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mutex);
+      snapshot_exit = true;
+    }
+
+    snapshot_cv.notify_all();
+    snapshot_thread.join();
+  }
+
+  for (SnapshotFrame* snap : snapshot_free)
+    delete snap;
+
+  snapshot_free.clear();
+}
+
+void ObsInterface::snapshot_callback(void *data, video_data *frame) {
+  ObsInterface* self = (ObsInterface*)data;
+  uint64_t now = os_gettime_ns();
+
+  bool due = self->snapshot_pending || now >= self->snapshot_next;
+
+  if (!due || now < self->snapshot_not_before)
+    return;
+
+  self->snapshot_pending = false;
+  self->snapshot_next = now + self->snapshot_interval_ns;
+
+  SnapshotFrame* snap;
+
+  {
+    std::lock_guard<std::mutex> lock(self->snapshot_mutex);
+
+    if (self->snapshot_free.empty()) {
+      // Never hold up the video thread waiting for the encoder.
+      blog(LOG_WARNING, "Snapshot encoder busy, dropping snapshot");
+      return;
+    }
+
+    snap = self->snapshot_free.back();
+    self->snapshot_free.pop_back();
+  }
+
+  uint32_t w = self->snapshot_scale.width;
+  uint32_t h = self->snapshot_scale.height;
+
+  for (uint32_t y = 0; y < h; y++)
+    memcpy(snap->y.data() + (size_t)y * w, frame->data[0] + (size_t)y * frame->linesize[0], w);
+
+  for (uint32_t y = 0; y < h / 2; y++)
+    memcpy(snap->uv.data() + (size_t)y * w, frame->data[1] + (size_t)y * frame->linesize[1], w);
+
+  {
+    std::lock_guard<std::mutex> lock(self->snapshot_mutex);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%03u.jpg", self->snapshot_index++);
+    snap->path = self->snapshot_stem + suffix;
+    self->snapshot_queue.push_back(snap);
+  }
+
+  self->snapshot_cv.notify_one();
+}
+
+void ObsInterface::snapshot_worker() {
+  std::vector<uint8_t> jpeg;
+
+  while (true) {
+    SnapshotFrame* snap;
+
+    {
+      std::unique_lock<std::mutex> lock(snapshot_mutex);
+      snapshot_cv.wait(lock, [this] { return snapshot_exit || !snapshot_queue.empty(); });
+
+      // Finish what's queued before exiting, they belong to a recording.
+      if (snapshot_queue.empty())
+        return;
+
+      snap = snapshot_queue.front();
+      snapshot_queue.erase(snapshot_queue.begin());
+      snapshot_writing = true;
+    }
+
+    uint64_t start = os_gettime_ns();
+
+    Nv12Frame frame = {
+      snap->y.data(), snapshot_scale.width,
+      snap->uv.data(), snapshot_scale.width,
+      snapshot_scale.width, snapshot_scale.height,
+    };
+
+    encode_jpeg_nv12(frame, SNAPSHOT_QUALITY, jpeg);
+    bool ok = write_file(snap->path, jpeg);
+
+    // Space captures out by however long that took, so encoding averages
+    // no more than the budget even on a slow machine.
+    uint64_t end = os_gettime_ns();
+    snapshot_not_before = end + (end - start) * (100 / SNAPSHOT_CPU_PERCENT - 1);
+
+    std::string path = snap->path;
+
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mutex);
+
+      if (ok)
+        snapshot_files.push_back(path);
+
+      snapshot_free.push_back(snap);
+      snapshot_writing = false;
+    }
+
+    snapshot_cv.notify_all(); // For rename_snapshots.
+
+    if (ok) {
+      blog(LOG_INFO, "Wrote snapshot %s in %.1f ms", path.c_str(), (end - start) / 1000000.0);
+      SignalData* sd = new SignalData{ "snapshot", path, 0 };
+      jscb.NonBlockingCall(sd, call_jscb);
+    }
+  }
+}
+
 void ObsInterface::setMuteAudioInputs(bool mute) {
   // Loop over all sources, and set the mute state if they are of type "wasapi_input_capture".
   for (const auto& kv : sources) {
@@ -1257,13 +2632,13 @@ void ObsInterface::setMuteAudioInputs(bool mute) {
   }
 }
 
-void ObsInterface::setSourceVolume(std::string name, float volume) {
-  blog(LOG_INFO, "Setting source %s volume to %f", name.c_str(), volume);
+void ObsInterface::setSourceVolume(std::string_view name, float volume) {
+  blog(LOG_INFO, "Setting source %.*s volume to %f", (int)name.size(), name.data(), volume);
 
   auto it = sources.find(name);
 
   if (it == sources.end()) {
-    blog(LOG_WARNING, "Source %s not found when setting volume", name.c_str());
+    blog(LOG_WARNING, "Source %.*s not found when setting volume", (int)name.size(), name.data());
     return;
   }
 
@@ -1276,13 +2651,42 @@ void ObsInterface::setSourceVolume(std::string name, float volume) {
     strcmp(type, AUDIO_PROCESS) == 0;
 
   if (!audio) {
-    blog(LOG_WARNING, "Source %s is not a valid audio source", name.c_str());
+    blog(LOG_WARNING, "Source %.*s is not a valid audio source", (int)name.size(), name.data());
     return;
   }
 
   obs_source_set_volume(source, volume);
 }
 
+void ObsInterface::setSourceAudioTrack(std::string name, int track) {
+  blog(LOG_INFO, "Setting source %s to audio track %d", name.c_str(), track);
+
+  if (track < 0 || track >= MAX_AUDIO_MIXES) {
+    blog(LOG_ERROR, "Invalid audio track %d", track);
+    throw std::runtime_error("Invalid audio track");
+  }
+
+  auto it = audio_tracks.find(name);
+
+  if (it == audio_tracks.end()) {
+    blog(LOG_WARNING, "Source %s is not a valid audio source", name.c_str());
+    throw std::runtime_error("Source is not a valid audio source!");
+  }
+
+  uint32_t required = get_active_audio_mixers() | (1 << track);
+
+  if (obs_output_active(output) && (required & ~active_audio_mixers)) {
+    // Moving between existing tracks is fine mid-recording, but a new track 
+    // needs a new encoder and that can't be added to an active output.
+    blog(LOG_WARNING, "Cannot add audio track %d while output is active", track);
+    throw std::runtime_error("Output is active when trying to add an audio track");
+  }
+
+  it->second = track;
+  obs_source_set_audio_mixers(sources[name], 1 << track);
+  update_audio_tracks();
+}
+
 void ObsInterface::setVolmeterEnabled(bool enabled) {
   blog(LOG_INFO, "Setting volmeter enabled: %d", enabled);
   volmeter_enabled = enabled;
@@ -1321,6 +2725,102 @@ void ObsInterface::setForceMono(bool enabled) {
   }
 }
 
+void ObsInterface::setCaptureRules(const std::vector<CaptureRule>& rules, uint32_t intervalMs) {
+  blog(LOG_INFO, "Setting %zu capture rules, checking every %u ms", rules.size(), intervalMs);
+
+  // The watcher reads the targets, so they're only swapped with it stopped.
+  stop_process_watcher();
+  capture_interval_ms = intervalMs;
+  std::vector<std::string> exes;
+
+  for (const CaptureRule& rule : rules) {
+    // A capture that's waiting on a game isn't much use deferred.
+    create_pending(rule.source);
+    auto it = sources.find(rule.source);
+
+    if (it == sources.end()) {
+      blog(LOG_WARNING, "Source %s not found when setting capture rules", rule.source.c_str());
+      continue;
+    }
+
+    const char* type = obs_source_get_id(it->second);
+    bool game = strcmp(type, GAME_CAPTURE) == 0;
+
+    if (!game && strcmp(type, WINDOW_CAPTURE) != 0) {
+      blog(LOG_WARNING, "Source %s is a %s, not a game or window capture", rule.source.c_str(), type);
+      continue;
+    }
+
+    capture_targets.push_back({ this, it->first, rule.exe, obs_source_get_ref(it->second), game });
+    exes.push_back(rule.exe);
+
+    // The source knows when it has actually hooked, which may be a while
+    // after the process appears, or never.
+    signal_handler_t* sh = obs_source_get_signal_handler(it->second);
+    signal_handler_connect(sh, "hooked", capture_hooked, &capture_targets.back());
+    signal_handler_connect(sh, "unhooked", capture_unhooked, &capture_targets.back());
+  }
+
+  if (exes.empty())
+    return;
+
+  process_watcher = std::make_unique<ProcessWatcher>(exes, intervalMs, [this](size_t index, const ProcessWindow* window) {
+    capture_callback(index, window);
+  });
+}
+
+void ObsInterface::stop_process_watcher() {
+  process_watcher.reset();
+
+  for (CaptureTarget& target : capture_targets) {
+    signal_handler_t* sh = obs_source_get_signal_handler(target.source);
+    signal_handler_disconnect(sh, "hooked", capture_hooked, &target);
+    signal_handler_disconnect(sh, "unhooked", capture_unhooked, &target);
+    obs_source_release(target.source);
+  }
+
+  capture_targets.clear();
+}
+
+void ObsInterface::capture_callback(size_t index, const ProcessWindow* window) {
+  const CaptureTarget& target = capture_targets[index];
+
+  // Leave the settings alone when the process goes, game capture waits
+  // for the window to come back by itself.
+  if (window) {
+    std::string spec = window_spec(*window);
+    blog(LOG_INFO, "Process %s (%u) matched, capturing %s with %s", window->exe.c_str(), window->pid, spec.c_str(), target.name.c_str());
+
+    obs_data_t* settings = obs_data_create();
+
+    if (target.game)
+      obs_data_set_string(settings, "capture_mode", "window");
+
+    obs_data_set_string(settings, "window", spec.c_str());
+    obs_source_update(target.source, settings);
+    obs_data_release(settings);
+  } else {
+    blog(LOG_INFO, "Process for %s exited", target.name.c_str());
+  }
+}
+
+void ObsInterface::capture_hooked(void *data, calldata_t *cd) {
+  CaptureTarget* target = (CaptureTarget*)data;
+  const char* title = calldata_string(cd, "title");
+  blog(LOG_INFO, "%s hooked %s", target->name.c_str(), title ? title : "a window");
+
+  SignalData* sd = new SignalData{ "capture", target->name, 1 };
+  target->self->jscb.NonBlockingCall(sd, call_jscb);
+}
+
+void ObsInterface::capture_unhooked(void *data, calldata_t *cd) {
+  CaptureTarget* target = (CaptureTarget*)data;
+  blog(LOG_INFO, "%s unhooked", target->name.c_str());
+
+  SignalData* sd = new SignalData{ "capture", target->name, 0 };
+  target->self->jscb.NonBlockingCall(sd, call_jscb);
+}
+
 void ObsInterface::setAudioSuppression(bool enabled) {
   blog(LOG_INFO, "%s audio suppression on all input devices", enabled ? "Enabling" : "Disabling");
   audio_suppression = enabled;
@@ -1381,8 +2881,281 @@ void ObsInterface::sourceCallback(std::string name) {
   jscb.NonBlockingCall(sd, call_jscb);
 }
 
-void ObsInterface::zeroVolmeter(std::string name) {
-  blog(LOG_INFO, "Zeroing volmeter for %s", name.c_str());
-  SignalData* sd = new SignalData{ "volmeter", name.c_str(), 0, 0 };
+bool ObsInterface::getAudioLevels(std::string name, MeterLevels& levels) {
+  auto it = audio_meters.find(name);
+
+  if (it == audio_meters.end())
+    return false;
+
+  levels = it->second->read();
+  return true;
+}
+
+MemoryStats ObsInterface::getMemoryStats() {
+  MemoryStats stats = {};
+  stats.libobsAllocs = bnum_allocs();
+  stats.peakResidentBytes = peak_resident_size();
+
+  os_proc_memory_usage_t usage;
+
+  if (os_get_proc_memory_usage(&usage)) {
+    stats.residentBytes = usage.resident_size;
+    stats.virtualBytes = usage.virtual_size;
+  }
+
+  // The two are read separately, don't report a peak below the current.
+  stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    stats.replayBufferBytes = replay_bytes;
+  }
+
+  stats.registry["sources"] = sources.size();
+  stats.registry["pendingSources"] = pending_sources.size();
+  stats.registry["scenes"] = scenes.size();
+  stats.registry["sizes"] = sizes.size();
+  stats.registry["filters"] = filters.size();
+  stats.registry["volmeters"] = volmeters.size();
+  stats.registry["volmeterContexts"] = volmeter_cb_ctx.size();
+  stats.registry["audioMeters"] = audio_meters.size();
+  stats.registry["audioTracks"] = audio_tracks.size();
+  stats.registry["captureTargets"] = capture_targets.size();
+
+  return stats;
+}
+
+void ObsInterface::reset_replay_window(bool converted) {
+  std::lock_guard<std::mutex> lock(replay_mutex);
+  replay_window.clear();
+  replay_bytes = 0;
+  replay_converted = converted;
+}
+
+void ObsInterface::replay_packet_callback(obs_output_t *output, encoder_packet *pkt, encoder_packet_time *pkt_time, void *param) {
+  ObsInterface* self = (ObsInterface*)param;
+  std::lock_guard<std::mutex> lock(self->replay_mutex);
+
+  if (self->replay_converted)
+    return;
+
+  self->replay_window.push_back({ pkt->dts_usec, pkt->size });
+  self->replay_bytes += pkt->size;
+
+  // Purge by the same limits we give the replay buffer.
+  const int64_t max_usec = REPLAY_MAX_TIME_SEC * 1000000LL;
+  const uint64_t max_bytes = REPLAY_MAX_SIZE_MB * 1024ULL * 1024ULL;
+
+  while (self->replay_window.size() > 1 &&
+         (pkt->dts_usec - self->replay_window.front().first > max_usec || self->replay_bytes > max_bytes)) {
+    self->replay_bytes -= self->replay_window.front().second;
+    self->replay_window.pop_front();
+  }
+}
+
+void ObsInterface::reset_marker_clock() {
+  std::lock_guard<std::mutex> lock(marker_mutex);
+  marker_clock_usec = -1;
+  marker_keyframes.clear();
+}
+
+int ObsInterface::start_markers(int64_t offset_usec, bool exact, const std::string& stem) {
+  std::lock_guard<std::mutex> lock(marker_mutex);
+  markers.clear();
+  marker_recording = true;
+  marker_start_usec = -1;
+  trim_usec = 0;
+  marker_path = buffering ? "" : unbuffered_output_filename;
+  marker_stem = stem;
+
+  if (!buffering)
+    return 0; // Starts on the first packet.
+
+  // convert only takes whole seconds and cuts on the newest keyframe at
+  // or before that far back, or the earliest it holds. Reach back at least
+  // as far as asked, then further while the cut sits so close to the next
+  // keyframe that packets arriving before convert runs could push it over.
+  int64_t requested = marker_clock_usec - offset_usec;
+  int seconds = (int)ceil(offset_usec / 1000000.0);
+  int64_t keyframe = -1;
+
+  for (;; seconds++) {
+    int64_t cut = marker_clock_usec - seconds * 1000000LL;
+    int64_t next = -1;
+    keyframe = -1;
+
+    for (int64_t k : marker_keyframes) {
+      if (k > cut && keyframe >= 0) {
+        next = k;
+        break;
+      }
+
+      keyframe = k;
+    }
+
+    if (seconds >= REPLAY_MAX_TIME_SEC || keyframe > cut || next < 0 || next - cut >= CUT_MARGIN_USEC)
+      break;
+  }
+
+  if (keyframe < 0) {
+    // No video yet, leave it to the replay buffer.
+    return (int)ceil(offset_usec / 1000000.0);
+  }
+
+  // Everything is measured from the keyframe the cut will hit.
+  marker_start_usec = keyframe;
+
+  if (exact && requested > keyframe) {
+    trim_usec = requested - keyframe;
+    marker_start_usec = requested;
+  }
+
+  blog(LOG_INFO, "Recording from the keyframe %.3f seconds back, %.3f seconds before the requested start%s",
+    (marker_clock_usec - keyframe) / 1000000.0, std::max<int64_t>(requested - keyframe, 0) / 1000000.0,
+    trim_usec ? ", which an edit list will skip" : "");
+
+  return seconds;
+}
+
+bool ObsInterface::addMarker(const std::string& label, double* seconds) {
+  std::lock_guard<std::mutex> lock(marker_mutex);
+
+  if (!marker_recording) {
+    blog(LOG_WARNING, "Not recording, ignoring marker: %s", label.c_str());
+    return false;
+  }
+
+  int64_t usec = 0;
+
+  if (marker_start_usec >= 0)
+    usec = std::max<int64_t>(marker_clock_usec - marker_start_usec, 0);
+
+  markers.push_back({ usec, label });
+  *seconds = usec / 1000000.0;
+
+  blog(LOG_INFO, "Marker %s at %.3f seconds", label.c_str(), *seconds);
+  return true;
+}
+
+void ObsInterface::cancel_markers() {
+  std::lock_guard<std::mutex> lock(marker_mutex);
+  marker_recording = false;
+  marker_start_usec = -1;
+  trim_usec = 0;
+  markers.clear();
+  marker_path = "";
+  marker_stem = "";
+}
+
+void ObsInterface::finish_recording(long long code) {
+  std::vector<Marker> done;
+  std::string path;
+  std::string stem;
+  int64_t trim = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(marker_mutex);
+
+    if (!marker_recording)
+      return;
+
+    marker_recording = false;
+    done.swap(markers);
+    path = marker_path;
+    stem = marker_stem;
+    trim = trim_usec;
+  }
+
+  if (code != OBS_OUTPUT_SUCCESS) {
+    if (!done.empty() || trim)
+      blog(LOG_WARNING, "Recording failed, not editing it");
+
+    return;
+  }
+
+  if (path.empty()) {
+    path = getLastRecording();
+
+    // The replay buffer only names its file as it writes it, so bring the
+    // snapshots taken meanwhile into line.
+    if (!path.empty())
+      rename_snapshots(stem, path.substr(0, path.find_last_of('.')));
+  }
+
+  if (done.empty() && !trim)
+    return;
+
+  if (path.empty()) {
+    blog(LOG_ERROR, "No recording to edit");
+    return;
+  }
+
+  if (trim) {
+    ScopeTimer timer("Writing edit list");
+    mp4_trim_start(path, trim);
+  }
+
+  if (done.empty())
+    return;
+
+  std::vector<Mp4Chapter> chapters;
+
+  for (const Marker& marker : done)
+    chapters.push_back({ marker.usec, marker.label });
+
+  if (done.size() > MP4_MAX_CHAPTERS)
+    blog(LOG_WARNING, "Too many markers for MP4 chapters, only the first %d are written", MP4_MAX_CHAPTERS);
+
+  ScopeTimer timer("Writing markers");
+  mp4_add_chapters(path, chapters);
+
+  // And a sidecar with the full labels, named like the other side files.
+  obs_data_t* data = obs_data_create();
+  obs_data_array_t* array = obs_data_array_create();
+
+  for (const Marker& marker : done) {
+    obs_data_t* item = obs_data_create();
+    obs_data_set_double(item, "time", marker.usec / 1000000.0);
+    obs_data_set_string(item, "label", marker.label.c_str());
+    obs_data_array_push_back(array, item);
+    obs_data_release(item);
+  }
+
+  obs_data_set_string(data, "recording", path.c_str());
+  obs_data_set_array(data, "markers", array);
+  obs_data_array_release(array);
+
+  stem = path.substr(0, path.find_last_of('.'));
+  const char* json = obs_data_get_json(data);
+  write_file(stem + "-markers.json", std::vector<uint8_t>(json, json + strlen(json)));
+  obs_data_release(data);
+}
+
+void ObsInterface::marker_packet_callback(obs_output_t *output, encoder_packet *pkt, encoder_packet_time *pkt_time, void *param) {
+  if (pkt->type != OBS_ENCODER_VIDEO)
+    return;
+
+  ObsInterface* self = (ObsInterface*)param;
+  std::lock_guard<std::mutex> lock(self->marker_mutex);
+  self->marker_clock_usec = pkt->dts_usec;
+
+  if (self->marker_recording && self->marker_start_usec < 0)
+    self->marker_start_usec = pkt->dts_usec;
+
+  if (!pkt->keyframe)
+    return;
+
+  self->marker_keyframes.push_back(pkt->dts_usec);
+
+  // Keep the one keyframe before the window too, the buffer starts there.
+  const int64_t max_usec = REPLAY_MAX_TIME_SEC * 1000000LL;
+
+  while (self->marker_keyframes.size() > 1 && pkt->dts_usec - self->marker_keyframes[1] >= max_usec)
+    self->marker_keyframes.pop_front();
+}
+
+void ObsInterface::zeroVolmeter(std::string_view name) {
+  blog(LOG_INFO, "Zeroing volmeter for %.*s", (int)name.size(), name.data());
+  SignalData* sd = new SignalData{ "volmeter", std::string(name), 0, 0 };
   jscb.NonBlockingCall(sd, call_jscb);
 }
@@ -2,24 +2,75 @@
 
 #include <obs.h>
 #include <napi.h>
-#include <windows.h>
 #include <map>
+#include <deque>
+#include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "preview_window.h"
+#include "slice_pool.h"
+#include "audio_meter.h"
+#include "mem_stats.h"
+#include "process_watcher.h"
 
 #define AUDIO_INPUT "wasapi_input_capture"
 #define AUDIO_OUTPUT "wasapi_output_capture"
 #define AUDIO_PROCESS "wasapi_process_output_capture"
+#define BASE_SCENE "Base Scene"
+#define GAME_CAPTURE "game_capture"
+#define WINDOW_CAPTURE "window_capture"
+#define CAPTURE_WATCH_INTERVAL_MS 2000 // Default gap between process list scans.
+#define KEYINT_BUFFERING_SEC 1 // Keyframe spacing is the precision a buffer can be cut to.
+#define KEYINT_RECORDING_SEC 2
+#define KEYINT_MAX_SEC 20 // As far as the OBS settings go.
+
+// Doubles per source in the typed array transform calls: x, y, scaleX,
+// scaleY, cropLeft, cropRight, cropTop, cropBottom, then width and height
+// before scaling. Setting only reads the first eight.
+#define SOURCE_TRANSFORM_STRIDE 10
 
 class ObsInterface;
 
 struct SignalData {
+  // Counted from here until call_jscb frees it on the JS thread.
+  SignalData(std::string type, std::string id, long long code, std::optional<float> value = std::nullopt)
+    : type(std::move(type)), id(std::move(id)), code(code), value(value) { mem_stats::signals.alloc(); }
+  SignalData(const SignalData&) = delete;
+  SignalData& operator=(const SignalData&) = delete;
+  ~SignalData() { mem_stats::signals.free(); }
+
   std::string type;
   std::string id;
   long long code;
   std::optional<float> value;
 };
 
+struct MemoryStats {
+  long libobsAllocs; // Live bmalloc allocations.
+  uint64_t residentBytes;
+  uint64_t peakResidentBytes;
+  uint64_t virtualBytes;
+  uint64_t replayBufferBytes; // Estimated, from the packets the replay buffer has been sent.
+  std::map<std::string, size_t> registry; // Entries in each of the source maps.
+};
+
+struct SceneSnapshot {
+  uint64_t version; // Scene version the walk started at.
+  std::vector<const char*> names; // Held by libobs, valid until the source is deleted.
+  std::vector<double> transforms; // SOURCE_TRANSFORM_STRIDE doubles per item.
+  std::vector<uint8_t> visible;
+};
+
+struct CaptureRule {
+  std::string exe; // Executable to watch for, case insensitive, e.g. "WowClassic.exe".
+  std::string source; // Game or window capture source to point at it.
+};
+
 struct SignalContext {
   ObsInterface* self;
   std::string id;
@@ -30,6 +81,22 @@ struct PreviewInfo {
   uint32_t displayWidth, displayHeight;
 };
 
+struct VideoContext {
+  uint32_t fpsNum, fpsDen;
+  uint32_t baseWidth, baseHeight; // Canvas size, sources are positioned in this space.
+  uint32_t outputWidth, outputHeight; // Size the encoders receive.
+  obs_scale_type scaleType; // Filter used to scale from base to output.
+};
+
+struct OutlineRect {
+  float x, y, cx, cy;
+};
+
+struct SnapshotFrame {
+  std::vector<uint8_t> y, uv; // NV12 planes, tightly packed.
+  std::string path;
+};
+
 struct SourceSize {
   uint32_t width;
   uint32_t height;
@@ -46,69 +113,137 @@ class ObsInterface {
     ~ObsInterface();
 
     void startBuffering(); // Start buffering to memory.
-    void startRecording(int offset); // Convert the active buffered recording to a real one.
+    void startRecording(double offset, bool exact); // Convert the active buffered recording to a real one, from offset seconds back. Exact starts there rather than on the keyframe before.
     void stopRecording(); // Stop the recording.
     void forceStopRecording(); // Force stop the recording, this will not save the current recording.
     std::string getLastRecording(); // Get the last recorded file path.
+    bool addMarker(const std::string& label, double* seconds); // Mark the current point of the recording, in seconds into the file. False if not recording.
     void setBuffering(bool buffer); // Enable or disable buffering.
+    void setKeyframeInterval(uint32_t bufferingSec, uint32_t recordingSec); // Keyframe spacing for each mode, whatever the encoder. 0 leaves it to the encoder settings.
     void setRecordingDir(const std::string& recordingPath); // Set the recording path.
-    void setVideoContext(int fps, int width, int height); // Reset video settings.
+    void setVideoContext(VideoContext ctx); // Reset video settings.
+    void setAudioContext(int sampleRate, int channels); // Reset audio settings.
 
     std::string createSource(std::string name, std::string type); // Create a new source, returns the name of the source which can vary from the requested.
+    void setLazySources(bool enabled); // Defer creating new video sources until they're added to a scene or prewarmed.
+    void prewarmSource(std::string name); // Create a deferred source now, so adding it to a scene later doesn't wait on it.
     void deleteSource(std::string name); // Release a source.
-    obs_data_t* getSourceSettings(std::string name); // Get the current settings.
-    void setSourceSettings(std::string name, obs_data_t* settings); // Set settings.
-    obs_properties_t* getSourceProperties(std::string name); // Get the settings schema.
+    obs_data_t* getSourceSettings(std::string_view name); // Get the current settings.
+    void setSourceSettings(std::string_view name, obs_data_t* settings); // Set settings.
+    obs_properties_t* getSourceProperties(std::string_view name); // Get the settings schema.
     void setMuteAudioInputs(bool mute); // Mute or unmute all audio inputs.
-    void setSourceVolume(std::string name, float volume); // Set the volume of an audio source.
+    void setSourceVolume(std::string_view name, float volume); // Set the volume of an audio source.
+    void setSourceAudioTrack(std::string name, int track); // Assign an audio source to a track in the output file.
     void setVolmeterEnabled(bool enabled); // Enable volmeters.
     void setAudioSuppression(bool enabled); // Enable audio suppression.
     void setForceMono(bool enabled); // Enable force mono audio.
+    void setCaptureRules(const std::vector<CaptureRule>& rules, uint32_t intervalMs); // Retarget capture sources as matching processes start, empty stops watching.
 
+    void createScene(std::string name); // Add an empty scene. It's kept showing so its sources are warm when selected.
+    void deleteScene(std::string name); // The base scene can't be deleted. Deleting the selected scene selects the base scene.
+    void selectScene(std::string name); // Output this scene from the next frame on, without touching the outputs.
+    std::vector<std::string> listScenes(); // Names of all scenes, base scene included.
+    std::string getCurrentScene(); // Name of the selected scene, which the scene item calls below act on.
     void addSourceToScene(std::string name); // Add source to scene.
     void removeSourceFromScene(std::string name); // Remove source from scene.
-    void getSourcePos(std::string name, vec2* pos, vec2* size, vec2* scale, obs_sceneitem_crop* crop); // Size is returned to allow clients to calculate scale.
-    void setSourcePos(std::string name, vec2* pos, vec2* scale, obs_sceneitem_crop* crop); // Size does not get set here because it's set by the source itself.
+    void getSourcePos(std::string_view name, vec2* pos, vec2* size, vec2* scale, obs_sceneitem_crop* crop); // Size is returned to allow clients to calculate scale.
+    void setSourcePos(std::string_view name, vec2* pos, vec2* scale, obs_sceneitem_crop* crop); // Size does not get set here because it's set by the source itself.
+    bool getSourceTransform(std::string_view name, double* out); // One SOURCE_TRANSFORM_STRIDE record, false if the source is not in the scene.
+    size_t getSceneTransforms(double* out, size_t capacity, std::vector<const char*>& names); // A record per scene item in draw order, up to capacity. Returns the item count.
+    uint64_t getSceneVersion(); // Goes up whenever a scene item is added, removed, moved or resized.
+    void getSceneSnapshot(SceneSnapshot& snapshot); // Every scene item in draw order, in one walk of the scene.
 
-    void initPreview(HWND parent); // Must call this before showPreview to setup resources.
+    void initPreview(void* parent); // Must call this before showPreview to setup resources.
     void configurePreview(int x, int y, int width, int height); // Move and resize the preview display.
     void showPreview(); // Show the preview display.
     void hidePreview(); // Hide the preview display, but leave it running.
     void disablePreview(); // Disable the preview display, to save resources.
+    void setPreviewFps(uint32_t fps, bool autoFps); // Cap the preview draw rate, 0 draws every frame. Auto backs off when frames lag.
     PreviewInfo getPreviewInfo(); // Get the dimensions of the display, and the base canvas.
+    void startFramePreview(uint32_t width, uint32_t height, uint32_t divisor); // Windowless preview, every divisor'th frame scaled to RGBA.
+    void stopFramePreview();
+    size_t getFramePreviewSize(); // Bytes in one frame, 0 when stopped.
+    uint64_t readFramePreview(uint8_t* dst, uint64_t lastSeq); // Copy the latest frame if newer than lastSeq, returns its sequence number.
     void setDrawSourceOutline(bool enabled); // Red box around source
     bool getDrawSourceOutlineEnabled();
+    void drawSourceOutlines(); // Called from the draw callback, graphics context must be held.
 
     std::vector<std::string> listAvailableVideoEncoders(); // Return a list of available video encoders.
     void setVideoEncoder(std::string id, obs_data_t* settings); // Set the video encoder to use.
+    std::vector<std::string> listAvailableAudioEncoders(); // Return a list of available audio encoders.
+    void setAudioEncoder(std::string id, obs_data_t* settings); // Set the audio encoder to use for all tracks.
+    void setProxyEncoder(std::string id, obs_data_t* settings, int width, int height); // Write a scaled proxy file alongside each recording.
+    void clearProxyEncoder(); // Stop writing proxy files.
+    std::string getLastProxyRecording(); // Get the last proxy file path.
+    void setSnapshots(uint32_t intervalSec, uint32_t width, uint32_t height); // Write a JPEG on start and every interval while recording, 0 disables.
+    std::vector<std::string> getLastSnapshots(); // Files written for the most recent recording.
+    bool getAudioLevels(std::string name, MeterLevels& levels); // Levels since the last call, false if the source has no meter.
+    MemoryStats getMemoryStats(); // Cheap enough to poll, nothing is walked but our own maps.
 
-    std::map<std::string, obs_source_t*> sources; // Map of source names to obs_source_t pointers. 
-    std::map<std::string, SourceSize> sizes; // Map of source names to their last known size, used for firing callbacks on size changes. 
-    std::map<std::string, obs_volmeter_t*> volmeters; // Map of source names to obs_volmeter_t pointers.
-    std::map<std::string, SignalContext*> volmeter_cb_ctx; // Map of volmeter callback contexts.
-    std::map<std::string, obs_source_t*> filters; // Map of source names to obs_source_t filter pointers.
+    // The maps compare transparently so a std::string_view name can look
+    // them up without copying it into a std::string first.
+    std::map<std::string, obs_source_t*, std::less<>> sources; // Map of source names to obs_source_t pointers. 
+    std::map<std::string, SourceSize, std::less<>> sizes; // Map of source names to their last known size, used for firing callbacks on size changes. 
+    std::map<std::string, obs_volmeter_t*, std::less<>> volmeters; // Map of source names to obs_volmeter_t pointers.
+    std::map<std::string, SignalContext*, std::less<>> volmeter_cb_ctx; // Map of volmeter callback contexts.
+    std::map<std::string, AudioMeter*, std::less<>> audio_meters; // Map of audio source names to our own meters, fed by audio capture callbacks.
+    std::map<std::string, obs_source_t*, std::less<>> filters; // Map of source names to obs_source_t filter pointers.
+    std::map<std::string, int, std::less<>> audio_tracks; // Map of audio source names to their assigned track.
+    std::atomic<uint64_t> scene_version = 0; // Bumped from the JS thread on scene changes, and the graphics thread on resizes.
 
     void sourceCallback(std::string name); // Send callback for source change.
-    void zeroVolmeter(std::string name); // Zero the volmeter for a source.
+    void zeroVolmeter(std::string_view name); // Zero the volmeter for a source.
 
   private:
     obs_output_t *output = nullptr;
-    obs_scene_t *scene = nullptr;
+    obs_scene_t *scene = nullptr; // The selected scene, output on channel 0.
+    std::map<std::string, obs_scene_t*, std::less<>> scenes; // Every scene by name, the selected one included.
 
     obs_encoder_t *video_encoder = nullptr;
-    obs_encoder_t *audio_encoder = nullptr;
+    obs_encoder_t *audio_encoders[MAX_AUDIO_MIXES] = {}; // One per active track, indexed by mixer.
+
+    obs_output_t *proxy_output = nullptr; // Only exists while a proxy encoder is set.
+    obs_encoder_t *proxy_video_encoder = nullptr;
     
     obs_display_t *display = nullptr;
-    HWND preview_hwnd = nullptr; // window handle for scene preview
+    PreviewWindow preview_window; // native child window for scene preview
+    std::atomic<bool> preview_active = false; // Preview is configured and should be drawing.
+    std::atomic<uint32_t> preview_fps = 0; // Target preview fps, 0 draws every canvas frame.
+    std::atomic<bool> preview_fps_auto = false; // Let preview_auto_fps follow lagged frames.
+    std::atomic<uint32_t> preview_auto_fps = 0; // Current rate in auto mode.
+    std::atomic<bool> preview_auto_restart = false; // The tick takes a fresh lagged frame baseline.
+    uint64_t preview_next_draw = 0; // Below here only touched from the tick callback.
+    uint64_t preview_lag_check = 0;
+    uint64_t preview_last_lag = 0;
+    uint32_t preview_lagged_frames = 0;
+    uint32_t update_auto_preview_fps(uint64_t now); // Adjust the auto rate, at most once a second.
+
+    std::mutex frame_mutex; // Guards the frame preview buffer and sequence.
+    std::vector<uint8_t> frame_buffer; // Latest frame preview, tightly packed RGBA. Allocated once per start.
+    uint64_t frame_seq = 0; // Bumped for every frame delivered, 0 before the first.
+    video_scale_info frame_scale = {};
+    uint32_t frame_divisor = 0; // 0 when the frame preview is stopped.
+    std::unique_ptr<SlicePool> frame_pool; // Splits conversion of large frame previews across cores, null for small ones.
+    void connect_frame_preview();
+    void disconnect_frame_preview();
+    static void frame_preview_callback(void *data, video_data *frame);
+    static void preview_tick(void *data, float seconds); // Enable the display only on frames we want drawn.
+    static void size_tick(void *data, float seconds); // Signal and bump the scene version when a source resizes.
     Napi::ThreadSafeFunction jscb; // javascript callback
     std::string recording_path = ""; 
     std::string unbuffered_output_filename = "";
 
     bool buffering = false; // Whether we are buffering the recording in memory.
     bool drawSourceOutline = false; // Draw red outline around source
+    gs_effect_t *outline_effect = nullptr; // Below here only touched on the graphics thread.
+    gs_eparam_t *outline_color = nullptr;
+    gs_technique_t *outline_tech = nullptr;
+    gs_vertbuffer_t *outline_vb = nullptr; // Dynamic, holds every outline quad for a frame.
+    size_t outline_vb_capacity = 0; // In vertices.
+    std::vector<OutlineRect> outline_rects; // Reused each frame to avoid allocating.
     void init_obs(const std::string& distPath);
-    int reset_video(int fps, int width, int height);
-    bool reset_audio();
+    int reset_video(const VideoContext& ctx);
+    bool reset_audio(uint32_t sample_rate, speaker_layout speakers);
     void load_module(const char* module, const char* data, bool allowFail); // Load a module, data is optional.
     void connect_signal_handlers(obs_output_t *output);
     void disconnect_signal_handlers(obs_output_t *output);
@@ -125,16 +260,118 @@ class ObsInterface {
     void list_output_types();
 
     void create_scene();
+    std::string create_source(const std::string& name, const std::string& type, obs_data_t* settings);
+    bool create_pending(std::string_view name); // Create a deferred source, false if it isn't one.
+    std::string unique_source_name(const std::string& name); // Free in libobs and among our sources, deferred ones included.
     void create_output();
+    void update_output_settings(); // Apply the mode specific settings, e.g. recording path.
+    void attach_encoders(); // Bind the existing encoders to the current output.
 
     std::string video_encoder_id = "obs_x264"; // The video encoder ID to use.
     obs_data_t* video_encoder_settings = obs_data_create(); // Settings for the video encoder.
     void create_video_encoders();
+    uint32_t keyint_buffering_sec = KEYINT_BUFFERING_SEC; // 0 leaves the keyframe interval to the encoder settings.
+    uint32_t keyint_recording_sec = KEYINT_RECORDING_SEC;
+    uint32_t keyframe_interval() const; // For the current mode.
+    static void set_keyint(obs_data_t* settings, const std::string& id, uint32_t seconds); // In the encoder's own settings key.
+    std::string audio_encoder_id = "ffmpeg_aac"; // The audio encoder ID to use.
+    obs_data_t* audio_encoder_settings = obs_data_create(); // Settings for the audio encoders.
     void create_audio_encoders();
 
+    uint32_t active_audio_mixers = 0; // Mixers that currently have an encoder.
+    bool audio_tracks_dirty = false; // Track assignment changed while the output was active.
+    uint32_t get_active_audio_mixers(); // Mixers that have at least one source assigned.
+    obs_encoder_t* get_first_audio_encoder();
+    void update_audio_tracks();
+    void attach_audio_encoders();
+
+    std::string proxy_encoder_id = ""; // Empty when no proxy is configured.
+    obs_data_t* proxy_encoder_settings = nullptr; // Settings for the proxy video encoder.
+    uint32_t proxy_width = 0;
+    uint32_t proxy_height = 0;
+    std::string proxy_output_filename = "";
+    void create_proxy_encoders();
+    void release_proxy();
+    void start_proxy();
+
+    uint64_t snapshot_interval_ns = 0; // 0 when snapshots are disabled.
+    video_scale_info snapshot_scale = {};
+    bool snapshot_connected = false; // Raw video callback is attached, only while recording.
+    std::atomic<bool> snapshot_pending = false; // Take one on the next frame, e.g. at the start of a recording.
+    std::atomic<uint64_t> snapshot_next = 0; // Time the next periodic snapshot is due.
+    std::atomic<uint64_t> snapshot_not_before = 0; // Holds captures back to keep the encoder within its CPU budget.
+    std::mutex snapshot_mutex; // Guards everything below.
+    std::condition_variable snapshot_cv;
+    std::vector<SnapshotFrame*> snapshot_free; // Preallocated frames, when empty new snapshots are dropped.
+    std::vector<SnapshotFrame*> snapshot_queue; // Waiting to be encoded.
+    std::vector<std::string> snapshot_files; // Written for the current recording.
+    std::string snapshot_stem; // Recording path without the extension.
+    uint32_t snapshot_index = 0;
+    bool snapshot_exit = false;
+    bool snapshot_writing = false; // The worker has a frame out of the queue.
+    std::thread snapshot_thread;
+    void start_snapshots(const std::string& stem); // Attach to video for a new recording.
+    void stop_snapshots(); // Detach from video, queued snapshots are still written.
+    void rename_snapshots(const std::string& from, const std::string& to); // Once the queue drains, for a replay buffer file named when it was written.
+    void connect_snapshots();
+    void stop_snapshot_worker(); // Drains the queue and frees the frames.
+    void snapshot_worker();
+    static void snapshot_callback(void *data, video_data *frame);
+
+    std::mutex replay_mutex; // Guards the replay window, packets arrive on the output thread.
+    std::deque<std::pair<int64_t, size_t>> replay_window; // DTS in microseconds and size of each packet the buffer holds.
+    uint64_t replay_bytes = 0; // Sum of the sizes in replay_window.
+    bool replay_converted = false; // Once converted the buffer writes packets out rather than holding them.
+    void reset_replay_window(bool converted);
+    static void replay_packet_callback(obs_output_t *output, encoder_packet *pkt, encoder_packet_time *pkt_time, void *param);
+
+    struct Marker {
+      int64_t usec; // From the start of the file.
+      std::string label;
+    };
+
+    std::mutex marker_mutex; // Guards everything below, packets arrive on the output thread.
+    bool marker_recording = false; // From a recording starting until its stop signal.
+    int64_t marker_clock_usec = -1; // DTS of the newest video packet, -1 before the first.
+    int64_t marker_start_usec = -1; // DTS the file's presentation starts at, -1 until known.
+    int64_t trim_usec = 0; // For an exact start, how far past the first keyframe the presentation starts.
+    std::deque<int64_t> marker_keyframes; // Video keyframe DTS the replay buffer may still hold, to find where a conversion starts.
+    std::vector<Marker> markers; // For the current recording.
+    std::string marker_path; // The ffmpeg_muxer file, the replay buffer is asked for its path at the end.
+    std::string marker_stem; // What the side files were named with at the start.
+    void reset_marker_clock(); // When the output starts afresh.
+    int start_markers(int64_t offset_usec, bool exact, const std::string& stem); // Work out where the file starts. Returns the whole seconds that make the replay buffer cut there.
+    void cancel_markers(); // When a recording fails to start, so no stop signal will come.
+    void finish_recording(long long code); // From the stop signal, writes the edit list, chapters and marker sidecar.
+    static void marker_packet_callback(obs_output_t *output, encoder_packet *pkt, encoder_packet_time *pkt_time, void *param);
+
     bool volmeter_enabled = false; // Whether the volmeter callback is enabled.
     bool audio_suppression = false; // Whether audio suppression is enabled.
     bool force_mono = false; // Whether force mono audio is enabled.
+    bool lazy_sources = false; // Whether new video sources are deferred.
+
+    struct PendingSource {
+      std::string type;
+      obs_data_t* settings; // Applied when it's created.
+    };
+
+    std::map<std::string, PendingSource, std::less<>> pending_sources; // Deferred sources, which libobs doesn't know about yet.
+
+    struct CaptureTarget {
+      ObsInterface* self; // For the hook signals.
+      std::string name;
+      std::string exe;
+      obs_source_t* source; // Our own reference, so deleting the source can't pull it from under the watcher.
+      bool game; // Game capture, otherwise window capture.
+    };
+
+    std::deque<CaptureTarget> capture_targets; // One per capture rule, a deque so the hook signals can point at them. Only changed while there's no watcher.
+    uint32_t capture_interval_ms = CAPTURE_WATCH_INTERVAL_MS;
+    std::unique_ptr<ProcessWatcher> process_watcher; // Null when there are no rules.
+    void stop_process_watcher(); // Also disconnects and releases the targets.
+    void capture_callback(size_t index, const ProcessWindow* window); // From the watcher thread.
+    static void capture_hooked(void *data, calldata_t *cd);
+    static void capture_unhooked(void *data, calldata_t *cd);
 
     static void volmeter_callback(
       void *data, 
@@ -142,4 +379,6 @@ class ObsInterface {
       const float peak[MAX_AUDIO_CHANNELS], 
       const float inputPeak[MAX_AUDIO_CHANNELS]
     );
+
+    static void audio_capture_callback(void *param, obs_source_t *source, const audio_data *audio, bool muted);
 };
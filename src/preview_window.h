@@ -0,0 +1,21 @@
+#pragma once
+
+#include <graphics/graphics.h>
+
+// Native child window the preview display is drawn into. The platform
+// specific parts live in preview_window_<platform>.cpp, the rest of the
+// addon only ever sees an opaque parent handle.
+class PreviewWindow {
+  public:
+    ~PreviewWindow();
+
+    bool create(void* parent); // Create as a hidden child of parent, no-op if already created.
+    bool move(int x, int y, int width, int height);
+    void show();
+    void hide();
+    bool valid() const { return handle != nullptr; }
+    void fill(gs_window& window) const; // Point a libobs window description at this window.
+
+  private:
+    void* handle = nullptr;
+};
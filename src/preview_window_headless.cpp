@@ -0,0 +1,24 @@
+#include "preview_window.h"
+#include <obs.h>
+
+// Headless builds (CI, benchmarking) have no windowing system to attach a
+// preview to, so every call fails softly and the display is never created.
+
+PreviewWindow::~PreviewWindow() {}
+
+bool PreviewWindow::create(void* parent) {
+  blog(LOG_WARNING, "Preview is not supported in headless builds");
+  return false;
+}
+
+bool PreviewWindow::move(int x, int y, int width, int height) {
+  return false;
+}
+
+void PreviewWindow::show() {}
+
+void PreviewWindow::hide() {}
+
+void PreviewWindow::fill(gs_window& window) const {
+  window = {};
+}
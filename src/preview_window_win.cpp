@@ -0,0 +1,62 @@
+#include "preview_window.h"
+#include <windows.h>
+#include <obs.h>
+
+PreviewWindow::~PreviewWindow() {
+  if (handle) {
+    DestroyWindow((HWND)handle);
+    handle = nullptr;
+  }
+}
+
+bool PreviewWindow::create(void* parent) {
+  if (handle)
+    return true;
+
+  blog(LOG_INFO, "Creating preview child window");
+
+  handle = CreateWindowExA(
+    0,                      // No extended styles
+    "STATIC",               // Simple static control class (ANSI string)
+    "OBS Preview",          // Window name (ANSI string)
+    WS_CHILD | WS_BORDER,   // Child + border, NOT visible initially
+    0, 0,                   // Initial position (x, y)
+    0, 0,                   // Initial size (width, height)
+    (HWND)parent,           // Parent window (your Electron app)
+    NULL,                   // No menu
+    GetModuleHandle(NULL),
+    NULL
+  );
+
+  if (!handle) {
+    blog(LOG_ERROR, "Failed to create preview child window");
+    return false;
+  }
+
+  return true;
+}
+
+bool PreviewWindow::move(int x, int y, int width, int height) {
+  // Resize and move the existing child window.
+  return SetWindowPos(
+    (HWND)handle,                  // Handle to the child window
+    NULL,                          // No Z-order change
+    x, y,                          // New position (x, y)
+    width, height,                 // New size (width, height)
+    SWP_NOACTIVATE                 // Flags
+  );
+}
+
+void PreviewWindow::show() {
+  if (handle)
+    ShowWindow((HWND)handle, SW_SHOW);
+}
+
+void PreviewWindow::hide() {
+  if (handle)
+    ShowWindow((HWND)handle, SW_HIDE);
+}
+
+void PreviewWindow::fill(gs_window& window) const {
+  window.hwnd = handle;
+}
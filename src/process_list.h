@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A top level window and the process that owns it, everything a game or
+// window capture needs to target it. The platform specific parts live in
+// process_list_<platform>.cpp.
+struct ProcessWindow {
+  uint32_t pid;
+  std::string exe; // File name only, e.g. "WowClassic.exe".
+  std::string title;
+  std::string window_class;
+};
+
+std::vector<ProcessWindow> list_process_windows(); // Visible top level windows, in no particular order.
@@ -0,0 +1,68 @@
+#include "process_list.h"
+#include <windows.h>
+#include <tlhelp32.h>
+#include <unordered_map>
+
+static std::string to_utf8(const wchar_t* str) {
+  int length = WideCharToMultiByte(CP_UTF8, 0, str, -1, nullptr, 0, nullptr, nullptr);
+
+  if (length <= 1)
+    return "";
+
+  std::string out(length - 1, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, str, -1, out.data(), length, nullptr, nullptr);
+  return out;
+}
+
+struct EnumContext {
+  const std::unordered_map<DWORD, std::string>* exes;
+  std::vector<ProcessWindow>* windows;
+};
+
+static BOOL CALLBACK enum_window(HWND hwnd, LPARAM param) {
+  EnumContext* ctx = (EnumContext*)param;
+
+  // Only what the capture properties would list: visible windows that
+  // aren't owned by another, i.e. not dialogs or tool windows.
+  if (!IsWindowVisible(hwnd) || GetWindow(hwnd, GW_OWNER))
+    return TRUE;
+
+  DWORD pid = 0;
+  GetWindowThreadProcessId(hwnd, &pid);
+  auto it = ctx->exes->find(pid);
+
+  if (it == ctx->exes->end())
+    return TRUE;
+
+  wchar_t title[256];
+  wchar_t window_class[256];
+  GetWindowTextW(hwnd, title, 256);
+  GetClassNameW(hwnd, window_class, 256);
+
+  ctx->windows->push_back({ (uint32_t)pid, it->second, to_utf8(title), to_utf8(window_class) });
+  return TRUE;
+}
+
+std::vector<ProcessWindow> list_process_windows() {
+  std::vector<ProcessWindow> windows;
+
+  // One snapshot for every exe name, much cheaper than opening each
+  // window's process to ask for its image.
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+
+  if (snapshot == INVALID_HANDLE_VALUE)
+    return windows;
+
+  std::unordered_map<DWORD, std::string> exes;
+  PROCESSENTRY32W entry = {};
+  entry.dwSize = sizeof(entry);
+
+  for (BOOL ok = Process32FirstW(snapshot, &entry); ok; ok = Process32NextW(snapshot, &entry))
+    exes[entry.th32ProcessID] = to_utf8(entry.szExeFile);
+
+  CloseHandle(snapshot);
+
+  EnumContext ctx = { &exes, &windows };
+  EnumWindows(enum_window, (LPARAM)&ctx);
+  return windows;
+}
@@ -0,0 +1,105 @@
+#include "process_watcher.h"
+#include <algorithm>
+#include <cctype>
+
+#define MIN_INTERVAL_MS 100 // A scan walks every process, don't let it spin.
+
+static std::string to_lower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+  return str;
+}
+
+// The capture sources split the window setting on ':', so each part has
+// '#' and ':' escaped the way libobs' window helpers do.
+static void append_escaped(std::string& out, const std::string& part) {
+  for (char c : part) {
+    if (c == '#')
+      out += "#22";
+    else if (c == ':')
+      out += "#3A";
+    else
+      out += c;
+  }
+}
+
+std::string window_spec(const ProcessWindow& window) {
+  std::string spec;
+  append_escaped(spec, window.title);
+  spec += ':';
+  append_escaped(spec, window.window_class);
+  spec += ':';
+  append_escaped(spec, window.exe);
+  return spec;
+}
+
+ProcessWatcher::ProcessWatcher(const std::vector<std::string>& names, uint32_t interval, Callback cb)
+  : matched(names.size(), 0), interval_ms(std::max<uint32_t>(interval, MIN_INTERVAL_MS)), callback(std::move(cb)) {
+  for (const std::string& name : names)
+    exes.push_back(to_lower(name));
+
+  thread = std::thread(&ProcessWatcher::watcher_main, this);
+}
+
+ProcessWatcher::~ProcessWatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    exit = true;
+  }
+
+  exit_cv.notify_all();
+  thread.join();
+}
+
+void ProcessWatcher::scan() {
+  std::vector<ProcessWindow> windows = list_process_windows();
+  std::vector<std::string> lower; // Exe names to match, the windows keep their case for the spec.
+
+  for (const ProcessWindow& window : windows)
+    lower.push_back(to_lower(window.exe));
+
+  for (size_t i = 0; i < exes.size(); i++) {
+    const ProcessWindow* found = nullptr;
+
+    // Stick with the process we matched while it has a window, rather
+    // than flip between two instances of the same exe.
+    for (size_t w = 0; w < windows.size(); w++) {
+      const ProcessWindow& window = windows[w];
+
+      if (lower[w] != exes[i])
+        continue;
+
+      if (window.pid == matched[i]) {
+        found = &window;
+        break;
+      }
+
+      if (!found)
+        found = &window;
+    }
+
+    if (found && found->pid == matched[i])
+      continue;
+
+    if (matched[i]) {
+      matched[i] = 0;
+      callback(i, nullptr);
+    }
+
+    if (found) {
+      matched[i] = found->pid;
+      callback(i, found);
+    }
+  }
+}
+
+void ProcessWatcher::watcher_main() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (!exit) {
+    lock.unlock();
+    scan();
+    lock.lock();
+
+    exit_cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] { return exit; });
+  }
+}
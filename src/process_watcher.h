@@ -0,0 +1,40 @@
+#pragma once
+
+#include "process_list.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scans the process list on its own thread and reports when a process
+// matching one of the executables appears or goes away, so the app
+// doesn't have to poll the process list itself. The executables are fixed
+// for the watcher's lifetime, make a new one to change them.
+class ProcessWatcher {
+  public:
+    // Called on the watcher thread with the index of the executable, and
+    // the window that matched or null once that process has no window left.
+    typedef std::function<void(size_t, const ProcessWindow*)> Callback;
+
+    ProcessWatcher(const std::vector<std::string>& exes, uint32_t interval_ms, Callback callback);
+    ~ProcessWatcher(); // Joins the thread, there are no callbacks once it returns.
+
+  private:
+    std::vector<std::string> exes; // Lower case, matched against the lower cased exe name.
+    std::vector<uint32_t> matched; // Pid each exe is matched to, 0 when it isn't.
+    uint32_t interval_ms;
+    Callback callback;
+
+    std::mutex mutex; // Guards exit.
+    std::condition_variable exit_cv;
+    bool exit = false;
+    std::thread thread;
+
+    void scan();
+    void watcher_main();
+};
+
+std::string window_spec(const ProcessWindow& window); // The "title:class:exe" string the capture sources take.
@@ -0,0 +1,131 @@
+#include "slice_pool.h"
+#include <algorithm>
+
+#define BANDS_PER_THREAD 4 // Spare bands give the stealing something to balance.
+#define MIN_BAND_ROWS 16
+
+SlicePool::SlicePool(uint32_t count) {
+  for (uint32_t i = 0; i <= count; i++)
+    queues.push_back(std::make_unique<Queue>());
+
+  for (uint32_t i = 1; i <= count; i++)
+    workers.emplace_back(&SlicePool::worker_main, this, i);
+}
+
+SlicePool::~SlicePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    exit = true;
+  }
+
+  start_cv.notify_all();
+
+  for (std::thread& worker : workers)
+    worker.join();
+}
+
+uint32_t SlicePool::threads() const {
+  return (uint32_t)queues.size();
+}
+
+void SlicePool::run(uint32_t rows, uint32_t align, const std::function<void(uint32_t, uint32_t)>& fn) {
+  uint32_t participants = threads();
+  align = std::max<uint32_t>(align, 1);
+
+  uint32_t per_band = (rows + participants * BANDS_PER_THREAD - 1) / (participants * BANDS_PER_THREAD);
+  per_band = std::max<uint32_t>(per_band, MIN_BAND_ROWS);
+  per_band = (per_band + align - 1) / align * align;
+
+  if (participants == 1 || per_band >= rows) {
+    fn(0, rows);
+    return;
+  }
+
+  // Anything still looping from the last run only sees empty queues, so
+  // set up the job and count before any band becomes visible.
+  job = &fn;
+  remaining = (rows + per_band - 1) / per_band;
+
+  for (auto& queue : queues) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->bands.clear();
+    queue->head = 0;
+    queue->tail = 0;
+  }
+
+  uint32_t n = 0;
+
+  for (uint32_t start = 0; start < rows; start += per_band, n++) {
+    Queue& queue = *queues[n % participants];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.bands.push_back({ start, std::min(rows, start + per_band) });
+    queue.tail = queue.bands.size();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+  }
+
+  start_cv.notify_all();
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [this] { return remaining == 0; });
+  job = nullptr;
+}
+
+bool SlicePool::take(size_t index, Band& band) {
+  {
+    Queue& own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+
+    if (own.head < own.tail) {
+      band = own.bands[own.head++];
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < queues.size(); i++) {
+    Queue& victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+
+    if (victim.head < victim.tail) {
+      band = victim.bands[--victim.tail];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void SlicePool::work(size_t index) {
+  Band band;
+
+  while (take(index, band)) {
+    (*job)(band.start, band.end);
+
+    if (remaining.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(mutex);
+      done_cv.notify_all();
+    }
+  }
+}
+
+void SlicePool::worker_main(size_t index) {
+  uint64_t seen = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_cv.wait(lock, [&] { return exit || generation != seen; });
+
+      if (exit)
+        return;
+
+      seen = generation;
+    }
+
+    work(index);
+  }
+}
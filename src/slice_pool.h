@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits a frame into row bands and converts them in parallel. Each thread
+// has its own queue of bands and steals from the back of the others when it
+// runs dry, so one slow core doesn't hold up the frame. The calling thread
+// works too, so a pool of N workers uses N + 1 threads.
+class SlicePool {
+  public:
+    SlicePool(uint32_t workers);
+    ~SlicePool();
+
+    // Call fn(start_y, end_y) over [0, rows) and return when all bands are
+    // done. Band edges are multiples of align, e.g. 2 for NV12 chroma rows.
+    // Only one run at a time, callers must not overlap.
+    void run(uint32_t rows, uint32_t align, const std::function<void(uint32_t, uint32_t)>& fn);
+
+    uint32_t threads() const; // Including the caller.
+
+  private:
+    struct Band {
+      uint32_t start, end;
+    };
+
+    struct Queue {
+      std::mutex mutex;
+      std::vector<Band> bands;
+      size_t head = 0; // Owner pops here.
+      size_t tail = 0; // Thieves pop from here, one past the last band.
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // Index 0 is the caller's.
+    std::vector<std::thread> workers;
+
+    std::mutex mutex; // Guards generation and exit.
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation = 0;
+    bool exit = false;
+
+    const std::function<void(uint32_t, uint32_t)>* job = nullptr;
+    std::atomic<uint32_t> remaining{0};
+
+    bool take(size_t index, Band& band); // Own queue first, then steal.
+    void work(size_t index);
+    void worker_main(size_t index);
+};
@@ -3,8 +3,19 @@
 #include <fstream>
 #include <chrono>
 #include <iomanip>
+#include <cstring>
 #include <sstream>
+#include <util/platform.h>
 #include "utils.h"
+#include "arena.h"
+#include "mem_stats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
 
 void log_handler(int lvl, const char *msg, va_list args, void *p) {
   // Use the passed log path parameter
@@ -20,13 +31,7 @@ void log_handler(int lvl, const char *msg, va_list args, void *p) {
     
     // Use the provided directory path and append the filename
     std::string log_dir = static_cast<const char*>(p);
-
-    // Ensure the directory path ends with a separator
-    if (!log_dir.empty() && log_dir.back() != '\\' && log_dir.back() != '/') {
-      log_dir += "\\";
-    }
-
-    log_filename = log_dir + filename_stream.str();
+    log_filename = join_path(log_dir, filename_stream.str());
     filename_initialized = true;
   }
   
@@ -114,26 +119,32 @@ Napi::Object data_to_napi(Napi::Env env, obs_data_t* data) {
       
       case OBS_DATA_OBJECT: {
         obs_data_t *child_data = obs_data_item_get_obj(item);
+        mem_stats::conversions.alloc();
         Napi::Object child_obj = data_to_napi(env, child_data);
         obj.Set(name, child_obj);
         obs_data_release(child_data);
+        mem_stats::conversions.free();
         break;
       }
       
       case OBS_DATA_ARRAY: {
         obs_data_array_t *array = obs_data_item_get_array(item);
+        mem_stats::conversions.alloc();
         size_t count = obs_data_array_count(array);
         Napi::Array js_array = Napi::Array::New(env, count);
         
         for (size_t i = 0; i < count; i++) {
           obs_data_t *array_item = obs_data_array_item(array, i);
+          mem_stats::conversions.alloc();
           Napi::Object array_obj = data_to_napi(env, array_item);
           js_array.Set(i, array_obj);
           obs_data_release(array_item);
+          mem_stats::conversions.free();
         }
         
         obj.Set(name, js_array);
         obs_data_array_release(array);
+        mem_stats::conversions.free();
         break;
       }
       
@@ -157,8 +168,11 @@ obs_data_t* napi_to_data(Napi::Object obj) {
   Napi::Array prop_names = obj.GetPropertyNames();
   
   for (uint32_t i = 0; i < prop_names.Length(); i++) {
+    // The key and any string value only need to outlive the obs_data_set_*
+    // call, libobs keeps its own copies.
+    ArenaScope scope;
     Napi::Value key = prop_names.Get(i);
-    std::string name = key.As<Napi::String>().Utf8Value();
+    const char* name = arena_utf8(key).data();
     Napi::Value value = obj.Get(key);
     
     if (value.IsNull() || value.IsUndefined()) {
@@ -166,39 +180,44 @@ obs_data_t* napi_to_data(Napi::Object obj) {
       continue;
     }
     else if (value.IsString()) {
-      std::string str_val = value.As<Napi::String>().Utf8Value();
-      obs_data_set_string(data, name.c_str(), str_val.c_str());
+      obs_data_set_string(data, name, arena_utf8(value).data());
     }
     else if (value.IsNumber()) {
       double num_val = value.As<Napi::Number>().DoubleValue();
-      obs_data_set_double(data, name.c_str(), num_val);
+      obs_data_set_double(data, name, num_val);
     }
     else if (value.IsBoolean()) {
       bool bool_val = value.As<Napi::Boolean>().Value();
-      obs_data_set_bool(data, name.c_str(), bool_val);
+      obs_data_set_bool(data, name, bool_val);
     }
     else if (value.IsObject() && !value.IsArray()) {
       Napi::Object child_obj = value.As<Napi::Object>();
       obs_data_t* child_data = napi_to_data(child_obj);
-      obs_data_set_obj(data, name.c_str(), child_data);
+      mem_stats::conversions.alloc();
+      obs_data_set_obj(data, name, child_data);
       obs_data_release(child_data);
+      mem_stats::conversions.free();
     }
     else if (value.IsArray()) {
       Napi::Array js_array = value.As<Napi::Array>();
       obs_data_array_t* array = obs_data_array_create();
+      mem_stats::conversions.alloc();
       
       for (uint32_t j = 0; j < js_array.Length(); j++) {
         Napi::Value array_item = js_array.Get(j);
         if (array_item.IsObject()) {
           Napi::Object array_obj = array_item.As<Napi::Object>();
           obs_data_t* array_data = napi_to_data(array_obj);
+          mem_stats::conversions.alloc();
           obs_data_array_push_back(array, array_data);
           obs_data_release(array_data);
+          mem_stats::conversions.free();
         }
       }
       
-      obs_data_set_array(data, name.c_str(), array);
+      obs_data_set_array(data, name, array);
       obs_data_array_release(array);
+      mem_stats::conversions.free();
     }
   }
   
@@ -395,6 +414,37 @@ Napi::Object property_to_napi(Napi::Env env, obs_property_t* property) {
   return obj;
 }
 
+std::string join_path(const std::string& dir, const std::string& file) {
+#ifdef _WIN32
+  const char separator = '\\';
+#else
+  const char separator = '/';
+#endif
+
+  if (dir.empty() || dir.back() == '\\' || dir.back() == '/')
+    return dir + file;
+
+  return dir + separator + file;
+}
+
+uint64_t peak_resident_size() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters = {};
+
+  if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+
+  return counters.PeakWorkingSetSize;
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return (uint64_t)usage.ru_maxrss * 1024; // Kilobytes on Linux.
+#endif
+}
+
 std::string get_current_date_time() {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -402,3 +452,120 @@ std::string get_current_date_time() {
     ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H-%M-%S");
     return ss.str();
 }
+
+bool write_file(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* f = os_fopen(path.c_str(), "wb");
+
+  if (!f) {
+    blog(LOG_ERROR, "Failed to open %s for writing", path.c_str());
+    return false;
+  }
+
+  bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok)
+    blog(LOG_ERROR, "Failed to write %s", path.c_str());
+
+  return ok;
+}
+
+obs_scale_type scale_type_from_string(const std::string& str) {
+  if (str == "point") return OBS_SCALE_POINT;
+  if (str == "bilinear") return OBS_SCALE_BILINEAR;
+  if (str == "bicubic") return OBS_SCALE_BICUBIC;
+  if (str == "lanczos") return OBS_SCALE_LANCZOS;
+  if (str == "area") return OBS_SCALE_AREA;
+
+  blog(LOG_ERROR, "Unknown scale type: %s", str.c_str());
+  throw std::runtime_error("Unknown scale type");
+}
+
+static bool item_equal(obs_data_item_t* a, obs_data_item_t* b) {
+  enum obs_data_type type = obs_data_item_gettype(a);
+
+  if (type != obs_data_item_gettype(b))
+    return false;
+
+  switch (type) {
+    case OBS_DATA_STRING:
+      return strcmp(obs_data_item_get_string(a), obs_data_item_get_string(b)) == 0;
+
+    case OBS_DATA_NUMBER:
+      // 1 and 1.0 are the same setting, however they were written.
+      if (obs_data_item_numtype(a) == OBS_DATA_NUM_INT && obs_data_item_numtype(b) == OBS_DATA_NUM_INT)
+        return obs_data_item_get_int(a) == obs_data_item_get_int(b);
+
+      return obs_data_item_get_double(a) == obs_data_item_get_double(b);
+
+    case OBS_DATA_BOOLEAN:
+      return obs_data_item_get_bool(a) == obs_data_item_get_bool(b);
+
+    case OBS_DATA_OBJECT: {
+      obs_data_t* obj_a = obs_data_item_get_obj(a);
+      obs_data_t* obj_b = obs_data_item_get_obj(b);
+      bool equal = data_equal(obj_a, obj_b);
+      obs_data_release(obj_a);
+      obs_data_release(obj_b);
+      return equal;
+    }
+
+    case OBS_DATA_ARRAY: {
+      obs_data_array_t* array_a = obs_data_item_get_array(a);
+      obs_data_array_t* array_b = obs_data_item_get_array(b);
+      size_t count = obs_data_array_count(array_a);
+      bool equal = count == obs_data_array_count(array_b);
+
+      // Order matters in an array, unlike between keys.
+      for (size_t i = 0; equal && i < count; i++) {
+        obs_data_t* item_a = obs_data_array_item(array_a, i);
+        obs_data_t* item_b = obs_data_array_item(array_b, i);
+        equal = data_equal(item_a, item_b);
+        obs_data_release(item_a);
+        obs_data_release(item_b);
+      }
+
+      obs_data_array_release(array_a);
+      obs_data_array_release(array_b);
+      return equal;
+    }
+
+    default:
+      return true;
+  }
+}
+
+bool data_equal(obs_data_t* a, obs_data_t* b) {
+  if (!a || !b) {
+    return a == b;
+  }
+
+  size_t count_a = 0;
+  size_t count_b = 0;
+
+  for (obs_data_item_t* item = obs_data_first(a); item != NULL; obs_data_item_next(&item)) {
+    obs_data_item_t* other = obs_data_item_byname(b, obs_data_item_get_name(item));
+    bool equal = other && item_equal(item, other);
+    obs_data_item_release(&other);
+
+    if (!equal) {
+      obs_data_item_release(&item);
+      return false;
+    }
+
+    count_a++;
+  }
+
+  for (obs_data_item_t* item = obs_data_first(b); item != NULL; obs_data_item_next(&item))
+    count_b++;
+
+  // Every key of a was matched in b, so equal counts mean b has no extra keys.
+  return count_a == count_b;
+}
+
+ScopeTimer::ScopeTimer(const char* label) : label(label), start(os_gettime_ns()) {}
+
+ScopeTimer::~ScopeTimer() {
+  double ms = (os_gettime_ns() - start) / 1000000.0;
+  blog(LOG_INFO, "%s took %.2f ms", label, ms);
+}
@@ -2,6 +2,7 @@
 
 #include <napi.h>
 #include <obs.h>
+#include <vector>
 
 void log_handler(int lvl, const char *msg, va_list args, void *p);
 
@@ -10,4 +11,20 @@ obs_data_t* napi_to_data(Napi::Object obj);
 
 Napi::Object property_to_napi(Napi::Env env, obs_property_t* property);
 Napi::Array properties_to_napi(Napi::Env env, obs_properties_t* properties);
-std::string get_current_date_time();
\ No newline at end of file
+std::string get_current_date_time();
+std::string join_path(const std::string& dir, const std::string& file); // Join with the platform separator.
+obs_scale_type scale_type_from_string(const std::string& str); // Parse "bicubic" etc, throws if unknown.
+bool data_equal(obs_data_t* a, obs_data_t* b); // Compare two sets of settings key by key, so key order doesn't matter.
+bool write_file(const std::string& path, const std::vector<uint8_t>& data); // Write a whole file, path is UTF-8.
+uint64_t peak_resident_size(); // Highest resident set size of the process in bytes, 0 if unknown.
+
+// Logs how long the enclosing scope took, for timing reconfigurations.
+class ScopeTimer {
+  public:
+    ScopeTimer(const char* label);
+    ~ScopeTimer();
+
+  private:
+    const char* label;
+    uint64_t start;
+};
\ No newline at end of file
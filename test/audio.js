@@ -22,7 +22,8 @@ async function test() {
   console.log('Log path:', logPath);
   console.log('Recording path:', recordingPath);
 
-  noobs.Init(distPath, logPath, recordingPath, cb);
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
 
   console.log('Creating source...');
 // [INFO] 	- wasapi_input_capture
@@ -48,6 +49,9 @@ async function test() {
   noobs.AddSourceToScene('Test Speaker');
   // noobs.AddSourceToScene('Test App');
 
+  // Put the mic on its own track, the recording should have two audio tracks.
+  noobs.SetSourceAudioTrack('Test Mic', 1);
+
   // Vary the volumes.
   noobs.SetSourceVolume('Test Mic', 0.25);
   noobs.SetSourceVolume('Test Speaker', 0.5);
@@ -62,10 +66,12 @@ async function test() {
 
   noobs.StartRecording(0);
   await new Promise((resolve) => setTimeout(resolve, 2000));
+  console.log('Mic levels:', noobs.GetAudioLevels('Test Mic'));
 
   console.log("Mute all audio inputs for 2 seconds...");
   noobs.SetMuteAudioInputs(true);
   await new Promise((resolve) => setTimeout(resolve, 2000));
+  console.log('Muted mic levels:', noobs.GetAudioLevels('Test Mic'));
   console.log("Unmute all audio inputs...");
   noobs.SetMuteAudioInputs(false);
   await new Promise((resolve) => setTimeout(resolve, 2000));
@@ -0,0 +1,59 @@
+// Runs the native conversion microbenchmarks (the noobs_bench target). The
+// vector pixel and audio meter kernels are checked against the scalar
+// references first.
+//
+//   node test/bench/native.js [--filter <substring>] [--min-time <ms>] [--out <file>]
+
+const fs = require('fs');
+const path = require('path');
+
+if (process.platform === 'win32') {
+  process.env.Path += ';' + path.resolve(__dirname, '../../dist/bin');
+}
+
+const bench = require('../../build/Release/noobs_bench.node');
+
+const args = { filter: '', minTimeMs: 500, out: path.resolve(__dirname, 'results', 'native.json') };
+const argv = process.argv.slice(2);
+
+for (let i = 0; i < argv.length; i++) {
+  switch (argv[i]) {
+    case '--filter': args.filter = argv[++i]; break;
+    case '--min-time': args.minTimeMs = parseFloat(argv[++i]); break;
+    case '--out': args.out = path.resolve(argv[++i]); break;
+    default: throw new Error(`Unknown argument: ${argv[i]}`);
+  }
+}
+
+const failures = bench.Verify();
+
+if (failures.length > 0) {
+  console.error('Vector kernels disagree with the scalar reference:');
+  failures.forEach((f) => console.error('  ' + f));
+  process.exit(1);
+}
+
+console.log(`Kernels match the scalar reference, nv12_to_rgba uses ${bench.kernel}, meters use ${bench.meterKernel}\n`);
+
+const results = bench.Run({ filter: args.filter, minTimeMs: args.minTimeMs });
+
+console.log(
+  'name'.padEnd(40) + 'iterations'.padStart(12) + 'ns/op'.padStart(14) +
+  'ns/key'.padStart(10) + 'MB/s'.padStart(10) + 'heap/op'.padStart(10) + 'obs/op'.padStart(10)
+);
+
+for (const r of results) {
+  console.log(
+    r.name.padEnd(40) +
+    String(r.iterations).padStart(12) +
+    r.nsPerOp.toFixed(0).padStart(14) +
+    r.nsPerKey.toFixed(1).padStart(10) +
+    r.mbPerSec.toFixed(0).padStart(10) +
+    r.heapAllocsPerOp.toFixed(1).padStart(10) +
+    r.obsAllocsPerOp.toFixed(1).padStart(10)
+  );
+}
+
+fs.mkdirSync(path.dirname(args.out), { recursive: true });
+fs.writeFileSync(args.out, JSON.stringify({ date: new Date().toISOString(), platform: process.platform, kernel: bench.kernel, meterKernel: bench.meterKernel, results }, null, 2));
+console.log(`\nResults written to ${args.out}`);
@@ -0,0 +1,598 @@
+// Microbenchmarks for the obs_data/properties <-> napi conversions in
+// src/utils.cpp, argument marshalling through the arena in src/arena.cpp,
+// the pixel conversions in src/convert.cpp, alone and
+// banded across src/slice_pool.cpp, and the audio meter kernels in
+// src/audio_meter.cpp. Built as a separate addon (noobs_bench) so they can
+// run without a libobs instance.
+// Loosely modelled on Google Benchmark: each case runs in batches that
+// double in size until the minimum time is reached.
+
+#include <napi.h>
+#include <obs.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <util/platform.h>
+#include "utils.h"
+#include "arena.h"
+#include "convert.h"
+#include "slice_pool.h"
+#include "audio_meter.h"
+#include <media-io/audio-math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Count C++ heap allocations made on the benchmark thread while a case runs.
+static thread_local bool counting = false;
+static thread_local uint64_t heap_allocs = 0;
+
+void *operator new(size_t size) {
+  if (counting)
+    heap_allocs++;
+
+  void *p = malloc(size ? size : 1);
+
+  if (!p)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+struct BenchResult {
+  std::string name;
+  uint64_t iterations;
+  uint64_t keys; // Keys (or list items) converted per iteration.
+  uint64_t bytes; // Input bytes per iteration, for the pixel conversions.
+  double ns_per_op;
+  double heap_allocs_per_op;
+  double obs_allocs_per_op;
+};
+
+static BenchResult run_case(const std::string& name, uint64_t keys, uint64_t bytes, double min_time_ms, const std::function<void()>& fn) {
+  fn(); // Warm up.
+
+  uint64_t iterations = 1;
+
+  while (true) {
+    long obs_before = bnum_allocs();
+    heap_allocs = 0;
+    counting = true;
+    uint64_t start = os_gettime_ns();
+
+    for (uint64_t i = 0; i < iterations; i++)
+      fn();
+
+    uint64_t elapsed = os_gettime_ns() - start;
+    counting = false;
+    long obs_after = bnum_allocs();
+
+    if (elapsed / 1e6 >= min_time_ms || iterations >= (1ULL << 30)) {
+      return {
+        name,
+        iterations,
+        keys,
+        bytes,
+        (double)elapsed / iterations,
+        (double)heap_allocs / iterations,
+        (double)(obs_after - obs_before) / iterations,
+      };
+    }
+
+    iterations *= 2;
+  }
+}
+
+// A settings tree `depth` levels deep with `width` keys per level, cycling
+// through every value type. Objects and arrays recurse until the last level.
+static obs_data_t* make_tree(int depth, int width, uint64_t& keys) {
+  obs_data_t* data = obs_data_create();
+
+  for (int i = 0; i < width; i++) {
+    std::string key = "key_" + std::to_string(i);
+    keys++;
+
+    switch (i % 5) {
+      case 0:
+        obs_data_set_string(data, key.c_str(), "a moderately long string value");
+        break;
+      case 1:
+        obs_data_set_double(data, key.c_str(), i * 1.5);
+        break;
+      case 2:
+        obs_data_set_bool(data, key.c_str(), i % 2 == 0);
+        break;
+      case 3:
+        if (depth > 1) {
+          obs_data_t* child = make_tree(depth - 1, width, keys);
+          obs_data_set_obj(data, key.c_str(), child);
+          obs_data_release(child);
+        } else {
+          obs_data_set_int(data, key.c_str(), i);
+        }
+        break;
+      case 4:
+        if (depth > 1) {
+          obs_data_array_t* array = obs_data_array_create();
+          obs_data_t* child = make_tree(depth - 1, width, keys);
+          obs_data_array_push_back(array, child);
+          obs_data_release(child);
+          obs_data_set_array(data, key.c_str(), array);
+          obs_data_array_release(array);
+        } else {
+          obs_data_set_string(data, key.c_str(), "leaf");
+        }
+        break;
+    }
+  }
+
+  return data;
+}
+
+// An NV12 frame with padded rows, filled from a fixed seed so runs compare.
+struct TestFrame {
+  std::vector<uint8_t> y, uv;
+  uint32_t linesize[2];
+  const uint8_t* planes[2];
+
+  TestFrame(uint32_t width, uint32_t height, uint32_t padding) {
+    linesize[0] = width + padding;
+    linesize[1] = (width + 1) / 2 * 2 + padding;
+    y.resize((size_t)linesize[0] * height);
+    uv.resize((size_t)linesize[1] * ((height + 1) / 2));
+
+    uint32_t seed = 12345;
+    for (auto& b : y) b = (uint8_t)((seed = seed * 1103515245 + 12345) >> 16);
+    for (auto& b : uv) b = (uint8_t)((seed = seed * 1103515245 + 12345) >> 16);
+
+    planes[0] = y.data();
+    planes[1] = uv.data();
+  }
+};
+
+// Planar float noise, as libobs hands to audio capture callbacks.
+struct TestAudio {
+  std::vector<std::vector<float>> planes;
+  std::vector<const float*> pointers;
+
+  TestAudio(uint32_t channels, uint32_t frames) : planes(channels, std::vector<float>(frames)) {
+    uint32_t seed = 54321;
+
+    for (auto& plane : planes) {
+      for (auto& s : plane)
+        s = (float)((seed = seed * 1103515245 + 12345) >> 16 & 0xFFFF) / 32768.0f - 1.0f;
+
+      pointers.push_back(plane.data());
+    }
+  }
+};
+
+// The arguments ObsSetSourcePos takes, read the same way it reads them.
+static float read_position(Napi::Object position) {
+  float sum = 0;
+
+  for (const char* key : { "x", "y", "scaleX", "scaleY" })
+    sum += position.Get(key).As<Napi::Number>().FloatValue();
+
+  for (const char* key : { "cropLeft", "cropRight", "cropTop", "cropBottom" })
+    sum += position.Get(key).As<Napi::Number>().Int32Value();
+
+  return sum;
+}
+
+static obs_properties_t* make_list_properties(int props, int items) {
+  obs_properties_t* properties = obs_properties_create();
+
+  for (int p = 0; p < props; p++) {
+    std::string name = "list_" + std::to_string(p);
+    obs_property_t* list = obs_properties_add_list(properties, name.c_str(), "Window",
+      OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+
+    for (int i = 0; i < items; i++) {
+      std::string item = "[app" + std::to_string(i) + ".exe]: Window title " + std::to_string(i);
+      obs_property_list_add_string(list, item.c_str(), item.c_str());
+    }
+  }
+
+  return properties;
+}
+
+// Check every vector kernel against the scalar reference over awkward
+// sizes and row bands. Returns a list of failures, empty when all match.
+Napi::Value Verify(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<std::string> failures;
+
+  const uint32_t widths[] = { 1, 2, 7, 8, 9, 15, 16, 17, 31, 33, 640, 1917, 1920 };
+  const uint32_t heights[] = { 1, 2, 3, 16, 17 };
+
+  for (uint32_t w : widths) {
+    for (uint32_t h : heights) {
+      TestFrame frame(w, h, 3);
+      std::vector<uint8_t> expected((size_t)w * 4 * h, 0);
+      std::vector<uint8_t> actual((size_t)w * 4 * h, 1);
+
+      nv12_to_rgba_scalar(frame.planes, frame.linesize, w, 0, h, expected.data(), w * 4);
+
+      // Split into two bands to check start_y/end_y are honoured.
+      nv12_to_rgba_sse2(frame.planes, frame.linesize, w, 0, h / 2, actual.data(), w * 4);
+      nv12_to_rgba_sse2(frame.planes, frame.linesize, w, h / 2, h, actual.data(), w * 4);
+
+      if (expected != actual)
+        failures.push_back("nv12_to_rgba_sse2 " + std::to_string(w) + "x" + std::to_string(h));
+    }
+  }
+
+  // Banded conversion on the pool must match one pass, for band counts that
+  // don't divide the height evenly too.
+  for (uint32_t workers : { 1, 2, 3, 7 }) {
+    SlicePool pool(workers);
+
+    for (uint32_t h : { 2u, 30u, 1080u, 1082u }) {
+      uint32_t w = 64;
+      TestFrame frame(w, h, 3);
+      std::vector<uint8_t> expected((size_t)w * 4 * h, 0);
+      std::vector<uint8_t> actual((size_t)w * 4 * h, 1);
+
+      nv12_to_rgba(frame.planes, frame.linesize, w, 0, h, expected.data(), w * 4);
+
+      pool.run(h, 2, [&](uint32_t start, uint32_t end) {
+        nv12_to_rgba(frame.planes, frame.linesize, w, start, end, actual.data(), w * 4);
+      });
+
+      if (expected != actual)
+        failures.push_back("SlicePool " + std::to_string(workers) + " workers, height " + std::to_string(h));
+    }
+  }
+
+  // Meter kernels against the scalar loops. Sums are accumulated in a
+  // different order so only need to be close, the rest must match exactly.
+  TestAudio noise(1, 2048 + METER_TP_TAPS - 1);
+  const float* samples = noise.pointers[0];
+
+  for (uint32_t count : { 0, 1, 3, 4, 5, 17, 480, 1024, 2048 }) {
+    float peak_scalar, sumsq_scalar, peak_sse2, sumsq_sse2;
+    meter_peak_sumsq_scalar(samples, count, &peak_scalar, &sumsq_scalar);
+    meter_peak_sumsq_sse2(samples, count, &peak_sse2, &sumsq_sse2);
+
+    if (peak_scalar != peak_sse2 || fabsf(sumsq_scalar - sumsq_sse2) > 1e-5f * sumsq_scalar)
+      failures.push_back("meter_peak_sumsq_sse2 " + std::to_string(count));
+
+    if (meter_true_peak_scalar(samples, count) != meter_true_peak_sse2(samples, count))
+      failures.push_back("meter_true_peak_sse2 " + std::to_string(count));
+  }
+
+  // A 1 kHz stereo tone at -6 dBFS reads -6 LUFS, as BS.1770 is calibrated.
+  {
+    AudioMeter meter(48000, 2);
+    std::vector<float> tone(48000 * 3);
+
+    for (size_t i = 0; i < tone.size(); i++)
+      tone[i] = db_to_mul(-6.0f) * (float)sin(2.0 * M_PI * 1000.0 * i / 48000.0);
+
+    const float* planes[2] = { tone.data(), tone.data() };
+
+    for (size_t offset = 0; offset < tone.size(); offset += 1024) {
+      const float* block[2] = { planes[0] + offset, planes[1] + offset };
+      meter.process(block, (uint32_t)std::min<size_t>(1024, tone.size() - offset), false);
+    }
+
+    MeterLevels levels = meter.read();
+
+    if (fabsf(levels.loudness + 6.0f) > 0.1f || fabsf(levels.peak[0] + 6.0f) > 0.01f || fabsf(levels.rms[0] + 9.01f) > 0.01f)
+      failures.push_back("AudioMeter levels of a -6 dBFS tone");
+  }
+
+  // Arena copies match Utf8Value, including strings bigger than a block, and
+  // a scope hands its memory back for the next call to reuse.
+  for (std::string str : { std::string(), std::string("Game Capture"), std::string("\u00e9cran \u2014 \U0001F3AE"), std::string(10000, 'x') }) {
+    Napi::HandleScope scope(env);
+    Napi::String js = Napi::String::New(env, str);
+    size_t capacity;
+
+    for (int pass = 0; pass < 2; pass++) {
+      ArenaScope arena;
+      std::string_view view = arena_utf8(js);
+
+      if (view != js.Utf8Value() || view.data()[view.size()] != '\0')
+        failures.push_back("arena_utf8 of " + std::to_string(str.size()) + " bytes");
+
+      if (pass == 0)
+        capacity = call_arena().capacity();
+      else if (call_arena().capacity() != capacity)
+        failures.push_back("ArenaScope reuse of " + std::to_string(str.size()) + " bytes");
+    }
+  }
+
+  Napi::Array out = Napi::Array::New(env, failures.size());
+
+  for (size_t i = 0; i < failures.size(); i++)
+    out.Set(i, failures[i]);
+
+  return out;
+}
+
+Napi::Value Run(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::string filter;
+  double min_time_ms = 500;
+
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object opts = info[0].As<Napi::Object>();
+
+    if (opts.Has("filter") && opts.Get("filter").IsString())
+      filter = opts.Get("filter").As<Napi::String>().Utf8Value();
+
+    if (opts.Has("minTimeMs") && opts.Get("minTimeMs").IsNumber())
+      min_time_ms = opts.Get("minTimeMs").As<Napi::Number>().DoubleValue();
+  }
+
+  // The conversions log, which would dominate the timings.
+  base_set_log_handler([](int, const char*, va_list, void*) {}, nullptr);
+
+  std::vector<BenchResult> results;
+
+  auto bench = [&](const std::string& name, uint64_t keys, const std::function<void()>& fn) {
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+
+    results.push_back(run_case(name, keys, 0, min_time_ms, fn));
+  };
+
+  auto bench_bytes = [&](const std::string& name, uint64_t bytes, const std::function<void()>& fn) {
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+
+    results.push_back(run_case(name, 0, bytes, min_time_ms, fn));
+  };
+
+  const std::pair<int, int> shapes[] = { {1, 8}, {1, 64}, {1, 512}, {3, 8}, {4, 10} };
+
+  for (const auto& shape : shapes) {
+    uint64_t keys = 0;
+    obs_data_t* tree = make_tree(shape.first, shape.second, keys);
+    std::string suffix = "/depth:" + std::to_string(shape.first) + "/width:" + std::to_string(shape.second);
+
+    bench("data_to_napi" + suffix, keys, [&]() {
+      Napi::HandleScope scope(env);
+      data_to_napi(env, tree);
+    });
+
+    Napi::ObjectReference js = Napi::Persistent(data_to_napi(env, tree));
+
+    bench("napi_to_data" + suffix, keys, [&]() {
+      Napi::HandleScope scope(env);
+      obs_data_release(napi_to_data(js.Value()));
+    });
+
+    obs_data_release(tree);
+  }
+
+  // What the source position bindings do with their arguments, the old
+  // way with a std::string per name and through the call arena. Only the
+  // arena one should make no heap allocations once warmed up.
+  {
+    Napi::Object args = Napi::Object::New(env);
+    args.Set("name", "Window Capture (Primary Monitor)");
+
+    for (const char* key : { "x", "y", "scaleX", "scaleY", "cropLeft", "cropRight", "cropTop", "cropBottom" })
+      args.Set(key, 1.0);
+
+    Napi::ObjectReference js = Napi::Persistent(args);
+    volatile float sink = 0;
+
+    bench("source_pos_args/utf8_value", 1, [&]() {
+      Napi::HandleScope scope(env);
+      Napi::Object position = js.Value();
+      std::string name = position.Get("name").As<Napi::String>().Utf8Value();
+      sink = sink + read_position(position) + name.size();
+    });
+
+    bench("source_pos_args/arena", 1, [&]() {
+      Napi::HandleScope scope(env);
+      ArenaScope arena;
+      Napi::Object position = js.Value();
+      std::string_view name = arena_utf8(position.Get("name"));
+      sink = sink + read_position(position) + name.size();
+    });
+
+    // The typed array entry points, SetSourceTransform reading a caller's
+    // Float64Array and GetSourceTransform filling one, against building the
+    // object GetSourcePos returns.
+    Napi::Reference<Napi::Float64Array> transform = Napi::Persistent(Napi::Float64Array::New(env, 10));
+
+    bench("source_pos_args/float64_array", 1, [&]() {
+      Napi::HandleScope scope(env);
+      ArenaScope arena;
+      std::string_view name = arena_utf8(js.Value().Get("name"));
+      const double* values = transform.Value().Data();
+      float sum = 0;
+
+      for (int i = 0; i < 8; i++)
+        sum += (float)values[i];
+
+      sink = sink + sum + name.size();
+    });
+
+    bench("source_pos_result/object", 1, [&]() {
+      Napi::HandleScope scope(env);
+      Napi::Object result = Napi::Object::New(env);
+
+      for (const char* key : { "x", "y", "width", "height", "scaleX", "scaleY", "cropLeft", "cropRight", "cropTop", "cropBottom" })
+        result.Set(key, Napi::Number::New(env, 1.0));
+    });
+
+    bench("source_pos_result/float64_array", 1, [&]() {
+      Napi::HandleScope scope(env);
+      double* out = transform.Value().Data();
+
+      for (int i = 0; i < 10; i++)
+        out[i] = 1.0;
+    });
+  }
+
+  for (int items : { 10, 1000, 5000 }) {
+    obs_properties_t* props = make_list_properties(1, items);
+    obs_property_t* list = obs_properties_first(props);
+
+    bench("property_to_napi/list:" + std::to_string(items), items, [&]() {
+      Napi::HandleScope scope(env);
+      property_to_napi(env, list);
+    });
+
+    obs_properties_destroy(props);
+  }
+
+  for (int count : { 10, 100 }) {
+    obs_properties_t* props = make_list_properties(count, 20);
+
+    bench("properties_to_napi/props:" + std::to_string(count), count * 20, [&]() {
+      Napi::HandleScope scope(env);
+      properties_to_napi(env, props);
+    });
+
+    obs_properties_destroy(props);
+  }
+
+  const std::pair<const char*, std::pair<uint32_t, uint32_t>> resolutions[] = {
+    { "1080p", { 1920, 1080 } },
+    { "4k", { 3840, 2160 } },
+  };
+
+  for (const auto& [label, size] : resolutions) {
+    TestFrame frame(size.first, size.second, 0);
+    std::vector<uint8_t> rgba((size_t)size.first * size.second * 4);
+    uint64_t bytes = frame.y.size() + frame.uv.size();
+
+    bench_bytes(std::string("nv12_to_rgba/scalar/") + label, bytes, [&]() {
+      nv12_to_rgba_scalar(frame.planes, frame.linesize, size.first, 0, size.second, rgba.data(), size.first * 4);
+    });
+
+    bench_bytes(std::string("nv12_to_rgba/sse2/") + label, bytes, [&]() {
+      nv12_to_rgba_sse2(frame.planes, frame.linesize, size.first, 0, size.second, rgba.data(), size.first * 4);
+    });
+  }
+
+  // Scaling of the banded conversion the frame preview uses, from the
+  // calling thread alone up to one thread per core. A 60 fps canvas leaves
+  // 16.7 ms per frame for everything, the conversion should be a fraction.
+  {
+    uint32_t width = 3840, height = 2160;
+    TestFrame frame(width, height, 0);
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    uint64_t bytes = frame.y.size() + frame.uv.size();
+    uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t threads = 1; threads <= cores; threads++) {
+      SlicePool pool(threads - 1);
+
+      bench_bytes("nv12_to_rgba/threads:" + std::to_string(threads) + "/4k", bytes, [&]() {
+        pool.run(height, 2, [&](uint32_t start, uint32_t end) {
+          nv12_to_rgba(frame.planes, frame.linesize, width, start, end, rgba.data(), width * 4);
+        });
+      });
+    }
+  }
+
+  // About a second of 48 kHz 7.1 audio per op, in the 1024 frame blocks
+  // the libobs audio thread delivers. Channels are planar so the kernels run
+  // once per channel per block.
+  {
+    const uint32_t rate = 48000, channels = 8, block = 1024;
+    const uint32_t frames = rate / block * block;
+    TestAudio audio(channels, frames + METER_TP_TAPS - 1);
+    uint64_t bytes = (uint64_t)frames * channels * sizeof(float);
+    volatile float sink = 0;
+
+    auto each_block = [&](const std::function<void(const float*)>& fn) {
+      for (uint32_t c = 0; c < channels; c++)
+        for (uint32_t offset = 0; offset < frames; offset += block)
+          fn(audio.pointers[c] + offset);
+    };
+
+    bench_bytes("meter_peak_sumsq/scalar/48k_8ch", bytes, [&]() {
+      each_block([&](const float* samples) {
+        float peak, sumsq;
+        meter_peak_sumsq_scalar(samples, block, &peak, &sumsq);
+        sink = sink + sumsq;
+      });
+    });
+
+    bench_bytes("meter_peak_sumsq/sse2/48k_8ch", bytes, [&]() {
+      each_block([&](const float* samples) {
+        float peak, sumsq;
+        meter_peak_sumsq_sse2(samples, block, &peak, &sumsq);
+        sink = sink + sumsq;
+      });
+    });
+
+    bench_bytes("meter_true_peak/scalar/48k_8ch", bytes, [&]() {
+      each_block([&](const float* samples) { sink = sink + meter_true_peak_scalar(samples, block); });
+    });
+
+    bench_bytes("meter_true_peak/sse2/48k_8ch", bytes, [&]() {
+      each_block([&](const float* samples) { sink = sink + meter_true_peak_sse2(samples, block); });
+    });
+
+    // The whole meter, K-weighting and loudness blocks included.
+    AudioMeter meter(rate, channels);
+
+    bench_bytes("audio_meter/48k_8ch", bytes, [&]() {
+      for (uint32_t offset = 0; offset < frames; offset += block) {
+        const float* planes[channels];
+
+        for (uint32_t c = 0; c < channels; c++)
+          planes[c] = audio.pointers[c] + offset;
+
+        meter.process(planes, block, false);
+      }
+
+      meter.read();
+    });
+  }
+
+  base_set_log_handler(nullptr, nullptr);
+
+  Napi::Array out = Napi::Array::New(env, results.size());
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult& r = results[i];
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("name", r.name);
+    obj.Set("iterations", Napi::Number::New(env, (double)r.iterations));
+    obj.Set("keys", Napi::Number::New(env, (double)r.keys));
+    obj.Set("nsPerOp", r.ns_per_op);
+    obj.Set("nsPerKey", r.keys ? r.ns_per_op / r.keys : 0);
+    obj.Set("mbPerSec", r.bytes ? r.bytes * 1000.0 / r.ns_per_op : 0);
+    obj.Set("heapAllocsPerOp", r.heap_allocs_per_op);
+    obj.Set("obsAllocsPerOp", r.obs_allocs_per_op);
+    out.Set(i, obj);
+  }
+
+  return out;
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  exports.Set("Run", Napi::Function::New(env, Run));
+  exports.Set("Verify", Napi::Function::New(env, Verify));
+  exports.Set("kernel", Napi::String::New(env, nv12_to_rgba_kernel()));
+  exports.Set("meterKernel", Napi::String::New(env, audio_meter_kernel()));
+  return exports;
+}
+
+NODE_API_MODULE(noobs_bench, Init)
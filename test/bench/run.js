@@ -0,0 +1,204 @@
+// Benchmark harness for the N-API surface.
+//
+//   node test/bench/run.js [--scenario <name>] [--out <file>]
+//                          [--baseline <file>] [--save-baseline]
+//                          [--threshold <fraction>]
+//
+// Runs each scenario against a single Init'd instance, prints a summary and
+// writes the results as JSON. If a baseline exists the p50 and p99 of every
+// phase are compared against it and the process exits non-zero when any of
+// them regress by more than the threshold (default 25%). Baselines are only
+// ever written by --save-baseline, from a real run on the machine that will
+// do the comparing.
+
+const noobs = require('../../index.js');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { summarise, rssMb } = require('./stats');
+const scenarios = require('./scenarios');
+
+// Differences smaller than this are timer noise, not regressions.
+const NOISE_FLOOR_MS = 0.05;
+
+function parseArgs(argv) {
+  const args = {
+    scenario: null,
+    out: path.resolve(__dirname, 'results', 'latest.json'),
+    baseline: path.resolve(__dirname, 'baseline.json'),
+    saveBaseline: false,
+    threshold: 0.25,
+  };
+
+  for (let i = 0; i < argv.length; i++) {
+    switch (argv[i]) {
+      case '--scenario': args.scenario = argv[++i]; break;
+      case '--out': args.out = path.resolve(argv[++i]); break;
+      case '--baseline': args.baseline = path.resolve(argv[++i]); break;
+      case '--save-baseline': args.saveBaseline = true; break;
+      case '--threshold': args.threshold = parseFloat(argv[++i]); break;
+      default: throw new Error(`Unknown argument: ${argv[i]}`);
+    }
+  }
+
+  return args;
+}
+
+// Routes addon callbacks to whichever scenario is listening.
+function makeContext() {
+  const listeners = new Set();
+
+  const onSignal = (fn) => {
+    listeners.add(fn);
+    return () => listeners.delete(fn);
+  };
+
+  const waitForSignal = (type, id, timeoutMs = 10000) => new Promise((resolve, reject) => {
+    const timer = setTimeout(() => {
+      unsubscribe();
+      reject(new Error(`Timed out waiting for ${type} signal ${id}`));
+    }, timeoutMs);
+
+    const unsubscribe = onSignal((signal) => {
+      if (signal.type === type && signal.id === id) {
+        clearTimeout(timer);
+        unsubscribe();
+        resolve(signal);
+      }
+    });
+  });
+
+  const dispatch = (signal) => listeners.forEach((fn) => fn(signal));
+  return { onSignal, waitForSignal, dispatch };
+}
+
+function compare(results, baseline, threshold) {
+  const regressions = [];
+
+  for (const [name, scenario] of Object.entries(results.scenarios)) {
+    const base = baseline.scenarios[name];
+    if (!base) continue;
+
+    for (const [phase, summary] of Object.entries(scenario.latency)) {
+      const basePhase = base.latency[phase];
+      if (!basePhase) continue;
+
+      for (const stat of ['p50', 'p99']) {
+        const was = basePhase[stat];
+        const is = summary[stat];
+
+        if (is - was > NOISE_FLOOR_MS && is > was * (1 + threshold)) {
+          regressions.push({ scenario: name, phase, stat, baseline: was, current: is });
+        }
+      }
+    }
+  }
+
+  return regressions;
+}
+
+function print(results) {
+  for (const [name, scenario] of Object.entries(results.scenarios)) {
+    console.log(`\n${name} (rss ${scenario.rssBeforeMb.toFixed(1)} -> ${scenario.rssAfterMb.toFixed(1)} MB)`);
+
+    for (const [phase, s] of Object.entries(scenario.latency)) {
+      console.log(
+        `  ${phase.padEnd(16)} n=${String(s.count).padEnd(6)} ` +
+        `p50=${s.p50.toFixed(3)} p90=${s.p90.toFixed(3)} p99=${s.p99.toFixed(3)} max=${s.max.toFixed(3)} ms`
+      );
+    }
+
+    for (const [metric, value] of Object.entries(scenario.metrics)) {
+      console.log(`  ${metric.padEnd(16)} ${Number.isInteger(value) ? value : value.toFixed(2)}`);
+    }
+  }
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const selected = scenarios.filter((s) => !args.scenario || s.name === args.scenario);
+
+  if (selected.length === 0) {
+    throw new Error(`No scenario named ${args.scenario}`);
+  }
+
+  const ctx = makeContext();
+  const distPath = path.resolve(__dirname, '../../dist');
+  const logPath = fs.mkdtempSync(path.join(os.tmpdir(), 'noobs-bench-logs-'));
+  const recordingPath = fs.mkdtempSync(path.join(os.tmpdir(), 'noobs-bench-recordings-'));
+
+  noobs.Init(distPath, logPath, ctx.dispatch);
+  noobs.SetRecordingDir(recordingPath);
+
+  const results = {
+    meta: {
+      date: new Date().toISOString(),
+      node: process.version,
+      platform: process.platform,
+      arch: process.arch,
+      cpus: os.cpus().length,
+    },
+    scenarios: {},
+  };
+
+  try {
+    for (const scenario of selected) {
+      console.log(`Running ${scenario.name}: ${scenario.description}`);
+      if (global.gc) global.gc();
+
+      const rssBeforeMb = rssMb();
+      const { latency, metrics } = await scenario.run(noobs, ctx);
+      if (global.gc) global.gc();
+      const rssAfterMb = rssMb();
+
+      const summaries = {};
+      for (const [phase, samples] of Object.entries(latency)) {
+        summaries[phase] = summarise(samples);
+      }
+
+      results.scenarios[scenario.name] = { latency: summaries, metrics, rssBeforeMb, rssAfterMb };
+    }
+  } finally {
+    noobs.Shutdown();
+    fs.rmSync(recordingPath, { recursive: true, force: true });
+  }
+
+  print(results);
+
+  fs.mkdirSync(path.dirname(args.out), { recursive: true });
+  fs.writeFileSync(args.out, JSON.stringify(results, null, 2));
+  console.log(`\nResults written to ${args.out}`);
+
+  if (args.saveBaseline) {
+    fs.writeFileSync(args.baseline, JSON.stringify(results, null, 2));
+    console.log(`Baseline written to ${args.baseline}`);
+    return;
+  }
+
+  if (!fs.existsSync(args.baseline)) {
+    console.log('No baseline to compare against, run with --save-baseline to create one');
+    return;
+  }
+
+  const baseline = JSON.parse(fs.readFileSync(args.baseline, 'utf8'));
+  const regressions = compare(results, baseline, args.threshold);
+
+  if (regressions.length === 0) {
+    console.log('No regressions against baseline');
+    return;
+  }
+
+  for (const r of regressions) {
+    console.log(
+      `REGRESSION ${r.scenario}/${r.phase} ${r.stat}: ` +
+      `${r.baseline.toFixed(3)} -> ${r.current.toFixed(3)} ms`
+    );
+  }
+
+  process.exitCode = 1;
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exitCode = 1;
+});
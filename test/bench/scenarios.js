@@ -0,0 +1,224 @@
+const { now, time, lcg, sleep } = require('./stats');
+
+// Each scenario gets the addon and a context with waitForSignal/onSignal,
+// and returns { latency: { phase: [ms samples] }, metrics: { name: value } }.
+
+// Settings object with a fixed shape and seeded values.
+function makeSettings(rand) {
+  return {
+    monitor: Math.floor(rand() * 4),
+    capture_cursor: rand() > 0.5,
+    method: rand() > 0.5 ? 'dxgi' : 'wgc',
+    window: `Window ${Math.floor(rand() * 1000)}:Class:app.exe`,
+    scale: rand(),
+    crop: {
+      left: Math.floor(rand() * 100),
+      right: Math.floor(rand() * 100),
+      top: Math.floor(rand() * 100),
+      bottom: Math.floor(rand() * 100),
+    },
+    tags: [{ name: 'a', value: rand() }, { name: 'b', value: rand() }],
+  };
+}
+
+const scenarios = [
+  {
+    name: 'sources-create-delete',
+    description: 'Create then delete 100 sources, 5 rounds',
+    async run(noobs) {
+      const create = [];
+      const remove = [];
+
+      for (let round = 0; round < 5; round++) {
+        const names = [];
+
+        for (let i = 0; i < 100; i++) {
+          create.push(time(() => names.push(noobs.CreateSource(`Bench Source ${i}`, 'image_source'))));
+        }
+
+        for (const name of names) {
+          remove.push(time(() => noobs.DeleteSource(name)));
+        }
+      }
+
+      return { latency: { create, delete: remove }, metrics: {} };
+    },
+  },
+  {
+    name: 'settings-round-trip',
+    description: '10k SetSourceSettings/GetSourceSettings round trips',
+    async run(noobs) {
+      const rand = lcg(1234);
+      const name = noobs.CreateSource('Bench Settings', 'monitor_capture');
+      const set = [];
+      const get = [];
+
+      for (let i = 0; i < 10000; i++) {
+        const settings = makeSettings(rand);
+        set.push(time(() => noobs.SetSourceSettings(name, settings)));
+        get.push(time(() => noobs.GetSourceSettings(name)));
+      }
+
+      noobs.DeleteSource(name);
+      return { latency: { set, get }, metrics: {} };
+    },
+  },
+  {
+    name: 'source-drag',
+    description: '10k position get/set pairs as objects and as Float64Arrays, then whole scene reads and snapshots',
+    async run(noobs) {
+      const names = [];
+
+      for (let i = 0; i < 8; i++) {
+        const name = noobs.CreateSource(`Bench Drag ${i}`, 'image_source');
+        noobs.AddSourceToScene(name);
+        names.push(name);
+      }
+
+      const name = names[0];
+      const objectGet = [];
+      const objectSet = [];
+      const arrayGet = [];
+      const arraySet = [];
+      const transform = new Float64Array(10);
+
+      for (let i = 0; i < 10000; i++) {
+        const pos = { x: i % 1920, y: i % 1080, scaleX: 1, scaleY: 1, cropLeft: 0, cropRight: 0, cropTop: 0, cropBottom: 0 };
+        objectSet.push(time(() => noobs.SetSourcePos(name, pos)));
+        objectGet.push(time(() => noobs.GetSourcePos(name)));
+      }
+
+      for (let i = 0; i < 10000; i++) {
+        transform[0] = i % 1920;
+        transform[1] = i % 1080;
+        arraySet.push(time(() => noobs.SetSourceTransform(name, transform)));
+        arrayGet.push(time(() => noobs.GetSourceTransform(name, transform)));
+      }
+
+      // Every item at once, against a GetSourcePos per item.
+      const sceneObjects = [];
+      const sceneArray = [];
+      let buffer = new Float64Array(0);
+
+      for (let i = 0; i < 1000; i++) {
+        sceneObjects.push(time(() => names.map((n) => noobs.GetSourcePos(n))));
+        sceneArray.push(time(() => { buffer = noobs.GetSceneTransforms(buffer).transforms; }));
+      }
+
+      // A full snapshot, and the check a UI makes when nothing has changed.
+      const snapshot = [];
+      const unchanged = [];
+      let version;
+
+      for (let i = 0; i < 1000; i++) {
+        snapshot.push(time(() => { ({ version } = noobs.GetSceneSnapshot()); }));
+        unchanged.push(time(() => noobs.GetSceneSnapshot(version)));
+      }
+
+      // The APIs must agree, and moving an item must bump the version.
+      const { names: order, transforms } = noobs.GetSceneTransforms();
+      const mismatches = order.filter((n, i) => {
+        const pos = noobs.GetSourcePos(n);
+        const record = transforms.subarray(i * 10, i * 10 + 10);
+        return [pos.x, pos.y, pos.scaleX, pos.scaleY, pos.cropLeft, pos.cropRight, pos.cropTop, pos.cropBottom, pos.width, pos.height]
+          .some((v, j) => Math.fround(v) !== Math.fround(record[j]));
+      }).length;
+
+      const stale = noobs.GetSceneSnapshot(version) !== null;
+      noobs.SetSourceTransform(name, transform);
+      const bumped = noobs.GetSceneSnapshot(version) !== null;
+
+      for (const n of names) {
+        noobs.RemoveSourceFromScene(n);
+        noobs.DeleteSource(n);
+      }
+
+      return {
+        latency: { objectGet, objectSet, arrayGet, arraySet, sceneObjects, sceneArray, snapshot, unchanged },
+        metrics: { items: order.length, mismatches: mismatches + (stale || !bumped ? 1 : 0) },
+      };
+    },
+  },
+  {
+    name: 'signal-flood',
+    description: 'Volume meter callbacks from 8 audio sources for 5s',
+    async run(noobs, ctx) {
+      const names = [];
+
+      for (let i = 0; i < 8; i++) {
+        names.push(noobs.CreateSource(`Bench Audio ${i}`, 'wasapi_input_capture'));
+      }
+
+      let received = 0;
+      const unsubscribe = ctx.onSignal((signal) => {
+        if (signal.type === 'volmeter') received++;
+      });
+
+      // Measure how late a 1ms timer fires while callbacks are arriving.
+      const lag = [];
+      let expected = now() + 1;
+      const timer = setInterval(() => {
+        const t = now();
+        lag.push(Math.max(0, t - expected));
+        expected = t + 1;
+      }, 1);
+
+      noobs.SetVolmeterEnabled(true);
+      const start = now();
+      await sleep(5000);
+      const elapsed = (now() - start) / 1000;
+      noobs.SetVolmeterEnabled(false);
+
+      clearInterval(timer);
+      unsubscribe();
+
+      for (const name of names) {
+        noobs.DeleteSource(name);
+      }
+
+      return {
+        latency: { eventLoopLag: lag },
+        metrics: { signals: received, signalsPerSec: received / elapsed },
+      };
+    },
+  },
+  {
+    name: 'record-cycles',
+    description: 'Buffer, convert to recording and stop, 10 cycles',
+    async run(noobs, ctx) {
+      const startBuffer = [];
+      const startRecording = [];
+      const stop = [];
+      const files = [];
+
+      noobs.SetBuffering(true);
+
+      for (let i = 0; i < 10; i++) {
+        let t = now();
+        const started = ctx.waitForSignal('output', 'start');
+        noobs.StartBuffer();
+        await started;
+        startBuffer.push(now() - t);
+
+        await sleep(2000);
+        startRecording.push(time(() => noobs.StartRecording(1)));
+        await sleep(1000);
+
+        t = now();
+        const stopped = ctx.waitForSignal('output', 'stop');
+        noobs.StopRecording();
+        await stopped;
+        stop.push(now() - t);
+
+        files.push(noobs.GetLastRecording());
+      }
+
+      return {
+        latency: { startBuffer, startRecording, stop },
+        metrics: { files: files.filter((f) => f).length },
+      };
+    },
+  },
+];
+
+module.exports = scenarios;
@@ -0,0 +1,50 @@
+// Helpers for timing calls and summarising samples. All times are in ms.
+
+function now() {
+  return Number(process.hrtime.bigint()) / 1e6;
+}
+
+// Time a synchronous call, returning the elapsed ms.
+function time(fn) {
+  const start = now();
+  fn();
+  return now() - start;
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return 0;
+  const idx = Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1);
+  return sorted[Math.max(0, idx)];
+}
+
+function summarise(samples) {
+  const sorted = [...samples].sort((a, b) => a - b);
+  const sum = sorted.reduce((acc, v) => acc + v, 0);
+
+  return {
+    count: sorted.length,
+    min: sorted[0] || 0,
+    mean: sorted.length ? sum / sorted.length : 0,
+    p50: percentile(sorted, 50),
+    p90: percentile(sorted, 90),
+    p99: percentile(sorted, 99),
+    max: sorted[sorted.length - 1] || 0,
+  };
+}
+
+function rssMb() {
+  return process.memoryUsage().rss / (1024 * 1024);
+}
+
+// Deterministic pseudo random numbers so every run sees the same inputs.
+function lcg(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+    return state / 0x100000000;
+  };
+}
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+module.exports = { now, time, percentile, summarise, rssMb, lcg, sleep };
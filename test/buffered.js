@@ -44,9 +44,11 @@ async function test() {
     // Start the buffer.
     noobs.StartBuffer();
     await new Promise((resolve) => setTimeout(resolve, 5000));
+    console.log('Memory while buffering:', noobs.GetMemoryStats());
 
-    // Start the recording, with 1s offset into the past.
-    noobs.StartRecording(1);
+    // Start the recording, 1.5s into the past. The second loop starts
+    // exactly there, the first on the keyframe before.
+    noobs.StartRecording(1.5, i == 1);
     await new Promise((resolve) => setTimeout(resolve, 5000));
 
     // Add the source to the scene for a second.
@@ -74,6 +76,12 @@ async function test() {
 
     // Sleep a bit more for good measure.
     await new Promise((resolve) => setTimeout(resolve, 1000));
+
+    // Every conversion temporary should be released by now.
+    const mem = noobs.GetMemoryStats();
+    if (mem.conversions.live !== 0) {
+      throw new Error(`Leaked ${mem.conversions.live} conversion temporaries`);
+    }
   }
 
   console.log('Stopping obs...');
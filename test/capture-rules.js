@@ -0,0 +1,39 @@
+const noobs = require('../index.js');
+const path = require('path');
+
+async function test() {
+  console.log('Starting obs...');
+
+  const cb = (msg) => {
+    console.log('Callback received:', msg);
+  };
+
+  const distPath = path.resolve(__dirname, '../dist');
+  const logPath = path.resolve(__dirname, '../logs');
+  const recordingPath = path.resolve(__dirname, '../recordings');
+
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
+
+  const game = noobs.CreateSource('Test Source', 'game_capture');
+  noobs.AddSourceToScene(game);
+
+  // Start the game after this, the source should be pointed at it within a
+  // second and a capture signal with code 1 received once it hooks.
+  noobs.SetCaptureRules([
+    { exe: 'WowClassic.exe', source: game },
+    { exe: 'Wow.exe', source: game },
+  ], 1000);
+
+  await new Promise((resolve) => setTimeout(resolve, 30000));
+  console.log('Settings:', noobs.GetSourceSettings(game));
+  console.log('Memory:', noobs.GetMemoryStats().registry);
+
+  noobs.SetCaptureRules([]);
+  noobs.Shutdown();
+  console.log('Test Done');
+}
+
+console.log('Starting test...');
+test();
+console.log('Test now running async');
@@ -16,13 +16,24 @@ async function test() {
   console.log('Log path:', logPath);
   console.log('Recording path:', recordingPath);
 
-  noobs.Init(distPath, logPath, recordingPath, cb);
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
 
   const encoders = noobs.ListVideoEncoders();
   console.log('Available video encoders:', encoders);
 
-  noobs.SetVideoEncoder('obs_x264', { "rate_control": "CRF", "keyint_sec": 1, "crf": 22 });
-  // noobs.SetVideoEncoder('h264_texture_amf', { "rate_control": "CRF", "keyint_sec": 1, "crf": 22 });
+  noobs.SetVideoEncoder('obs_x264', { "rate_control": "CRF", "crf": 22 });
+  // noobs.SetVideoEncoder('h264_texture_amf', { "rate_control": "CRF", "crf": 22 });
+
+  // Keyframes every second while buffering, every 4 when recording to file.
+  noobs.SetKeyframeInterval(1, 4);
+
+  const audioEncoders = noobs.ListAudioEncoders();
+  console.log('Available audio encoders:', audioEncoders);
+
+  // Opus only runs at 48 kHz.
+  noobs.ResetAudioContext(48000, 2);
+  noobs.SetAudioEncoder('ffmpeg_opus', { "bitrate": 96 });
 
   noobs.Shutdown();
   console.log('Test Done');
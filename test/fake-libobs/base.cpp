@@ -0,0 +1,342 @@
+#include "fake-libobs.h"
+#include <util/platform.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------- */
+/* Logging */
+
+static void default_log_handler(int lvl, const char *msg, va_list args, void *p) {
+  vfprintf(stderr, msg, args);
+  fputc('\n', stderr);
+}
+
+static log_handler_t log_handler = default_log_handler;
+static void *log_param = nullptr;
+
+void base_get_log_handler(log_handler_t *handler, void **param) {
+  *handler = log_handler;
+  if (param)
+    *param = log_param;
+}
+
+void base_set_log_handler(log_handler_t handler, void *param) {
+  log_handler = handler ? handler : default_log_handler;
+  log_param = param;
+}
+
+void blogva(int log_level, const char *format, va_list args) {
+  log_handler(log_level, format, args, log_param);
+}
+
+void blog(int log_level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  blogva(log_level, format, args);
+  va_end(args);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Memory, counted the same way libobs does so leak checks still work */
+
+static std::atomic<long> num_allocs{0};
+
+void *bmalloc(size_t size) {
+  void *ptr = malloc(size ? size : 1);
+
+  if (!ptr) {
+    fprintf(stderr, "Out of memory while trying to allocate %zu bytes\n", size);
+    abort();
+  }
+
+  num_allocs++;
+  return ptr;
+}
+
+void *brealloc(void *ptr, size_t size) {
+  if (!ptr)
+    num_allocs++;
+
+  ptr = realloc(ptr, size ? size : 1);
+
+  if (!ptr) {
+    fprintf(stderr, "Out of memory while trying to allocate %zu bytes\n", size);
+    abort();
+  }
+
+  return ptr;
+}
+
+void bfree(void *ptr) {
+  if (ptr) {
+    num_allocs--;
+    free(ptr);
+  }
+}
+
+int base_get_alignment(void) {
+  return 16;
+}
+
+long bnum_allocs(void) {
+  return num_allocs;
+}
+
+void *bmemdup(const void *ptr, size_t size) {
+  void *out = bmalloc(size);
+  if (size)
+    memcpy(out, ptr, size);
+  return out;
+}
+
+uint64_t os_gettime_ns(void) {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+bool os_get_proc_memory_usage(os_proc_memory_usage_t *usage) {
+  // statm is in pages: total size, then resident.
+  FILE *f = fopen("/proc/self/statm", "r");
+  unsigned long long size = 0, resident = 0;
+
+  if (!f)
+    return false;
+
+  bool ok = fscanf(f, "%llu %llu", &size, &resident) == 2;
+  fclose(f);
+
+  long page = sysconf(_SC_PAGESIZE);
+  usage->virtual_size = size * page;
+  usage->resident_size = resident * page;
+  return ok;
+}
+
+FILE *os_fopen(const char *path, const char *mode) {
+  return fopen(path, mode);
+}
+
+int os_fseeki64(FILE *file, int64_t offset, int origin) {
+  return fseeko(file, (off_t)offset, origin);
+}
+
+int64_t os_ftelli64(FILE *file) {
+  return (int64_t)ftello(file);
+}
+
+int os_rename(const char *old_path, const char *new_path) {
+  return rename(old_path, new_path);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Calldata, using the libobs stack layout since calldata_clear and friends
+ * are inline in the header:
+ *   [size_t name_size][name\0][size_t data_size][data] ... [size_t 0] */
+
+// Entries are packed, so sizes are not aligned.
+static size_t cd_size(const uint8_t *p) {
+  size_t size;
+  memcpy(&size, p, sizeof(size_t));
+  return size;
+}
+
+static bool cd_find(const calldata_t *data, const char *name, uint8_t **pos) {
+  if (!data->stack)
+    return false;
+
+  uint8_t *p = data->stack;
+
+  while (true) {
+    size_t name_size = cd_size(p);
+
+    if (!name_size) {
+      *pos = p;
+      return false;
+    }
+
+    if (strcmp((const char *)p + sizeof(size_t), name) == 0) {
+      *pos = p;
+      return true;
+    }
+
+    p += sizeof(size_t) + name_size;
+    p += sizeof(size_t) + cd_size(p);
+  }
+}
+
+static size_t cd_entry_size(const uint8_t *p) {
+  size_t name_size = cd_size(p);
+  size_t data_size = cd_size(p + sizeof(size_t) + name_size);
+  return sizeof(size_t) * 2 + name_size + data_size;
+}
+
+bool calldata_get_data(const calldata_t *data, const char *name, void *out, size_t size) {
+  uint8_t *p;
+
+  if (!cd_find(data, name, &p))
+    return false;
+
+  size_t name_size = cd_size(p);
+  p += sizeof(size_t) + name_size;
+
+  if (cd_size(p) != size)
+    return false;
+
+  memcpy(out, p + sizeof(size_t), size);
+  return true;
+}
+
+void calldata_set_data(calldata_t *data, const char *name, const void *in, size_t size) {
+  if (!data->stack) {
+    data->capacity = 128;
+    data->stack = (uint8_t *)bzalloc(data->capacity);
+    data->size = sizeof(size_t);
+  }
+
+  uint8_t *p;
+
+  if (cd_find(data, name, &p)) {
+    // Drop the old entry, the new one is appended below.
+    size_t entry = cd_entry_size(p);
+    size_t tail = data->size - (size_t)(p - data->stack) - entry;
+    memmove(p, p + entry, tail);
+    data->size -= entry;
+  }
+
+  size_t name_size = strlen(name) + 1;
+  size_t needed = data->size + sizeof(size_t) * 2 + name_size + size;
+
+  if (needed > data->capacity) {
+    if (data->fixed) {
+      blog(LOG_ERROR, "calldata_set_data: fixed stack too small for '%s'", name);
+      return;
+    }
+
+    data->capacity = std::max(needed, data->capacity * 2);
+    data->stack = (uint8_t *)brealloc(data->stack, data->capacity);
+  }
+
+  p = data->stack + data->size - sizeof(size_t);
+  memcpy(p, &name_size, sizeof(size_t));
+  p += sizeof(size_t);
+  memcpy(p, name, name_size);
+  p += name_size;
+  memcpy(p, &size, sizeof(size_t));
+  p += sizeof(size_t);
+  if (size)
+    memcpy(p, in, size);
+  p += size;
+  memset(p, 0, sizeof(size_t));
+
+  data->size = needed;
+}
+
+bool calldata_get_string(const calldata_t *data, const char *name, const char **str) {
+  uint8_t *p;
+
+  if (!cd_find(data, name, &p))
+    return false;
+
+  size_t name_size = cd_size(p);
+  p += sizeof(size_t) + name_size;
+  *str = cd_size(p) ? (const char *)(p + sizeof(size_t)) : nullptr;
+  return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Signal and procedure handlers */
+
+struct signal_callback {
+  std::string signal;
+  signal_callback_t callback;
+  void *data;
+};
+
+struct signal_handler {
+  std::recursive_mutex mutex;
+  std::vector<signal_callback> callbacks;
+};
+
+signal_handler_t *signal_handler_create(void) {
+  return new signal_handler;
+}
+
+void signal_handler_destroy(signal_handler_t *handler) {
+  delete handler;
+}
+
+bool signal_handler_add(signal_handler_t *handler, const char *signal_decl) {
+  return true; // Signals are matched by name only.
+}
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data) {
+  std::lock_guard<std::recursive_mutex> guard(handler->mutex);
+  handler->callbacks.push_back({ signal, callback, data });
+}
+
+void signal_handler_connect_ref(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data) {
+  signal_handler_connect(handler, signal, callback, data);
+}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data) {
+  std::lock_guard<std::recursive_mutex> guard(handler->mutex);
+  auto &cbs = handler->callbacks;
+
+  cbs.erase(std::remove_if(cbs.begin(), cbs.end(), [&](const signal_callback &cb) {
+    return cb.signal == signal && cb.callback == callback && cb.data == data;
+  }), cbs.end());
+}
+
+void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params) {
+  std::vector<signal_callback> cbs;
+
+  {
+    std::lock_guard<std::recursive_mutex> guard(handler->mutex);
+    cbs = handler->callbacks;
+  }
+
+  for (const auto &cb : cbs) {
+    if (cb.signal == signal)
+      cb.callback(cb.data, params);
+  }
+}
+
+struct proc_info {
+  proc_handler_proc_t proc;
+  void *data;
+};
+
+struct proc_handler {
+  std::map<std::string, proc_info> procs;
+};
+
+proc_handler_t *proc_handler_create(void) {
+  return new proc_handler;
+}
+
+void proc_handler_destroy(proc_handler_t *handler) {
+  delete handler;
+}
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data) {
+  // Declarations look like "void convert(in int offset_seconds)".
+  std::string decl = decl_string;
+  size_t end = decl.find('(');
+  size_t start = decl.rfind(' ', end);
+  start = start == std::string::npos ? 0 : start + 1;
+  handler->procs[decl.substr(start, end - start)] = { proc, data };
+}
+
+bool proc_handler_call(proc_handler_t *handler, const char *name, calldata_t *params) {
+  auto it = handler->procs.find(name);
+
+  if (it == handler->procs.end())
+    return false;
+
+  it->second.proc(it->second.data, params);
+  return true;
+}
@@ -0,0 +1,501 @@
+#include "fake-libobs.h"
+#include <util/platform.h>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+
+static bool obs_is_initialized = false;
+static obs_video_info current_ovi = {};
+static obs_audio_info current_oai = {};
+static bool video_reset = false;
+static bool audio_reset = false;
+
+// Every reset creates a new video_t like libobs does, encoders bound to an
+// old one are kept valid until shutdown.
+static std::vector<video_t*> videos;
+static std::vector<audio_t*> audios;
+
+static obs_source_t *channels[MAX_CHANNELS] = {};
+
+struct obs_module {
+  std::string path;
+};
+
+static std::vector<obs_module_t*> modules;
+
+static std::thread video_thread;
+static std::condition_variable_any video_cv;
+static bool video_thread_exit = false;
+static uint64_t video_frame = 0;
+static uint64_t video_time = 0; // Virtual clock, advanced a frame interval per frame.
+
+struct tick_callback {
+  void (*tick)(void *param, float seconds);
+  void *param;
+};
+
+static std::vector<tick_callback> tick_callbacks;
+
+// Raw video consumers get a synthetic frame in the format and size they ask
+// for, the buffer is owned here so the callback sees stable planes.
+struct raw_video_callback {
+  video_scale_info conversion;
+  uint32_t divisor;
+  void (*callback)(void *param, struct video_data *frame);
+  void *param;
+  std::vector<uint8_t> buffer;
+};
+
+static std::vector<raw_video_callback*> raw_video_callbacks;
+
+static void fill_raw_frame(raw_video_callback *raw, uint64_t frame, video_data *out) {
+  uint32_t w = raw->conversion.width;
+  uint32_t h = raw->conversion.height;
+  uint8_t shade = (uint8_t)(frame * 4);
+  *out = {};
+
+  switch (raw->conversion.format) {
+  case VIDEO_FORMAT_NV12:
+    raw->buffer.resize((size_t)w * h * 3 / 2);
+    memset(raw->buffer.data(), shade, (size_t)w * h);
+    memset(raw->buffer.data() + (size_t)w * h, 128, (size_t)w * h / 2);
+    out->data[0] = raw->buffer.data();
+    out->data[1] = raw->buffer.data() + (size_t)w * h;
+    out->linesize[0] = w;
+    out->linesize[1] = w;
+    break;
+  default: // Treat everything else as packed 32 bit.
+    raw->buffer.resize((size_t)w * h * 4);
+    for (size_t i = 0; i < raw->buffer.size(); i += 4) {
+      raw->buffer[i] = shade;
+      raw->buffer[i + 1] = shade;
+      raw->buffer[i + 2] = shade;
+      raw->buffer[i + 3] = 255;
+    }
+    out->data[0] = raw->buffer.data();
+    out->linesize[0] = w * 4;
+    break;
+  }
+
+  out->timestamp = video_time;
+}
+
+std::recursive_mutex &fake::lock() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
+bool fake::initialized() {
+  return obs_is_initialized;
+}
+
+const obs_video_info &fake::video_info() {
+  return current_ovi;
+}
+
+const obs_audio_info &fake::audio_info() {
+  return current_oai;
+}
+
+uint64_t fake::frame_interval_ns() {
+  if (!current_ovi.fps_num)
+    return 1000000000ULL / 60;
+
+  return 1000000000ULL * current_ovi.fps_den / current_ovi.fps_num;
+}
+
+uint64_t fake::video_time_ns() {
+  return video_time;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Video thread, drives sources and outputs at the configured frame rate */
+
+// Frames are laid out on the virtual clock and the thread only waits for
+// each to come due. One that comes due late still runs, straight after the
+// one before, so a run produces the same frames, timestamps and packets
+// however busy the machine was. Only how far it gets depends on wall time.
+static void video_thread_main() {
+  uint64_t epoch;
+
+  {
+    std::lock_guard<std::recursive_mutex> guard(fake::lock());
+    epoch = os_gettime_ns() - video_time; // Carry on from where a previous run left off.
+  }
+
+  while (true) {
+    fake::deferred calls;
+
+    {
+      std::unique_lock<std::recursive_mutex> guard(fake::lock());
+      uint64_t interval = fake::frame_interval_ns();
+      uint64_t due = epoch + video_time + interval;
+      uint64_t now = os_gettime_ns();
+
+      if (due > now) {
+        auto wait = std::chrono::nanoseconds(due - now);
+        video_cv.wait_for(guard, wait, [] { return video_thread_exit; });
+      }
+
+      if (video_thread_exit)
+        break;
+
+      video_time += interval;
+
+      // Like volmeters these are called under the lock so removal is safe.
+      float seconds = (float)interval / 1000000000.0f;
+      for (auto &cb : std::vector<tick_callback>(tick_callbacks))
+        cb.tick(cb.param, seconds);
+
+      for (raw_video_callback *raw : std::vector<raw_video_callback*>(raw_video_callbacks)) {
+        if (video_frame % raw->divisor != 0)
+          continue;
+
+        video_data data;
+        fill_raw_frame(raw, video_frame, &data);
+        raw->callback(raw->param, &data);
+      }
+
+      fake::tick_sources(video_frame, calls);
+      fake::tick_outputs(video_frame, calls);
+      video_frame++;
+    }
+
+    for (auto &call : calls)
+      call();
+  }
+}
+
+static void start_video_thread() {
+  if (video_thread.joinable())
+    return;
+
+  video_thread_exit = false;
+  video_thread = std::thread(video_thread_main);
+}
+
+static void stop_video_thread() {
+  {
+    std::lock_guard<std::recursive_mutex> guard(fake::lock());
+    video_thread_exit = true;
+  }
+
+  video_cv.notify_all();
+
+  if (video_thread.joinable())
+    video_thread.join();
+}
+
+void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  tick_callbacks.push_back({tick, param});
+}
+
+void obs_remove_tick_callback(void (*tick)(void *param, float seconds), void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  for (auto it = tick_callbacks.begin(); it != tick_callbacks.end(); ++it) {
+    if (it->tick == tick && it->param == param) {
+      tick_callbacks.erase(it);
+      return;
+    }
+  }
+}
+
+void obs_add_raw_video_callback2(const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
+                                 void (*callback)(void *param, struct video_data *frame), void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  raw_video_callback *raw = new raw_video_callback{};
+  video_scale_info scale = {};
+  scale.format = VIDEO_FORMAT_NV12;
+  scale.width = current_ovi.output_width;
+  scale.height = current_ovi.output_height;
+  raw->conversion = conversion ? *conversion : scale;
+  raw->divisor = frame_rate_divisor ? frame_rate_divisor : 1;
+  raw->callback = callback;
+  raw->param = param;
+  raw_video_callbacks.push_back(raw);
+}
+
+void obs_remove_raw_video_callback(void (*callback)(void *param, struct video_data *frame), void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  for (auto it = raw_video_callbacks.begin(); it != raw_video_callbacks.end(); ++it) {
+    if ((*it)->callback == callback && (*it)->param == param) {
+      delete *it;
+      raw_video_callbacks.erase(it);
+      return;
+    }
+  }
+}
+
+uint32_t obs_get_lagged_frames(void) {
+  return 0; // The fake never falls behind, frames are only counted.
+}
+
+/* ------------------------------------------------------------------------- */
+/* Startup and shutdown */
+
+bool obs_startup(const char *locale, const char *module_config_path, profiler_name_store_t *store) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (obs_is_initialized) {
+    blog(LOG_ERROR, "Tried to call obs_startup more than once");
+    return false;
+  }
+
+  blog(LOG_INFO, "Starting fake libobs (headless)");
+  obs_is_initialized = true;
+  video_frame = 0;
+  video_time = 0;
+  return true;
+}
+
+void obs_shutdown(void) {
+  stop_video_thread();
+
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!obs_is_initialized)
+    return;
+
+  for (auto &channel : channels) {
+    obs_source_release(channel);
+    channel = nullptr;
+  }
+
+  fake::release_all();
+
+  for (video_t *video : videos)
+    delete video;
+  for (audio_t *audio : audios)
+    delete audio;
+
+  for (obs_module_t *module : modules)
+    delete module;
+
+  videos.clear();
+  audios.clear();
+  modules.clear();
+  video_reset = false;
+  audio_reset = false;
+  obs_is_initialized = false;
+
+  blog(LOG_INFO, "Fake libobs shut down, %ld allocations remaining", bnum_allocs());
+}
+
+bool obs_initialized(void) {
+  return obs_is_initialized;
+}
+
+void obs_add_data_path(const char *path) {}
+
+/* ------------------------------------------------------------------------- */
+/* Modules, every module "loads" but hardware encoders find no hardware */
+
+int obs_open_module(obs_module_t **module, const char *path, const char *data_path) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  *module = new obs_module{ path };
+  modules.push_back(*module);
+  return MODULE_SUCCESS;
+}
+
+bool obs_init_module(obs_module_t *module) {
+  return module->path.find("obs-nvenc") == std::string::npos;
+}
+
+void obs_post_load_modules(void) {}
+
+/* ------------------------------------------------------------------------- */
+/* Video and audio contexts */
+
+int obs_reset_video(struct obs_video_info *ovi) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!obs_is_initialized)
+    return OBS_VIDEO_FAIL;
+
+  for (obs_output_t *output : fake::outputs()) {
+    if (output->active)
+      return OBS_VIDEO_CURRENTLY_ACTIVE;
+  }
+
+  // Like libobs, a connected raw video callback keeps video active.
+  if (!raw_video_callbacks.empty())
+    return OBS_VIDEO_CURRENTLY_ACTIVE;
+
+  if (!ovi->fps_num || !ovi->fps_den || !ovi->base_width || !ovi->base_height ||
+      !ovi->output_width || !ovi->output_height)
+    return OBS_VIDEO_INVALID_PARAM;
+
+  current_ovi = *ovi;
+  current_ovi.graphics_module = nullptr; // Caller owns the string.
+  videos.push_back(new video_t{ current_ovi });
+  video_reset = true;
+
+  blog(LOG_INFO, "Fake video reset: %ux%u -> %ux%u @ %u/%u", ovi->base_width, ovi->base_height,
+       ovi->output_width, ovi->output_height, ovi->fps_num, ovi->fps_den);
+
+  start_video_thread();
+  return OBS_VIDEO_SUCCESS;
+}
+
+bool obs_reset_audio(const struct obs_audio_info *oai) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!obs_is_initialized)
+    return false;
+
+  current_oai = *oai;
+  audios.push_back(new audio_t{ current_oai });
+  audio_reset = true;
+  return true;
+}
+
+bool obs_get_video_info(struct obs_video_info *ovi) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!video_reset)
+    return false;
+
+  *ovi = current_ovi;
+  return true;
+}
+
+bool obs_get_audio_info(struct obs_audio_info *oai) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!audio_reset)
+    return false;
+
+  *oai = current_oai;
+  return true;
+}
+
+video_t *obs_get_video(void) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return videos.empty() ? nullptr : videos.back();
+}
+
+audio_t *obs_get_audio(void) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return audios.empty() ? nullptr : audios.back();
+}
+
+void obs_set_output_source(uint32_t channel, obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (channel >= MAX_CHANNELS)
+    return;
+
+  if (source)
+    source->refs++;
+
+  obs_source_release(channels[channel]);
+  channels[channel] = source;
+}
+
+obs_source_t *obs_get_output_source(uint32_t channel) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (channel >= MAX_CHANNELS)
+    return nullptr;
+
+  return obs_source_get_ref(channels[channel]);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Graphics, there is no device so drawing is a no-op and no display can be
+ * created */
+
+struct gs_effect {
+  int unused;
+};
+
+struct gs_effect_technique {
+  int unused;
+};
+
+struct gs_effect_param {
+  int unused;
+};
+
+static gs_effect_t base_effect;
+static gs_technique_t base_technique;
+static gs_eparam_t base_param;
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect) { return &base_effect; }
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name) { return &base_param; }
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect, const char *name) { return &base_technique; }
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val) {}
+size_t gs_technique_begin(gs_technique_t *technique) { return 1; }
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass) { return true; }
+void gs_technique_end_pass(gs_technique_t *technique) {}
+void gs_technique_end(gs_technique_t *technique) {}
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts) {}
+void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer) {}
+void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer) {}
+void obs_enter_graphics(void) {}
+void obs_leave_graphics(void) {}
+
+// Vertex buffers keep their data so callers can fill and flush them.
+struct gs_vertex_buffer {
+  gs_vb_data *data;
+};
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data, uint32_t flags) {
+  return new gs_vertex_buffer{ data };
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer) {
+  if (!vertbuffer)
+    return;
+
+  gs_vbdata_destroy(vertbuffer->data);
+  delete vertbuffer;
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer) {
+  return vertbuffer->data;
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer) {}
+void gs_matrix_push(void) {}
+void gs_matrix_pop(void) {}
+void gs_matrix_identity(void) {}
+void gs_ortho(float left, float right, float top, float bottom, float znear, float zfar) {}
+void gs_projection_push(void) {}
+void gs_projection_pop(void) {}
+void gs_viewport_push(void) {}
+void gs_viewport_pop(void) {}
+void gs_set_viewport(int x, int y, int width, int height) {}
+void obs_render_main_texture(void) {}
+
+obs_display_t *obs_display_create(const struct gs_init_data *graphics_data, uint32_t backround_color) {
+  blog(LOG_WARNING, "obs_display_create: no graphics device in fake libobs");
+  return nullptr;
+}
+
+void obs_display_destroy(obs_display_t *display) {}
+
+void obs_display_add_draw_callback(obs_display_t *display, void (*draw)(void *param, uint32_t cx, uint32_t cy), void *param) {}
+
+void obs_display_remove_draw_callback(obs_display_t *display, void (*draw)(void *param, uint32_t cx, uint32_t cy), void *param) {}
+
+void obs_display_resize(obs_display_t *display, uint32_t cx, uint32_t cy) {
+  if (display) {
+    display->cx = cx;
+    display->cy = cy;
+  }
+}
+
+void obs_display_set_enabled(obs_display_t *display, bool enable) {
+  if (display)
+    display->enabled = enable;
+}
+
+void obs_display_size(obs_display_t *display, uint32_t *width, uint32_t *height) {
+  *width = display ? display->cx : 0;
+  *height = display ? display->cy : 0;
+}
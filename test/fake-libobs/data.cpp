@@ -0,0 +1,529 @@
+#include "fake-libobs.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+/* ------------------------------------------------------------------------- */
+/* Settings */
+
+static obs_data_item_t *find_item(std::vector<obs_data_item_t*> &items, const char *name) {
+  for (obs_data_item_t *item : items) {
+    if (item->name == name)
+      return item;
+  }
+
+  return nullptr;
+}
+
+static void clear_item(obs_data_item_t *item) {
+  if (item->obj)
+    obs_data_release(item->obj);
+  if (item->array)
+    obs_data_array_release(item->array);
+
+  item->obj = nullptr;
+  item->array = nullptr;
+}
+
+static obs_data_item_t *set_item(obs_data_t *data, std::vector<obs_data_item_t*> &items, const char *name, obs_data_type type) {
+  obs_data_item_t *item = find_item(items, name);
+
+  if (!item) {
+    item = new obs_data_item{ data, name, type, OBS_DATA_NUM_INVALID, "", 0, 0.0, false, nullptr, nullptr };
+    items.push_back(item);
+  }
+
+  clear_item(item);
+  item->type = type;
+  return item;
+}
+
+static obs_data_item_t *get_item(obs_data_t *data, const char *name) {
+  if (!data)
+    return nullptr;
+
+  obs_data_item_t *item = find_item(data->items, name);
+  return item ? item : find_item(data->defaults, name);
+}
+
+obs_data_t *obs_data_create() {
+  return new obs_data;
+}
+
+void obs_data_addref(obs_data_t *data) {
+  if (data)
+    data->refs++;
+}
+
+void obs_data_release(obs_data_t *data) {
+  if (!data || --data->refs > 0)
+    return;
+
+  for (auto *items : { &data->items, &data->defaults }) {
+    for (obs_data_item_t *item : *items) {
+      clear_item(item);
+      delete item;
+    }
+  }
+
+  delete data;
+}
+
+void obs_data_erase(obs_data_t *data, const char *name) {
+  auto &items = data->items;
+
+  for (auto it = items.begin(); it != items.end(); ++it) {
+    if ((*it)->name == name) {
+      clear_item(*it);
+      delete *it;
+      items.erase(it);
+      return;
+    }
+  }
+}
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val) {
+  set_item(data, data->items, name, OBS_DATA_STRING)->str = val ? val : "";
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val) {
+  obs_data_item_t *item = set_item(data, data->items, name, OBS_DATA_NUMBER);
+  item->num_type = OBS_DATA_NUM_INT;
+  item->int_val = val;
+  item->double_val = (double)val;
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val) {
+  obs_data_item_t *item = set_item(data, data->items, name, OBS_DATA_NUMBER);
+  item->num_type = OBS_DATA_NUM_DOUBLE;
+  item->int_val = (long long)val;
+  item->double_val = val;
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val) {
+  set_item(data, data->items, name, OBS_DATA_BOOLEAN)->bool_val = val;
+}
+
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj) {
+  obs_data_addref(obj);
+  set_item(data, data->items, name, OBS_DATA_OBJECT)->obj = obj;
+}
+
+void obs_data_set_array(obs_data_t *data, const char *name, obs_data_array_t *array) {
+  obs_data_array_addref(array);
+  set_item(data, data->items, name, OBS_DATA_ARRAY)->array = array;
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val) {
+  set_item(data, data->defaults, name, OBS_DATA_STRING)->str = val ? val : "";
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val) {
+  obs_data_item_t *item = set_item(data, data->defaults, name, OBS_DATA_NUMBER);
+  item->num_type = OBS_DATA_NUM_INT;
+  item->int_val = val;
+  item->double_val = (double)val;
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val) {
+  set_item(data, data->defaults, name, OBS_DATA_BOOLEAN)->bool_val = val;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item && item->type == OBS_DATA_STRING ? item->str.c_str() : "";
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item && item->type == OBS_DATA_NUMBER ? item->int_val : 0;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item && item->type == OBS_DATA_NUMBER ? item->double_val : 0.0;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item && item->type == OBS_DATA_BOOLEAN ? item->bool_val : false;
+}
+
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item ? obs_data_item_get_obj(item) : nullptr;
+}
+
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name) {
+  obs_data_item_t *item = get_item(data, name);
+  return item ? obs_data_item_get_array(item) : nullptr;
+}
+
+bool obs_data_has_user_value(obs_data_t *data, const char *name) {
+  return data && find_item(data->items, name);
+}
+
+void obs_data_apply(obs_data_t *target, obs_data_t *apply_data) {
+  if (!target || !apply_data || target == apply_data)
+    return;
+
+  for (obs_data_item_t *src : apply_data->items) {
+    obs_data_item_t *dst = set_item(target, target->items, src->name.c_str(), src->type);
+    dst->num_type = src->num_type;
+    dst->str = src->str;
+    dst->int_val = src->int_val;
+    dst->double_val = src->double_val;
+    dst->bool_val = src->bool_val;
+    dst->obj = src->obj;
+    dst->array = src->array;
+    obs_data_addref(dst->obj);
+    obs_data_array_addref(dst->array);
+  }
+}
+
+static void append_json_string(std::ostringstream &out, const std::string &str) {
+  out << '"';
+
+  for (char c : str) {
+    switch (c) {
+      case '"':  out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\r': out << "\\r"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          out << buf;
+        } else {
+          out << c;
+        }
+    }
+  }
+
+  out << '"';
+}
+
+static void append_json(std::ostringstream &out, obs_data_t *data);
+
+static void append_json_item(std::ostringstream &out, obs_data_item_t *item) {
+  switch (item->type) {
+    case OBS_DATA_STRING:
+      append_json_string(out, item->str);
+      break;
+    case OBS_DATA_NUMBER:
+      if (item->num_type == OBS_DATA_NUM_INT) {
+        out << item->int_val;
+      } else {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", item->double_val);
+        out << buf;
+      }
+      break;
+    case OBS_DATA_BOOLEAN:
+      out << (item->bool_val ? "true" : "false");
+      break;
+    case OBS_DATA_OBJECT:
+      append_json(out, item->obj);
+      break;
+    case OBS_DATA_ARRAY:
+      out << '[';
+      for (size_t i = 0; item->array && i < item->array->items.size(); i++) {
+        if (i) out << ',';
+        append_json(out, item->array->items[i]);
+      }
+      out << ']';
+      break;
+    default:
+      out << "null";
+  }
+}
+
+static void append_json(std::ostringstream &out, obs_data_t *data) {
+  out << '{';
+
+  for (size_t i = 0; data && i < data->items.size(); i++) {
+    if (i) out << ',';
+    append_json_string(out, data->items[i]->name);
+    out << ':';
+    append_json_item(out, data->items[i]);
+  }
+
+  out << '}';
+}
+
+const char *obs_data_get_json(obs_data_t *data) {
+  if (!data)
+    return nullptr;
+
+  std::ostringstream out;
+  append_json(out, data);
+  data->json = out.str();
+  return data->json.c_str();
+}
+
+obs_data_item_t *obs_data_first(obs_data_t *data) {
+  return data && !data->items.empty() ? data->items.front() : nullptr;
+}
+
+obs_data_item_t *obs_data_item_byname(obs_data_t *data, const char *name) {
+  if (!data || !name)
+    return nullptr;
+
+  for (obs_data_item_t *item : data->items) {
+    if (item->name == name)
+      return item;
+  }
+
+  return nullptr;
+}
+
+bool obs_data_item_next(obs_data_item_t **item) {
+  if (!item || !*item)
+    return false;
+
+  auto &items = (*item)->parent->items;
+
+  for (size_t i = 0; i < items.size(); i++) {
+    if (items[i] == *item) {
+      *item = i + 1 < items.size() ? items[i + 1] : nullptr;
+      return *item != nullptr;
+    }
+  }
+
+  *item = nullptr;
+  return false;
+}
+
+void obs_data_item_release(obs_data_item_t **item) {
+  if (item)
+    *item = nullptr; // Items are owned by their data.
+}
+
+enum obs_data_type obs_data_item_gettype(obs_data_item_t *item) {
+  return item ? item->type : OBS_DATA_NULL;
+}
+
+enum obs_data_number_type obs_data_item_numtype(obs_data_item_t *item) {
+  return item ? item->num_type : OBS_DATA_NUM_INVALID;
+}
+
+const char *obs_data_item_get_name(obs_data_item_t *item) {
+  return item ? item->name.c_str() : nullptr;
+}
+
+const char *obs_data_item_get_string(obs_data_item_t *item) {
+  return item && item->type == OBS_DATA_STRING ? item->str.c_str() : "";
+}
+
+long long obs_data_item_get_int(obs_data_item_t *item) {
+  return item ? item->int_val : 0;
+}
+
+double obs_data_item_get_double(obs_data_item_t *item) {
+  return item ? item->double_val : 0.0;
+}
+
+bool obs_data_item_get_bool(obs_data_item_t *item) {
+  return item ? item->bool_val : false;
+}
+
+obs_data_t *obs_data_item_get_obj(obs_data_item_t *item) {
+  if (!item || item->type != OBS_DATA_OBJECT)
+    return nullptr;
+
+  obs_data_addref(item->obj);
+  return item->obj;
+}
+
+obs_data_array_t *obs_data_item_get_array(obs_data_item_t *item) {
+  if (!item || item->type != OBS_DATA_ARRAY)
+    return nullptr;
+
+  obs_data_array_addref(item->array);
+  return item->array;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Settings arrays */
+
+obs_data_array_t *obs_data_array_create() {
+  return new obs_data_array;
+}
+
+void obs_data_array_addref(obs_data_array_t *array) {
+  if (array)
+    array->refs++;
+}
+
+void obs_data_array_release(obs_data_array_t *array) {
+  if (!array || --array->refs > 0)
+    return;
+
+  for (obs_data_t *data : array->items)
+    obs_data_release(data);
+
+  delete array;
+}
+
+size_t obs_data_array_count(obs_data_array_t *array) {
+  return array ? array->items.size() : 0;
+}
+
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx) {
+  if (!array || idx >= array->items.size())
+    return nullptr;
+
+  obs_data_addref(array->items[idx]);
+  return array->items[idx];
+}
+
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj) {
+  obs_data_addref(obj);
+  array->items.push_back(obj);
+  return array->items.size() - 1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Properties, only lists are described in any detail */
+
+obs_property_t *fake::add_property(obs_properties_t *props, const char *name, const char *desc, obs_property_type type) {
+  obs_property_t *p = new obs_property;
+  p->parent = props;
+  p->name = name;
+  p->description = desc ? desc : "";
+  p->type = type;
+  props->props.push_back(p);
+  return p;
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description) {
+  return fake::add_property(props, name, description, OBS_PROPERTY_BOOL);
+}
+
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description, int min, int max, int step) {
+  obs_property_t *p = fake::add_property(props, name, description, OBS_PROPERTY_INT);
+  p->min = min;
+  p->max = max;
+  p->step = step;
+  return p;
+}
+
+obs_property_t *obs_properties_add_float(obs_properties_t *props, const char *name, const char *description, double min, double max, double step) {
+  obs_property_t *p = fake::add_property(props, name, description, OBS_PROPERTY_FLOAT);
+  p->min = min;
+  p->max = max;
+  p->step = step;
+  return p;
+}
+
+obs_property_t *obs_properties_add_text(obs_properties_t *props, const char *name, const char *description, enum obs_text_type type) {
+  obs_property_t *p = fake::add_property(props, name, description, OBS_PROPERTY_TEXT);
+  p->text_type = type;
+  return p;
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description, enum obs_combo_type type, enum obs_combo_format format) {
+  obs_property_t *p = fake::add_property(props, name, description, OBS_PROPERTY_LIST);
+  p->combo_type = type;
+  p->combo_format = format;
+  return p;
+}
+
+size_t obs_property_list_add_string(obs_property_t *p, const char *name, const char *val) {
+  p->list.push_back({ name, val });
+  return p->list.size() - 1;
+}
+
+size_t obs_property_list_add_int(obs_property_t *p, const char *name, long long val) {
+  p->list.push_back({ name, std::to_string(val) });
+  return p->list.size() - 1;
+}
+
+size_t obs_property_list_add_float(obs_property_t *p, const char *name, double val) {
+  p->list.push_back({ name, std::to_string(val) });
+  return p->list.size() - 1;
+}
+
+obs_properties_t *obs_properties_create(void) {
+  return new obs_properties;
+}
+
+void obs_properties_destroy(obs_properties_t *props) {
+  if (!props)
+    return;
+
+  for (obs_property_t *p : props->props)
+    delete p;
+
+  delete props;
+}
+
+obs_property_t *obs_properties_first(obs_properties_t *props) {
+  return props && !props->props.empty() ? props->props.front() : nullptr;
+}
+
+bool obs_property_next(obs_property_t **p) {
+  if (!p || !*p)
+    return false;
+
+  auto &props = (*p)->parent->props;
+
+  for (size_t i = 0; i < props.size(); i++) {
+    if (props[i] == *p) {
+      *p = i + 1 < props.size() ? props[i + 1] : nullptr;
+      return *p != nullptr;
+    }
+  }
+
+  *p = nullptr;
+  return false;
+}
+
+const char *obs_property_name(obs_property_t *p) { return p->name.c_str(); }
+const char *obs_property_description(obs_property_t *p) { return p->description.c_str(); }
+enum obs_property_type obs_property_get_type(obs_property_t *p) { return p->type; }
+bool obs_property_enabled(obs_property_t *p) { return true; }
+bool obs_property_visible(obs_property_t *p) { return true; }
+
+int obs_property_int_min(obs_property_t *p) { return (int)p->min; }
+int obs_property_int_max(obs_property_t *p) { return (int)p->max; }
+int obs_property_int_step(obs_property_t *p) { return (int)p->step; }
+enum obs_number_type obs_property_int_type(obs_property_t *p) { return OBS_NUMBER_SCROLLER; }
+double obs_property_float_min(obs_property_t *p) { return p->min; }
+double obs_property_float_max(obs_property_t *p) { return p->max; }
+double obs_property_float_step(obs_property_t *p) { return p->step; }
+enum obs_number_type obs_property_float_type(obs_property_t *p) { return OBS_NUMBER_SCROLLER; }
+enum obs_text_type obs_property_text_type(obs_property_t *p) { return p->text_type; }
+enum obs_path_type obs_property_path_type(obs_property_t *p) { return OBS_PATH_FILE; }
+const char *obs_property_path_filter(obs_property_t *p) { return ""; }
+const char *obs_property_path_default_path(obs_property_t *p) { return ""; }
+
+enum obs_combo_type obs_property_list_type(obs_property_t *p) { return p->combo_type; }
+enum obs_combo_format obs_property_list_format(obs_property_t *p) { return p->combo_format; }
+size_t obs_property_list_item_count(obs_property_t *p) { return p->list.size(); }
+bool obs_property_list_item_disabled(obs_property_t *p, size_t idx) { return false; }
+
+const char *obs_property_list_item_name(obs_property_t *p, size_t idx) {
+  return idx < p->list.size() ? p->list[idx].first.c_str() : nullptr;
+}
+
+const char *obs_property_list_item_string(obs_property_t *p, size_t idx) {
+  return idx < p->list.size() ? p->list[idx].second.c_str() : nullptr;
+}
+
+long long obs_property_list_item_int(obs_property_t *p, size_t idx) {
+  return idx < p->list.size() ? atoll(p->list[idx].second.c_str()) : 0;
+}
+
+double obs_property_list_item_float(obs_property_t *p, size_t idx) {
+  return idx < p->list.size() ? atof(p->list[idx].second.c_str()) : 0.0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+float obs_db_to_mul(float db) {
+  return isfinite(db) ? powf(10.0f, db / 20.0f) : 0.0f;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+// Deterministic stand-in for the parts of libobs the addon calls, so the
+// addon can be built and load-tested on a headless Linux box. There is no
+// graphics, capture or real encoding: sources report fixed sizes, a video
+// thread ticks at the configured fps on a virtual clock producing synthetic
+// packets and meter levels, and outputs write a minimal MP4 so file handling
+// can be exercised.
+
+#include <obs.h>
+#include <obs-audio-controls.h>
+#include <callback/signal.h>
+#include <callback/proc.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct obs_data_item {
+  obs_data_t *parent;
+  std::string name;
+  obs_data_type type;
+  obs_data_number_type num_type;
+  std::string str;
+  long long int_val;
+  double double_val;
+  bool bool_val;
+  obs_data_t *obj;
+  obs_data_array_t *array;
+};
+
+struct obs_data {
+  std::atomic<long> refs{1};
+  std::vector<obs_data_item*> items;
+  std::vector<obs_data_item*> defaults;
+  std::string json; // Backing store for obs_data_get_json.
+};
+
+struct obs_data_array {
+  std::atomic<long> refs{1};
+  std::vector<obs_data_t*> items;
+};
+
+struct obs_property {
+  obs_properties_t *parent;
+  std::string name;
+  std::string description;
+  obs_property_type type;
+  obs_combo_type combo_type = OBS_COMBO_TYPE_INVALID;
+  obs_combo_format combo_format = OBS_COMBO_FORMAT_INVALID;
+  std::vector<std::pair<std::string, std::string>> list; // name, value
+  double min = 0.0, max = 100000.0, step = 1.0; // Numbers only.
+  obs_text_type text_type = OBS_TEXT_DEFAULT;
+};
+
+struct obs_properties {
+  std::vector<obs_property*> props;
+};
+
+struct obs_source {
+  std::atomic<long> refs{1};
+  std::string id;
+  std::string name;
+  uint32_t output_flags; // OBS_SOURCE_VIDEO/AUDIO, by type.
+  uint32_t flags = 0;
+  uint32_t mixers = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  float volume = 1.0f;
+  bool muted = false;
+  bool removed = false;
+  int showing = 0;
+  obs_data_t *settings;
+  obs_scene_t *scene = nullptr; // Set if this is a scene's source.
+  std::vector<obs_source_t*> filters;
+  std::vector<std::pair<obs_source_audio_capture_t, void*>> audio_captures;
+  signal_handler_t *signals;
+};
+
+struct obs_scene_item {
+  obs_scene_t *parent;
+  obs_source_t *source;
+  vec2 pos = {};
+  vec2 scale = {1.0f, 1.0f};
+  obs_sceneitem_crop crop = {};
+  bool visible = true;
+};
+
+struct obs_scene {
+  obs_source_t *source;
+  std::vector<obs_sceneitem_t*> items;
+};
+
+struct obs_volmeter {
+  obs_source_t *source = nullptr;
+  std::vector<std::pair<obs_volmeter_updated_t, void*>> callbacks;
+};
+
+struct obs_display {
+  uint32_t cx, cy;
+  bool enabled;
+};
+
+// Opaque to the addon, it only passes these around.
+struct video_output {
+  obs_video_info ovi;
+};
+
+struct audio_output {
+  obs_audio_info oai;
+};
+
+struct fake_packet {
+  int64_t pts; // In encoder timebase (frames for video, samples for audio).
+  int64_t dts_usec;
+  bool keyframe;
+  bool video;
+  size_t track;
+  uint32_t size;
+};
+
+struct obs_encoder {
+  std::atomic<long> refs{1};
+  std::string id;
+  std::string name;
+  obs_encoder_type type;
+  obs_data_t *settings;
+  size_t mixer_idx = 0;
+  video_t *video = nullptr;
+  audio_t *audio = nullptr;
+  uint32_t scaled_width = 0;
+  uint32_t scaled_height = 0;
+  obs_scale_type gpu_scale_type = OBS_SCALE_DISABLE;
+  int64_t frame = 0; // Next frame (or sample) to encode.
+  uint64_t ticks = 0; // Video frames since the encoder started.
+  int active = 0; // Number of outputs using this encoder.
+};
+
+typedef void (*fake_packet_callback)(obs_output_t *output, struct encoder_packet *pkt,
+                                     struct encoder_packet_time *pkt_time, void *param);
+
+struct obs_output {
+  std::atomic<long> refs{1};
+  std::string id;
+  std::string name;
+  obs_data_t *settings;
+  signal_handler_t *signals;
+  proc_handler_t *procs;
+  obs_encoder_t *video_encoder = nullptr;
+  obs_encoder_t *audio_encoders[MAX_OUTPUT_AUDIO_ENCODERS] = {};
+  size_t mixers = 1;
+  bool active = false;
+  bool stopping = false;
+  bool recording = false; // Replay buffer only, set once converted.
+  std::string path;
+  std::string last_path;
+  std::string last_error;
+  std::vector<fake_packet> packets;
+  std::vector<std::pair<fake_packet_callback, void*>> packet_callbacks;
+};
+
+namespace fake {
+
+// One lock guards all fake state. libobs has finer grained locking but the
+// addon only ever cares that calls are thread safe.
+std::recursive_mutex &lock();
+
+bool initialized();
+const obs_video_info &video_info();
+const obs_audio_info &audio_info();
+uint64_t frame_interval_ns();
+uint64_t video_time_ns(); // The virtual clock, one frame interval per frame since startup.
+
+// Registries, all protected by lock().
+std::vector<obs_source_t*> &sources();
+std::vector<obs_output_t*> &outputs();
+std::vector<obs_volmeter_t*> &volmeters();
+
+// Callbacks into the addon are collected while the lock is held and run
+// after it is dropped, the addon's handlers are free to call back in.
+typedef std::vector<std::function<void()>> deferred;
+
+// Called from the video thread once per frame, with the lock held.
+void tick_sources(uint64_t frame, deferred &calls);
+void tick_outputs(uint64_t frame, deferred &calls);
+
+// Queue an output signal, holding a reference until it has fired.
+void queue_output_signal(deferred &calls, obs_output_t *output, const char *signal, long long code);
+
+void release_all(); // Called on shutdown to free anything the caller leaked.
+obs_property_t *add_property(obs_properties_t *props, const char *name, const char *desc, obs_property_type type);
+
+// Write packets out as a minimal MP4: ftyp, mdat and a trailing moov.
+bool write_mp4(const std::string &path, const std::vector<fake_packet> &packets, const obs_video_info &ovi);
+
+} // namespace fake
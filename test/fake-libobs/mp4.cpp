@@ -0,0 +1,178 @@
+#include "fake-libobs.h"
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+// Just enough MP4 structure for tools to recognise the file and for the
+// addon's own MP4 editing to find a moov to patch. There are no sample
+// tables, the mdat holds placeholder payloads of the right size.
+
+namespace {
+
+class box_writer {
+  public:
+    void u8(uint8_t v) { buf.push_back(v); }
+    void u16(uint16_t v) { u8(v >> 8); u8(v & 0xff); }
+    void u32(uint32_t v) { u16(v >> 16); u16(v & 0xffff); }
+    void u64(uint64_t v) { u32((uint32_t)(v >> 32)); u32((uint32_t)v); }
+    void fourcc(const char *cc) { for (int i = 0; i < 4; i++) u8(cc[i]); }
+    void zeros(size_t n) { buf.insert(buf.end(), n, 0); }
+
+    size_t begin(const char *type) {
+      size_t start = buf.size();
+      u32(0);
+      fourcc(type);
+      return start;
+    }
+
+    size_t begin_full(const char *type, uint8_t version, uint32_t flags) {
+      size_t start = begin(type);
+      u32((uint32_t)version << 24 | flags);
+      return start;
+    }
+
+    void end(size_t start) {
+      uint32_t size = (uint32_t)(buf.size() - start);
+      buf[start] = size >> 24;
+      buf[start + 1] = (size >> 16) & 0xff;
+      buf[start + 2] = (size >> 8) & 0xff;
+      buf[start + 3] = size & 0xff;
+    }
+
+    void matrix() {
+      static const uint32_t unity[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+      for (uint32_t v : unity) u32(v);
+    }
+
+    std::vector<uint8_t> buf;
+};
+
+void write_trak(box_writer &w, uint32_t track_id, bool video, uint32_t timescale, uint64_t media_duration,
+                uint32_t movie_duration, const obs_video_info &ovi) {
+  size_t trak = w.begin("trak");
+
+  size_t tkhd = w.begin_full("tkhd", 0, 0x3); // Enabled, in movie.
+  w.u32(0); // Creation time.
+  w.u32(0); // Modification time.
+  w.u32(track_id);
+  w.u32(0);
+  w.u32(movie_duration);
+  w.zeros(8);
+  w.u16(0); // Layer.
+  w.u16(video ? 0 : 1); // Alternate group.
+  w.u16(video ? 0 : 0x0100); // Volume.
+  w.u16(0);
+  w.matrix();
+  w.u32(video ? ovi.output_width << 16 : 0);
+  w.u32(video ? ovi.output_height << 16 : 0);
+  w.end(tkhd);
+
+  size_t mdia = w.begin("mdia");
+
+  size_t mdhd = w.begin_full("mdhd", 0, 0);
+  w.u32(0);
+  w.u32(0);
+  w.u32(timescale);
+  w.u32((uint32_t)media_duration);
+  w.u16(0x55c4); // Language "und".
+  w.u16(0);
+  w.end(mdhd);
+
+  size_t hdlr = w.begin_full("hdlr", 0, 0);
+  w.u32(0);
+  w.fourcc(video ? "vide" : "soun");
+  w.zeros(12);
+  const char *name = video ? "VideoHandler" : "SoundHandler";
+  for (const char *c = name; *c; c++) w.u8(*c);
+  w.u8(0);
+  w.end(hdlr);
+
+  w.end(mdia);
+  w.end(trak);
+}
+
+} // namespace
+
+bool fake::write_mp4(const std::string &path, const std::vector<fake_packet> &packets, const obs_video_info &ovi) {
+  FILE *f = fopen(path.c_str(), "wb");
+
+  if (!f) {
+    blog(LOG_ERROR, "fake mp4: unable to open %s", path.c_str());
+    return false;
+  }
+
+  box_writer head;
+  size_t ftyp = head.begin("ftyp");
+  head.fourcc("isom");
+  head.u32(512);
+  head.fourcc("isom");
+  head.fourcc("iso2");
+  head.fourcc("avc1");
+  head.fourcc("mp41");
+  head.end(ftyp);
+
+  uint64_t payload = 0;
+  int64_t first_usec = packets.empty() ? 0 : packets.front().dts_usec;
+  int64_t last_usec = first_usec;
+  uint64_t video_frames = 0;
+  std::set<size_t> audio_tracks;
+
+  for (const fake_packet &pkt : packets) {
+    payload += pkt.size;
+    first_usec = std::min(first_usec, pkt.dts_usec);
+    last_usec = std::max(last_usec, pkt.dts_usec);
+
+    if (pkt.video)
+      video_frames++;
+    else
+      audio_tracks.insert(pkt.track);
+  }
+
+  // mdat header, the payloads are streamed after it.
+  head.u32((uint32_t)(8 + payload));
+  head.fourcc("mdat");
+  fwrite(head.buf.data(), 1, head.buf.size(), f);
+
+  std::vector<uint8_t> data;
+
+  for (const fake_packet &pkt : packets) {
+    data.resize(pkt.size);
+
+    for (uint32_t i = 0; i < pkt.size; i++)
+      data[i] = (uint8_t)(pkt.pts * 31 + i);
+
+    fwrite(data.data(), 1, data.size(), f);
+  }
+
+  uint32_t duration_ms = (uint32_t)((last_usec - first_usec) / 1000);
+
+  box_writer tail;
+  size_t moov = tail.begin("moov");
+
+  size_t mvhd = tail.begin_full("mvhd", 0, 0);
+  tail.u32(0);
+  tail.u32(0);
+  tail.u32(1000); // Timescale, milliseconds.
+  tail.u32(duration_ms);
+  tail.u32(0x00010000); // Rate 1.0.
+  tail.u16(0x0100); // Volume 1.0.
+  tail.zeros(10);
+  tail.matrix();
+  tail.zeros(24);
+  tail.u32((uint32_t)(2 + (audio_tracks.empty() ? 0 : *audio_tracks.rbegin()) + 1)); // Next track ID.
+  tail.end(mvhd);
+
+  write_trak(tail, 1, true, ovi.fps_num, video_frames * ovi.fps_den, duration_ms, ovi);
+
+  for (size_t track : audio_tracks) {
+    uint32_t rate = fake::audio_info().samples_per_sec;
+    write_trak(tail, (uint32_t)(2 + track), false, rate, (uint64_t)duration_ms * rate / 1000, duration_ms, ovi);
+  }
+
+  tail.end(moov);
+  fwrite(tail.buf.data(), 1, tail.buf.size(), f);
+
+  bool ok = ferror(f) == 0;
+  fclose(f);
+  return ok;
+}
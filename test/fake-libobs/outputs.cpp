@@ -0,0 +1,737 @@
+#include "fake-libobs.h"
+#include <media-io/audio-io.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#define AUDIO_FRAME_SAMPLES 1024
+
+struct encoder_type {
+  const char *id;
+  const char *display_name;
+  obs_encoder_type type;
+  long long default_bitrate; // kbps
+};
+
+static const encoder_type encoder_types[] = {
+  { "obs_x264", "x264", OBS_ENCODER_VIDEO, 2500 },
+  { "ffmpeg_aac", "FFmpeg AAC", OBS_ENCODER_AUDIO, 128 },
+  { "ffmpeg_opus", "FFmpeg Opus", OBS_ENCODER_AUDIO, 128 },
+};
+
+static const char *output_types[] = {
+  "ffmpeg_muxer",
+  "replay_buffer",
+};
+
+static const encoder_type *find_encoder_type(const char *id) {
+  for (const auto &type : encoder_types) {
+    if (strcmp(type.id, id) == 0)
+      return &type;
+  }
+
+  return nullptr;
+}
+
+static std::vector<obs_encoder_t*> encoders;
+
+std::vector<obs_output_t*> &fake::outputs() {
+  static std::vector<obs_output_t*> list;
+  return list;
+}
+
+bool obs_enum_encoder_types(size_t idx, const char **id) {
+  if (idx >= sizeof(encoder_types) / sizeof(encoder_types[0]))
+    return false;
+
+  *id = encoder_types[idx].id;
+  return true;
+}
+
+bool obs_enum_output_types(size_t idx, const char **id) {
+  if (idx >= sizeof(output_types) / sizeof(output_types[0]))
+    return false;
+
+  *id = output_types[idx];
+  return true;
+}
+
+const char *obs_encoder_get_display_name(const char *id) {
+  const encoder_type *type = find_encoder_type(id);
+  return type ? type->display_name : nullptr;
+}
+
+enum obs_encoder_type obs_get_encoder_type(const char *id) {
+  const encoder_type *type = find_encoder_type(id);
+  return type ? type->type : OBS_ENCODER_AUDIO;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Encoders */
+
+static obs_encoder_t *create_encoder(const char *id, const char *name, obs_data_t *settings, obs_encoder_type want) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  const encoder_type *type = find_encoder_type(id);
+
+  if (!type || type->type != want) {
+    blog(LOG_ERROR, "Encoder ID '%s' not found", id);
+    return nullptr;
+  }
+
+  obs_encoder_t *encoder = new obs_encoder;
+  encoder->id = id;
+  encoder->name = name ? name : "";
+  encoder->type = type->type;
+  encoder->settings = obs_data_create();
+  obs_data_set_default_int(encoder->settings, "bitrate", type->default_bitrate);
+  obs_data_apply(encoder->settings, settings);
+
+  encoders.push_back(encoder);
+  return encoder;
+}
+
+obs_encoder_t *obs_video_encoder_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data) {
+  return create_encoder(id, name, settings, OBS_ENCODER_VIDEO);
+}
+
+obs_encoder_t *obs_audio_encoder_create(const char *id, const char *name, obs_data_t *settings, size_t mixer_idx, obs_data_t *hotkey_data) {
+  obs_encoder_t *encoder = create_encoder(id, name, settings, OBS_ENCODER_AUDIO);
+
+  if (encoder)
+    encoder->mixer_idx = mixer_idx;
+
+  return encoder;
+}
+
+void obs_encoder_release(obs_encoder_t *encoder) {
+  if (!encoder)
+    return;
+
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (--encoder->refs > 0)
+    return;
+
+  // Outputs don't hold a reference, so forget the encoder everywhere.
+  for (obs_output_t *output : fake::outputs()) {
+    if (output->video_encoder == encoder)
+      output->video_encoder = nullptr;
+
+    for (auto &slot : output->audio_encoders) {
+      if (slot == encoder)
+        slot = nullptr;
+    }
+  }
+
+  encoders.erase(std::remove(encoders.begin(), encoders.end(), encoder), encoders.end());
+  obs_data_release(encoder->settings);
+  delete encoder;
+}
+
+const char *obs_encoder_get_id(const obs_encoder_t *encoder) {
+  return encoder ? encoder->id.c_str() : nullptr;
+}
+
+const char *obs_encoder_get_name(const obs_encoder_t *encoder) {
+  return encoder ? encoder->name.c_str() : nullptr;
+}
+
+obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder) {
+  obs_data_addref(encoder->settings);
+  return encoder->settings;
+}
+
+void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  obs_data_apply(encoder->settings, settings);
+}
+
+bool obs_encoder_active(const obs_encoder_t *encoder) {
+  return encoder && encoder->active > 0;
+}
+
+void obs_encoder_set_video(obs_encoder_t *encoder, video_t *video) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (encoder->active) {
+    blog(LOG_WARNING, "encoder '%s': cannot set video while active", encoder->name.c_str());
+    return;
+  }
+
+  encoder->video = video;
+}
+
+void obs_encoder_set_audio(obs_encoder_t *encoder, audio_t *audio) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (encoder->active) {
+    blog(LOG_WARNING, "encoder '%s': cannot set audio while active", encoder->name.c_str());
+    return;
+  }
+
+  encoder->audio = audio;
+}
+
+void obs_encoder_set_scaled_size(obs_encoder_t *encoder, uint32_t width, uint32_t height) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  encoder->scaled_width = width;
+  encoder->scaled_height = height;
+}
+
+void obs_encoder_set_gpu_scale_type(obs_encoder_t *encoder, enum obs_scale_type gpu_scale_type) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  encoder->gpu_scale_type = gpu_scale_type;
+}
+
+static void activate_encoder(obs_encoder_t *encoder) {
+  if (encoder && encoder->active++ == 0) {
+    encoder->frame = 0;
+    encoder->ticks = 0;
+  }
+}
+
+static void deactivate_encoder(obs_encoder_t *encoder) {
+  if (encoder && encoder->active > 0)
+    encoder->active--;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Outputs */
+
+static size_t count_mixers(size_t mixers) {
+  size_t count = 0;
+
+  for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+    if (mixers & ((size_t)1 << i))
+      count++;
+  }
+
+  return count;
+}
+
+static std::string format_filename(const std::string &format) {
+  time_t now = time(nullptr);
+  struct tm tm = *localtime(&now);
+  char buf[16];
+  std::string out;
+
+  for (size_t i = 0; i < format.size(); i++) {
+    auto match = [&](const char *token) {
+      return format.compare(i, strlen(token), token) == 0;
+    };
+
+    if (match("%CCYY")) {
+      snprintf(buf, sizeof(buf), "%04d", tm.tm_year + 1900);
+      i += 4;
+    } else if (match("%MM")) {
+      snprintf(buf, sizeof(buf), "%02d", tm.tm_mon + 1);
+      i += 2;
+    } else if (match("%DD")) {
+      snprintf(buf, sizeof(buf), "%02d", tm.tm_mday);
+      i += 2;
+    } else if (match("%hh")) {
+      snprintf(buf, sizeof(buf), "%02d", tm.tm_hour);
+      i += 2;
+    } else if (match("%mm")) {
+      snprintf(buf, sizeof(buf), "%02d", tm.tm_min);
+      i += 2;
+    } else if (match("%ss")) {
+      snprintf(buf, sizeof(buf), "%02d", tm.tm_sec);
+      i += 2;
+    } else {
+      buf[0] = format[i];
+      buf[1] = 0;
+    }
+
+    out += buf;
+  }
+
+  return out;
+}
+
+// Drop everything before the newest video keyframe at or before the cutoff,
+// so what is kept always starts on a keyframe.
+static void trim_to_keyframe(std::vector<fake_packet> &packets, int64_t cutoff_usec) {
+  size_t start = SIZE_MAX;
+
+  for (size_t i = 0; i < packets.size(); i++) {
+    const fake_packet &pkt = packets[i];
+
+    if (!pkt.video || !pkt.keyframe)
+      continue;
+
+    if (pkt.dts_usec > cutoff_usec && start != SIZE_MAX)
+      break;
+
+    start = i;
+  }
+
+  if (start == SIZE_MAX || start == 0)
+    return;
+
+  // Audio from just before the keyframe would start ahead of the video.
+  int64_t keyframe_usec = packets[start].dts_usec;
+  packets.erase(packets.begin(), packets.begin() + start);
+  packets.erase(std::remove_if(packets.begin(), packets.end(), [&](const fake_packet &pkt) {
+    return !pkt.video && pkt.dts_usec < keyframe_usec;
+  }), packets.end());
+}
+
+static void replay_convert(void *data, calldata_t *cd) {
+  obs_output_t *output = static_cast<obs_output_t*>(data);
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!output->active || output->stopping) {
+    blog(LOG_WARNING, "replay_buffer: convert called while not buffering");
+    return;
+  }
+
+  if (output->recording) {
+    blog(LOG_WARNING, "replay_buffer: already recording");
+    return;
+  }
+
+  long long offset = calldata_int(cd, "offset_seconds");
+  int64_t newest = output->packets.empty() ? 0 : output->packets.back().dts_usec;
+  trim_to_keyframe(output->packets, newest - offset * 1000000LL);
+
+  std::string dir = obs_data_get_string(output->settings, "directory");
+  std::string name = format_filename(obs_data_get_string(output->settings, "format"));
+  std::string ext = obs_data_get_string(output->settings, "extension");
+
+  if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+    dir += '/';
+
+  output->path = dir + name + "." + (ext.empty() ? "mp4" : ext);
+  output->recording = true;
+}
+
+static void replay_get_last(void *data, calldata_t *cd) {
+  obs_output_t *output = static_cast<obs_output_t*>(data);
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  calldata_set_string(cd, "path", output->last_path.c_str());
+}
+
+obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  bool known = false;
+
+  for (const char *type : output_types)
+    known = known || strcmp(type, id) == 0;
+
+  if (!known) {
+    blog(LOG_ERROR, "Output ID '%s' not found", id);
+    return nullptr;
+  }
+
+  obs_output_t *output = new obs_output;
+  output->id = id;
+  output->name = name ? name : "";
+  output->settings = obs_data_create();
+  output->signals = signal_handler_create();
+  output->procs = proc_handler_create();
+  obs_data_apply(output->settings, settings);
+
+  if (output->id == "replay_buffer") {
+    proc_handler_add(output->procs, "void convert(in int offset_seconds)", replay_convert, output);
+    proc_handler_add(output->procs, "void get_last_replay(out string path)", replay_get_last, output);
+  }
+
+  fake::outputs().push_back(output);
+  return output;
+}
+
+// Write out whatever was recorded and mark the output stopped. Returns the
+// code for the "stop" signal.
+static long long finish_output(obs_output_t *output) {
+  long long code = OBS_OUTPUT_SUCCESS;
+
+  if (output->recording) {
+    if (fake::write_mp4(output->path, output->packets, fake::video_info())) {
+      output->last_path = output->path;
+    } else {
+      output->last_error = "Failed to write " + output->path;
+      code = OBS_OUTPUT_ERROR;
+    }
+  }
+
+  deactivate_encoder(output->video_encoder);
+
+  for (obs_encoder_t *encoder : output->audio_encoders)
+    deactivate_encoder(encoder);
+
+  output->packets.clear();
+  output->active = false;
+  output->stopping = false;
+  output->recording = false;
+  return code;
+}
+
+void obs_output_release(obs_output_t *output) {
+  if (!output)
+    return;
+
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (--output->refs > 0)
+    return;
+
+  if (output->active)
+    finish_output(output);
+
+  auto &list = fake::outputs();
+  list.erase(std::remove(list.begin(), list.end(), output), list.end());
+  obs_data_release(output->settings);
+  signal_handler_destroy(output->signals);
+  proc_handler_destroy(output->procs);
+  delete output;
+}
+
+void fake::queue_output_signal(deferred &calls, obs_output_t *output, const char *signal, long long code) {
+  output->refs++;
+
+  calls.push_back([output, signal, code]() {
+    calldata_t cd;
+    calldata_init(&cd);
+    calldata_set_ptr(&cd, "output", output);
+    calldata_set_int(&cd, "code", code);
+    signal_handler_signal(output->signals, signal, &cd);
+    calldata_free(&cd);
+    obs_output_release(output);
+  });
+}
+
+static void run(fake::deferred &calls) {
+  for (auto &call : calls)
+    call();
+}
+
+bool obs_output_start(obs_output_t *output) {
+  fake::deferred calls;
+
+  {
+    std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+    if (output->active) {
+      blog(LOG_WARNING, "output '%s': already active", output->name.c_str());
+      return false;
+    }
+
+    output->last_error.clear();
+
+    if (!output->video_encoder || !output->video_encoder->video) {
+      output->last_error = "No video encoder, or the encoder has no video";
+      blog(LOG_WARNING, "output '%s': %s", output->name.c_str(), output->last_error.c_str());
+      return false;
+    }
+
+    size_t tracks = count_mixers(output->mixers);
+
+    for (size_t i = 0; i < tracks; i++) {
+      obs_encoder_t *encoder = output->audio_encoders[i];
+
+      if (!encoder || !encoder->audio) {
+        output->last_error = "Missing audio encoder for track " + std::to_string(i + 1);
+        blog(LOG_WARNING, "output '%s': %s", output->name.c_str(), output->last_error.c_str());
+        return false;
+      }
+    }
+
+    if (output->id == "ffmpeg_muxer") {
+      output->path = obs_data_get_string(output->settings, "path");
+      FILE *f = fopen(output->path.c_str(), "wb");
+
+      if (!f) {
+        output->last_error = "Unable to open " + output->path;
+        blog(LOG_WARNING, "output '%s': %s", output->name.c_str(), output->last_error.c_str());
+        return false;
+      }
+
+      fclose(f);
+      output->recording = true;
+    }
+
+    activate_encoder(output->video_encoder);
+
+    for (size_t i = 0; i < tracks; i++)
+      activate_encoder(output->audio_encoders[i]);
+
+    output->active = true;
+    output->stopping = false;
+    output->packets.clear();
+
+    fake::queue_output_signal(calls, output, "starting", 0);
+    fake::queue_output_signal(calls, output, "start", 0);
+  }
+
+  run(calls);
+  return true;
+}
+
+void obs_output_stop(obs_output_t *output) {
+  fake::deferred calls;
+
+  {
+    std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+    if (!output->active || output->stopping)
+      return;
+
+    // Finished on the next frame, like libobs draining its encoders.
+    output->stopping = true;
+    fake::queue_output_signal(calls, output, "stopping", 0);
+  }
+
+  run(calls);
+}
+
+void obs_output_force_stop(obs_output_t *output) {
+  fake::deferred calls;
+
+  {
+    std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+    if (!output->active)
+      return;
+
+    long long code = finish_output(output);
+    fake::queue_output_signal(calls, output, "stop", code);
+  }
+
+  run(calls);
+}
+
+bool obs_output_active(const obs_output_t *output) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return output && output->active;
+}
+
+const char *obs_output_get_id(const obs_output_t *output) {
+  return output ? output->id.c_str() : nullptr;
+}
+
+const char *obs_output_get_name(const obs_output_t *output) {
+  return output ? output->name.c_str() : nullptr;
+}
+
+obs_data_t *obs_output_get_settings(const obs_output_t *output) {
+  obs_data_addref(output->settings);
+  return output->settings;
+}
+
+void obs_output_update(obs_output_t *output, obs_data_t *settings) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  obs_data_apply(output->settings, settings);
+}
+
+const char *obs_output_get_last_error(obs_output_t *output) {
+  return output->last_error.empty() ? nullptr : output->last_error.c_str();
+}
+
+signal_handler_t *obs_output_get_signal_handler(const obs_output_t *output) {
+  return output->signals;
+}
+
+proc_handler_t *obs_output_get_proc_handler(const obs_output_t *output) {
+  return output->procs;
+}
+
+void obs_output_set_video_encoder(obs_output_t *output, obs_encoder_t *encoder) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (output->active) {
+    blog(LOG_WARNING, "output '%s': cannot change encoders while active", output->name.c_str());
+    return;
+  }
+
+  output->video_encoder = encoder;
+}
+
+void obs_output_set_audio_encoder(obs_output_t *output, obs_encoder_t *encoder, size_t idx) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (output->active) {
+    blog(LOG_WARNING, "output '%s': cannot change encoders while active", output->name.c_str());
+    return;
+  }
+
+  if (idx < MAX_OUTPUT_AUDIO_ENCODERS)
+    output->audio_encoders[idx] = encoder;
+}
+
+obs_encoder_t *obs_output_get_video_encoder(const obs_output_t *output) {
+  return output->video_encoder;
+}
+
+obs_encoder_t *obs_output_get_audio_encoder(const obs_output_t *output, size_t idx) {
+  return idx < MAX_OUTPUT_AUDIO_ENCODERS ? output->audio_encoders[idx] : nullptr;
+}
+
+void obs_output_set_mixers(obs_output_t *output, size_t mixers) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  output->mixers = mixers;
+}
+
+size_t obs_output_get_mixers(const obs_output_t *output) {
+  return output->mixers;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Per frame encoding */
+
+static uint32_t packet_size(obs_encoder_t *encoder, double packets_per_sec, bool keyframe) {
+  long long kbps = obs_data_get_int(encoder->settings, "bitrate");
+  uint32_t size = (uint32_t)std::max(16.0, kbps * 1000.0 / 8.0 / packets_per_sec);
+  return keyframe ? size * 4 : size;
+}
+
+void fake::tick_outputs(uint64_t frame, deferred &calls) {
+  const obs_video_info &ovi = video_info();
+  const obs_audio_info &oai = audio_info();
+  double fps = (double)ovi.fps_num / (double)ovi.fps_den;
+  std::map<obs_encoder_t*, std::vector<fake_packet>> encoded;
+
+  // Each active encoder produces once per frame, however many outputs use it.
+  for (obs_encoder_t *encoder : encoders) {
+    if (!encoder->active)
+      continue;
+
+    std::vector<fake_packet> &pkts = encoded[encoder];
+    encoder->ticks++;
+
+    if (encoder->type == OBS_ENCODER_VIDEO) {
+      long long keyint_sec = obs_data_get_int(encoder->settings, "keyint_sec");
+      int64_t keyint = (int64_t)((keyint_sec > 0 ? keyint_sec : 2) * fps);
+      bool keyframe = encoder->frame % std::max<int64_t>(1, keyint) == 0;
+      int64_t usec = encoder->frame * 1000000LL * ovi.fps_den / ovi.fps_num;
+      pkts.push_back({ encoder->frame, usec, keyframe, true, 0, packet_size(encoder, fps, keyframe) });
+      encoder->frame++;
+    } else {
+      uint32_t rate = oai.samples_per_sec ? oai.samples_per_sec : 48000;
+      int64_t target = (int64_t)(encoder->ticks * (uint64_t)rate * ovi.fps_den / ovi.fps_num);
+      double pps = (double)rate / AUDIO_FRAME_SAMPLES;
+
+      while (encoder->frame + AUDIO_FRAME_SAMPLES <= target) {
+        int64_t usec = encoder->frame * 1000000LL / rate;
+        pkts.push_back({ encoder->frame, usec, true, false, 0, packet_size(encoder, pps, false) });
+        encoder->frame += AUDIO_FRAME_SAMPLES;
+      }
+    }
+  }
+
+  for (obs_output_t *output : outputs()) {
+    if (!output->active)
+      continue;
+
+    if (output->stopping) {
+      long long code = finish_output(output);
+      queue_output_signal(calls, output, "stop", code);
+      continue;
+    }
+
+    size_t first = output->packets.size();
+
+    for (fake_packet pkt : encoded[output->video_encoder])
+      output->packets.push_back(pkt);
+
+    for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+      obs_encoder_t *encoder = output->audio_encoders[i];
+
+      if (!encoder || !encoder->active)
+        continue;
+
+      for (fake_packet pkt : encoded[encoder]) {
+        pkt.track = i;
+        output->packets.push_back(pkt);
+      }
+    }
+
+    // Packet callbacks see each packet as it is interleaved, with the lock
+    // held, like libobs holds its packet callback mutex.
+    for (size_t i = first; i < output->packets.size() && !output->packet_callbacks.empty(); i++) {
+      const fake_packet &pkt = output->packets[i];
+      encoder_packet packet = {};
+      packet.size = pkt.size;
+      packet.pts = pkt.pts;
+      packet.dts = pkt.pts;
+      packet.dts_usec = pkt.dts_usec;
+      packet.keyframe = pkt.keyframe;
+      packet.type = pkt.video ? OBS_ENCODER_VIDEO : OBS_ENCODER_AUDIO;
+      packet.track_idx = pkt.track;
+
+      for (const auto &cb : output->packet_callbacks)
+        cb.first(output, &packet, nullptr, cb.second);
+    }
+
+    // The replay buffer only keeps a rolling window until it is converted.
+    if (output->id == "replay_buffer" && !output->recording && !output->packets.empty()) {
+      long long max_sec = obs_data_get_int(output->settings, "max_time_sec");
+      int64_t newest = output->packets.back().dts_usec;
+      trim_to_keyframe(output->packets, newest - max_sec * 1000000LL);
+    }
+  }
+}
+
+void obs_output_add_packet_callback(obs_output_t *output, fake_packet_callback packet_cb, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  output->packet_callbacks.push_back({ packet_cb, param });
+}
+
+void obs_output_remove_packet_callback(obs_output_t *output, fake_packet_callback packet_cb, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  auto &cbs = output->packet_callbacks;
+  cbs.erase(std::remove(cbs.begin(), cbs.end(), std::make_pair(packet_cb, param)), cbs.end());
+}
+
+void fake::release_all() {
+  // Anything still alive at shutdown was leaked by the caller, libobs
+  // frees it all the same.
+  while (!outputs().empty()) {
+    outputs().back()->refs = 1;
+    obs_output_release(outputs().back());
+  }
+
+  while (!encoders.empty()) {
+    encoders.back()->refs = 1;
+    obs_encoder_release(encoders.back());
+  }
+
+  while (!volmeters().empty())
+    obs_volmeter_destroy(volmeters().back());
+
+  // Drop references sources hold on each other first, so the forced
+  // releases below never free something still pointed to. Releasing can
+  // free sources, so rescan the list after each one.
+  auto release_children = []() {
+    for (obs_source_t *source : sources()) {
+      std::vector<obs_source_t*> children = source->filters;
+      source->filters.clear();
+
+      if (source->scene) {
+        for (obs_sceneitem_t *item : source->scene->items) {
+          children.push_back(item->source);
+          delete item;
+        }
+
+        source->scene->items.clear();
+      }
+
+      if (!children.empty()) {
+        for (obs_source_t *child : children)
+          obs_source_release(child);
+
+        return true;
+      }
+    }
+
+    return false;
+  };
+
+  while (release_children()) {}
+
+  while (!sources().empty()) {
+    sources().back()->refs = 1;
+    obs_source_release(sources().back());
+  }
+}
@@ -0,0 +1,626 @@
+#include "fake-libobs.h"
+#include <media-io/audio-io.h>
+#include <media-io/audio-math.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+struct source_type {
+  const char *id;
+  const char *display_name;
+  uint32_t output_flags;
+  uint32_t width, height; // Size once the source is producing frames.
+  bool delayed; // Game capture only reports a size once it has "hooked".
+};
+
+static const source_type source_types[] = {
+  { "monitor_capture", "Display Capture", OBS_SOURCE_VIDEO, 1920, 1080, false },
+  { "window_capture", "Window Capture", OBS_SOURCE_VIDEO, 1280, 720, false },
+  { "game_capture", "Game Capture", OBS_SOURCE_VIDEO, 1920, 1080, true },
+  { "image_source", "Image", OBS_SOURCE_VIDEO, 512, 512, false },
+  { "wasapi_input_capture", "Audio Input Capture", OBS_SOURCE_AUDIO, 0, 0, false },
+  { "wasapi_output_capture", "Audio Output Capture", OBS_SOURCE_AUDIO, 0, 0, false },
+  { "wasapi_process_output_capture", "Application Audio Capture", OBS_SOURCE_AUDIO, 0, 0, false },
+  { "noise_suppress_filter_v2", "Noise Suppression", OBS_SOURCE_AUDIO, 0, 0, false },
+  { "scene", "Scene", OBS_SOURCE_VIDEO, 0, 0, false },
+};
+
+static const source_type *find_source_type(const char *id) {
+  for (const auto &type : source_types) {
+    if (strcmp(type.id, id) == 0)
+      return &type;
+  }
+
+  return nullptr;
+}
+
+std::vector<obs_source_t*> &fake::sources() {
+  static std::vector<obs_source_t*> list;
+  return list;
+}
+
+std::vector<obs_volmeter_t*> &fake::volmeters() {
+  static std::vector<obs_volmeter_t*> list;
+  return list;
+}
+
+struct source_state {
+  uint64_t age = 0; // Frames since creation.
+  uint64_t audio_frames = 0; // Samples delivered to audio capture callbacks.
+};
+
+static std::map<obs_source_t*, source_state> source_states;
+
+bool obs_enum_source_types(size_t idx, const char **id) {
+  if (idx >= sizeof(source_types) / sizeof(source_types[0]))
+    return false;
+
+  *id = source_types[idx].id;
+  return true;
+}
+
+const char *obs_source_get_display_name(const char *id) {
+  const source_type *type = find_source_type(id);
+  return type ? type->display_name : nullptr;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Sources */
+
+static obs_source_t *find_source(const std::string &name) {
+  for (obs_source_t *source : fake::sources()) {
+    if (source->name == name)
+      return source;
+  }
+
+  return nullptr;
+}
+
+obs_source_t *obs_source_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  const source_type *type = find_source_type(id);
+
+  if (!type) {
+    blog(LOG_ERROR, "Source ID '%s' not found", id);
+    return nullptr;
+  }
+
+  // Names are unique, like libobs a duplicate gets a numeric suffix.
+  std::string unique = name ? name : "";
+
+  for (int i = 2; find_source(unique); i++)
+    unique = std::string(name) + " " + std::to_string(i);
+
+  obs_source_t *source = new obs_source;
+  source->id = id;
+  source->name = unique;
+  source->output_flags = type->output_flags;
+  source->mixers = 0x3F; // Every mixer, as in libobs.
+  source->width = type->delayed ? 0 : type->width;
+  source->height = type->delayed ? 0 : type->height;
+  source->settings = obs_data_create();
+  source->signals = signal_handler_create();
+  obs_data_apply(source->settings, settings);
+
+  fake::sources().push_back(source);
+  source_states[source] = {};
+  return source;
+}
+
+static void detach_from_scenes(obs_source_t *source);
+
+void obs_source_release(obs_source_t *source) {
+  if (!source)
+    return;
+
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (--source->refs > 0)
+    return;
+
+  auto &list = fake::sources();
+  list.erase(std::remove(list.begin(), list.end(), source), list.end());
+  source_states.erase(source);
+
+  for (obs_volmeter_t *volmeter : fake::volmeters()) {
+    if (volmeter->source == source)
+      volmeter->source = nullptr;
+  }
+
+  if (source->scene) {
+    for (obs_sceneitem_t *item : source->scene->items) {
+      obs_source_release(item->source);
+      delete item;
+    }
+
+    delete source->scene;
+  }
+
+  for (obs_source_t *filter : source->filters)
+    obs_source_release(filter);
+
+  obs_data_release(source->settings);
+  signal_handler_destroy(source->signals);
+  delete source;
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source) {
+  if (source)
+    source->refs++;
+
+  return source;
+}
+
+void obs_source_remove(obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!source || source->removed)
+    return;
+
+  source->removed = true;
+  detach_from_scenes(source);
+
+  // Removed sources no longer hold their name.
+  source->name += " (removed)";
+}
+
+bool obs_source_removed(const obs_source_t *source) {
+  return source->removed;
+}
+
+obs_source_t *obs_get_source_by_name(const char *name) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return obs_source_get_ref(find_source(name));
+}
+
+const char *obs_source_get_name(const obs_source_t *source) {
+  return source ? source->name.c_str() : nullptr;
+}
+
+const char *obs_source_get_id(const obs_source_t *source) {
+  return source ? source->id.c_str() : nullptr;
+}
+
+uint32_t obs_source_get_output_flags(const obs_source_t *source) {
+  return source ? source->output_flags : 0;
+}
+
+uint32_t obs_source_get_width(obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return source ? source->width : 0;
+}
+
+uint32_t obs_source_get_height(obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  return source ? source->height : 0;
+}
+
+uint32_t obs_source_get_flags(const obs_source_t *source) {
+  return source->flags;
+}
+
+void obs_source_set_flags(obs_source_t *source, uint32_t flags) {
+  source->flags = flags;
+}
+
+void obs_source_set_audio_mixers(obs_source_t *source, uint32_t mixers) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->mixers = mixers;
+}
+
+uint32_t obs_source_get_audio_mixers(const obs_source_t *source) {
+  return source->mixers;
+}
+
+void obs_source_set_muted(obs_source_t *source, bool muted) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->muted = muted;
+}
+
+bool obs_source_muted(const obs_source_t *source) {
+  return source->muted;
+}
+
+void obs_source_set_volume(obs_source_t *source, float volume) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->volume = volume;
+}
+
+float obs_source_get_volume(const obs_source_t *source) {
+  return source->volume;
+}
+
+obs_data_t *obs_source_get_settings(const obs_source_t *source) {
+  obs_data_addref(source->settings);
+  return source->settings;
+}
+
+void obs_source_update(obs_source_t *source, obs_data_t *settings) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  obs_data_apply(source->settings, settings);
+}
+
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source) {
+  return source ? source->signals : nullptr;
+}
+
+void obs_source_inc_showing(obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->showing++;
+}
+
+void obs_source_dec_showing(obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (source->showing > 0)
+    source->showing--;
+}
+
+bool obs_source_showing(const obs_source_t *source) {
+  return source->showing > 0;
+}
+
+static obs_properties_t *type_properties(const std::string &id) {
+  obs_properties_t *props = obs_properties_create();
+
+  auto string_list = [&](const char *name, const char *desc) {
+    return obs_properties_add_list(props, name, desc, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+  };
+
+  if (id == "monitor_capture") {
+    obs_property_t *p = string_list("monitor_id", "Display");
+    obs_property_list_add_string(p, "Fake Display 1: 1920x1080 @ 0,0 (Primary Monitor)", "\\\\?\\DISPLAY#FAKE#1");
+    obs_property_list_add_string(p, "Fake Display 2: 2560x1440 @ 1920,0", "\\\\?\\DISPLAY#FAKE#2");
+    obs_properties_add_bool(props, "capture_cursor", "Capture Cursor");
+  } else if (id == "window_capture" || id == "game_capture" || id == "wasapi_process_output_capture") {
+    obs_property_t *p = string_list("window", "Window");
+    obs_property_list_add_string(p, "[fake.exe]: Fake Game", "Fake Game:FakeWindowClass:fake.exe");
+    obs_property_list_add_string(p, "[notepad.exe]: Untitled - Notepad", "Untitled - Notepad:Notepad:notepad.exe");
+
+    if (id == "game_capture") {
+      obs_property_t *mode = string_list("capture_mode", "Mode");
+      obs_property_list_add_string(mode, "Capture any fullscreen application", "any_fullscreen");
+      obs_property_list_add_string(mode, "Capture specific window", "window");
+    }
+  } else if (id == "image_source") {
+    fake::add_property(props, "file", "Image File", OBS_PROPERTY_PATH);
+  } else if (id == "wasapi_input_capture" || id == "wasapi_output_capture") {
+    obs_property_t *p = string_list("device_id", "Device");
+    obs_property_list_add_string(p, "Default", "default");
+    obs_property_list_add_string(p, "Fake Device 1", "{fake-device-1}");
+    obs_property_list_add_string(p, "Fake Device 2", "{fake-device-2}");
+  } else if (id == "noise_suppress_filter_v2") {
+    obs_property_t *p = string_list("method", "Method");
+    obs_property_list_add_string(p, "Speex", "speex");
+    obs_property_list_add_string(p, "RNNoise", "rnnoise");
+  }
+
+  return props;
+}
+
+obs_properties_t *obs_source_properties(const obs_source_t *source) {
+  return type_properties(source->id);
+}
+
+obs_properties_t *obs_get_source_properties(const char *id) {
+  return find_source_type(id) ? type_properties(id) : nullptr;
+}
+
+obs_data_t *obs_get_source_defaults(const char *id) {
+  return find_source_type(id) ? obs_data_create() : nullptr;
+}
+
+void obs_source_filter_add(obs_source_t *source, obs_source_t *filter) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->filters.push_back(obs_source_get_ref(filter));
+}
+
+void obs_source_filter_remove(obs_source_t *source, obs_source_t *filter) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  auto &filters = source->filters;
+  auto it = std::find(filters.begin(), filters.end(), filter);
+
+  if (it != filters.end()) {
+    filters.erase(it);
+    obs_source_release(filter);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scenes */
+
+static std::vector<obs_scene_t*> all_scenes() {
+  std::vector<obs_scene_t*> scenes;
+
+  for (obs_source_t *source : fake::sources()) {
+    if (source->scene)
+      scenes.push_back(source->scene);
+  }
+
+  return scenes;
+}
+
+static void detach_from_scenes(obs_source_t *source) {
+  for (obs_scene_t *scene : all_scenes()) {
+    auto &items = scene->items;
+
+    for (auto it = items.begin(); it != items.end();) {
+      if ((*it)->source == source) {
+        obs_source_release(source);
+        delete *it;
+        it = items.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+obs_scene_t *obs_scene_create(const char *name) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  obs_source_t *source = obs_source_create("scene", name, nullptr, nullptr);
+  obs_scene_t *scene = new obs_scene{ source, {} };
+  source->scene = scene;
+
+  const obs_video_info &ovi = fake::video_info();
+  source->width = ovi.base_width;
+  source->height = ovi.base_height;
+  return scene;
+}
+
+void obs_scene_release(obs_scene_t *scene) {
+  if (scene)
+    obs_source_release(scene->source);
+}
+
+obs_source_t *obs_scene_get_source(const obs_scene_t *scene) {
+  return scene ? scene->source : nullptr;
+}
+
+obs_scene_t *obs_scene_from_source(const obs_source_t *source) {
+  return source ? source->scene : nullptr;
+}
+
+obs_sceneitem_t *obs_scene_add(obs_scene_t *scene, obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!scene || !source)
+    return nullptr;
+
+  obs_sceneitem_t *item = new obs_scene_item;
+  item->parent = scene;
+  item->source = obs_source_get_ref(source);
+  scene->items.push_back(item);
+  return item;
+}
+
+void obs_sceneitem_remove(obs_sceneitem_t *item) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  if (!item)
+    return;
+
+  auto &items = item->parent->items;
+  items.erase(std::remove(items.begin(), items.end(), item), items.end());
+  obs_source_release(item->source);
+  delete item;
+}
+
+obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+
+  for (obs_sceneitem_t *item : scene->items) {
+    if (item->source->name == name)
+      return item;
+  }
+
+  return nullptr;
+}
+
+void obs_scene_enum_items(obs_scene_t *scene, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param) {
+  if (!scene)
+    return;
+
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  std::vector<obs_sceneitem_t*> items = scene->items;
+
+  for (obs_sceneitem_t *item : items) {
+    if (!callback(scene, item, param))
+      break;
+  }
+}
+
+obs_source_t *obs_sceneitem_get_source(const obs_sceneitem_t *item) { return item->source; }
+void obs_sceneitem_get_pos(const obs_sceneitem_t *item, struct vec2 *pos) { *pos = item->pos; }
+void obs_sceneitem_set_pos(obs_sceneitem_t *item, const struct vec2 *pos) { item->pos = *pos; }
+void obs_sceneitem_get_scale(const obs_sceneitem_t *item, struct vec2 *scale) { *scale = item->scale; }
+void obs_sceneitem_set_scale(obs_sceneitem_t *item, const struct vec2 *scale) { item->scale = *scale; }
+void obs_sceneitem_get_crop(const obs_sceneitem_t *item, struct obs_sceneitem_crop *crop) { *crop = item->crop; }
+void obs_sceneitem_set_crop(obs_sceneitem_t *item, const struct obs_sceneitem_crop *crop) { item->crop = *crop; }
+bool obs_sceneitem_visible(const obs_sceneitem_t *item) { return item->visible; }
+bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible) { item->visible = visible; return true; }
+
+/* ------------------------------------------------------------------------- */
+/* Volume meters */
+
+obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  obs_volmeter_t *volmeter = new obs_volmeter;
+  fake::volmeters().push_back(volmeter);
+  return volmeter;
+}
+
+void obs_volmeter_destroy(obs_volmeter_t *volmeter) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  auto &list = fake::volmeters();
+  list.erase(std::remove(list.begin(), list.end(), volmeter), list.end());
+  delete volmeter;
+}
+
+bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  volmeter->source = source;
+  return true;
+}
+
+void obs_volmeter_detach_source(obs_volmeter_t *volmeter) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  volmeter->source = nullptr;
+}
+
+void obs_volmeter_add_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  volmeter->callbacks.push_back({ callback, param });
+}
+
+void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  auto &cbs = volmeter->callbacks;
+
+  // Callers don't always pass the same param they added with, so match on
+  // the callback alone if there is no exact match.
+  auto it = std::find(cbs.begin(), cbs.end(), std::make_pair(callback, param));
+
+  if (it == cbs.end())
+    it = std::find_if(cbs.begin(), cbs.end(), [&](const auto &cb) { return cb.first == callback; });
+
+  if (it != cbs.end())
+    cbs.erase(it);
+}
+
+void obs_source_add_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  source->audio_captures.push_back({ callback, param });
+}
+
+void obs_source_remove_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param) {
+  std::lock_guard<std::recursive_mutex> guard(fake::lock());
+  auto &cbs = source->audio_captures;
+  cbs.erase(std::remove(cbs.begin(), cbs.end(), std::make_pair(callback, param)), cbs.end());
+}
+
+/* ------------------------------------------------------------------------- */
+/* Per frame updates */
+
+static uint32_t name_hash(const std::string &name) {
+  uint32_t hash = 2166136261u;
+
+  for (char c : name)
+    hash = (hash ^ (uint8_t)c) * 16777619u;
+
+  return hash;
+}
+
+// Slow sine per source so each meter is distinct but repeatable. Before the
+// source's volume and mute are applied.
+static float source_level(obs_source_t *source, double t) {
+  double phase = (name_hash(source->name) % 1000) / 1000.0 * 2.0 * M_PI;
+  return (float)(-30.0 + 12.0 * sin(2.0 * M_PI * t / 3.0 + phase));
+}
+
+void fake::tick_sources(uint64_t frame, deferred &calls) {
+  const obs_video_info &ovi = video_info();
+  uint64_t fps = std::max<uint64_t>(1, ovi.fps_num / std::max<uint32_t>(1, ovi.fps_den));
+
+  for (auto &entry : source_states) {
+    obs_source_t *source = entry.first;
+    const source_type *type = find_source_type(source->id.c_str());
+
+    // Game capture "hooks" a second after it is created.
+    if (type->delayed && ++entry.second.age == fps) {
+      source->width = type->width;
+      source->height = type->height;
+
+      obs_source_t *ref = obs_source_get_ref(source);
+
+      calls.push_back([ref]() {
+        calldata_t cd;
+        calldata_init(&cd);
+        calldata_set_ptr(&cd, "source", ref);
+        calldata_set_string(&cd, "title", "Fake Game");
+        calldata_set_string(&cd, "class", "FakeWindowClass");
+        calldata_set_string(&cd, "executable", "fake.exe");
+        signal_handler_signal(ref->signals, "hooked", &cd);
+        calldata_free(&cd);
+        obs_source_release(ref);
+      });
+    }
+
+    if (source->scene) {
+      source->width = ovi.base_width;
+      source->height = ovi.base_height;
+    }
+  }
+
+  // Meters update roughly every 50ms, like the libobs audio thread.
+  uint64_t interval = std::max<uint64_t>(1, fps / 20);
+
+  if (frame % interval != 0)
+    return;
+
+  uint32_t channels = get_audio_channels(audio_info().speakers);
+  double t = (double)frame / (double)fps;
+
+  for (obs_volmeter_t *volmeter : volmeters()) {
+    obs_source_t *source = volmeter->source;
+
+    if (!source || volmeter->callbacks.empty())
+      continue;
+
+    float level = -INFINITY;
+
+    if (!source->muted && source->volume > 0.0f)
+      level = source_level(source, t) + mul_to_db(source->volume);
+
+    std::vector<float> magnitude(MAX_AUDIO_CHANNELS, -INFINITY);
+    std::vector<float> peak(MAX_AUDIO_CHANNELS, -INFINITY);
+
+    for (uint32_t c = 0; c < channels && c < MAX_AUDIO_CHANNELS; c++) {
+      magnitude[c] = level - 3.0f;
+      peak[c] = level;
+    }
+
+    // Called with the lock held, as libobs holds the meter's callback mutex,
+    // so a callback can't be removed and freed while it is running.
+    for (const auto &cb : volmeter->callbacks)
+      cb.first(cb.second, magnitude.data(), peak.data(), peak.data());
+  }
+
+  // Audio capture callbacks get a 1 kHz tone at the same level, planar
+  // float like the libobs mix, covering the time since the last update.
+  uint32_t rate = audio_info().samples_per_sec;
+
+  for (auto &entry : source_states) {
+    obs_source_t *source = entry.first;
+
+    if (source->audio_captures.empty())
+      continue;
+
+    uint64_t end = (frame + interval) * rate / fps;
+    uint64_t span = rate * interval / fps;
+    uint64_t start = entry.second.audio_frames;
+
+    // New sources, and changes of frame rate, start with one update's worth.
+    if (start > end || end - start > 2 * span)
+      start = end - span;
+    uint32_t frames = (uint32_t)(end - start);
+    float amplitude = db_to_mul(source_level(source, t));
+
+    std::vector<float> samples(frames);
+
+    for (uint32_t i = 0; i < frames; i++)
+      samples[i] = amplitude * (float)sin(2.0 * M_PI * 1000.0 * (double)(start + i) / rate);
+
+    audio_data data = {};
+    data.frames = frames;
+    data.timestamp = start * 1000000000ULL / rate;
+
+    for (uint32_t c = 0; c < channels && c < MAX_AV_PLANES; c++)
+      data.data[c] = (uint8_t*)samples.data();
+
+    entry.second.audio_frames = end;
+
+    for (const auto &cb : source->audio_captures)
+      cb.first(cb.second, source, &data, source->muted);
+  }
+}
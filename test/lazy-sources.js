@@ -0,0 +1,47 @@
+const noobs = require('../index.js');
+const path = require('path');
+
+async function test() {
+  console.log('Starting obs...');
+
+  const cb = (msg) => {
+    console.log('Callback received:', msg);
+  };
+
+  const distPath = path.resolve(__dirname, '../dist');
+  const logPath = path.resolve(__dirname, '../logs');
+  const recordingPath = path.resolve(__dirname, '../recordings');
+
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
+  noobs.SetLazySources(true);
+
+  // Neither source exists in libobs yet, but both can be configured.
+  const game = noobs.CreateSource('Test Game', 'game_capture');
+  const monitor = noobs.CreateSource('Test Monitor', 'monitor_capture');
+  const props = noobs.GetSourceProperties(monitor);
+  noobs.SetSourceSettings(monitor, { ...noobs.GetSourceSettings(monitor), monitor_id: props[0].items[0].value });
+  console.log('Deferred settings:', noobs.GetSourceSettings(monitor));
+  console.log('Memory:', noobs.GetMemoryStats().registry);
+
+  // Created when added to the scene, with the settings from above.
+  noobs.AddSourceToScene(monitor);
+
+  // Created ahead of time, the log shows how long each creation took.
+  noobs.Prewarm(game);
+  console.log('Memory:', noobs.GetMemoryStats().registry);
+
+  noobs.StartRecording(0);
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+  noobs.AddSourceToScene(game);
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+  noobs.StopRecording();
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+
+  noobs.Shutdown();
+  console.log('Test Done');
+}
+
+console.log('Starting test...');
+test();
+console.log('Test now running async');
@@ -0,0 +1,55 @@
+const noobs = require('../index.js');
+const path = require('path');
+const fs = require('fs');
+
+async function test() {
+  console.log('Starting obs...');
+
+  const distPath = path.resolve(__dirname, '../dist');
+  const logPath = path.resolve(__dirname, '../logs');
+  const recordingPath = path.resolve(__dirname, '../recordings');
+
+  let stopped;
+  const stop = new Promise((resolve) => { stopped = resolve; });
+
+  const cb = (msg) => {
+    console.log('Callback received:', msg);
+
+    if (msg.type === 'output' && msg.id === 'stop')
+      stopped();
+  };
+
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
+  noobs.SetBuffering(true);
+  noobs.StartBuffer();
+  await new Promise((resolve) => setTimeout(resolve, 5000));
+
+  if (noobs.AddMarker('Too early') !== null) {
+    throw new Error('Marker accepted while only buffering');
+  }
+
+  // Markers are relative to the file, which reaches 3 seconds back.
+  noobs.StartRecording(3);
+  console.log('Boss pull at', noobs.AddMarker('Boss pull'));
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+  console.log('Death at', noobs.AddMarker('Death'));
+  noobs.StopRecording();
+  await stop;
+
+  const last = noobs.GetLastRecording();
+  const sidecar = last.replace(/\.mp4$/, '-markers.json');
+  const markers = JSON.parse(fs.readFileSync(sidecar, 'utf8'));
+  console.log('Sidecar:', markers);
+
+  if (markers.markers.length !== 2) {
+    throw new Error(`Expected 2 markers - ${markers.markers.length}`);
+  }
+
+  noobs.Shutdown();
+  console.log('Test Done');
+}
+
+console.log('Starting test...');
+test();
+console.log('Test now running async');
@@ -13,7 +13,8 @@ async function test() {
   console.log('Log path:', logPath);
   console.log('Recording path:', recordingPath);
 
-  noobs.Init(distPath, logPath, recordingPath, cb);
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
 
   // TODO - work out how to get a HWND to actually launch this. Maybe need some CPP code.
   // noobs.InitPreview(null); // Pass null for now, as we don't have a HWND yet.
@@ -21,6 +22,15 @@ async function test() {
   const s = noobs.GetPreviewInfo();
   console.log("info:", s);
 
+  // The frame preview needs no window so we can exercise it here.
+  noobs.StartFramePreview(320, 180, 2);
+  const pixels = new Uint8ClampedArray(320 * 180 * 4);
+  await new Promise((resolve) => setTimeout(resolve, 1000));
+  const seq = noobs.ReadFramePreview(pixels);
+  console.log("frame seq:", seq, "first pixel:", pixels.slice(0, 4));
+  console.log("unchanged seq:", noobs.ReadFramePreview(pixels, seq));
+  noobs.StopFramePreview();
+
   noobs.Shutdown();
   console.log('Test Done');
 }
@@ -0,0 +1,46 @@
+const noobs = require('../index.js');
+const path = require('path');
+
+async function test() {
+  console.log('Starting obs...');
+
+  const cb = (msg) => {
+    console.log('Callback received:', msg);
+  };
+
+  const distPath = path.resolve(__dirname, '../dist');
+  const logPath = path.resolve(__dirname, '../logs');
+  const recordingPath = path.resolve(__dirname, '../recordings');
+
+  console.log('Dist path:', distPath);
+  console.log('Log path:', logPath);
+  console.log('Recording path:', recordingPath);
+
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
+
+  noobs.CreateSource('Test Source', 'monitor_capture');
+  const settings = noobs.GetSourceSettings('Test Source');
+  const p = noobs.GetSourceProperties('Test Source');
+  noobs.SetSourceSettings('Test Source', { ...settings, monitor_id: p[1].items[1].value, method: 2 });
+  noobs.AddSourceToScene('Test Source');
+
+  // Proxy at a quarter of the 1080p canvas, the main file stays full size.
+  noobs.SetProxyEncoder('obs_x264', { rate_control: 'CRF', crf: 30, keyint_sec: 1 }, 480, 270);
+
+  noobs.StartRecording(0);
+  await new Promise((resolve) => setTimeout(resolve, 5000));
+  noobs.StopRecording();
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+
+  console.log('Last recording:', noobs.GetLastRecording());
+  console.log('Last proxy:', noobs.GetLastProxyRecording());
+
+  noobs.ClearProxyEncoder();
+  noobs.Shutdown();
+  console.log('Test Done');
+}
+
+console.log('Starting test...');
+test();
+console.log('Test now running async');
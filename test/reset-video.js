@@ -16,7 +16,8 @@ async function test() {
   console.log('Log path:', logPath);
   console.log('Recording path:', recordingPath);
 
-  noobs.Init(distPath, logPath, recordingPath, cb);
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
 
   noobs.CreateSource('Test Source', 'monitor_capture');
   const settings1 = noobs.GetSourceSettings('Test Source');
@@ -45,6 +46,15 @@ async function test() {
   noobs.StopRecording();
   await new Promise((resolve) => setTimeout(resolve, 2000));
   
+  // Capture at 3000x2000 but encode at 1500x1000 with lanczos, at 59.94fps.
+  console.log('Reconfigure to 59.94fps 3000x2000 scaled to 1500x1000');
+  noobs.ResetVideoContext(60000, 3000, 2000, { fpsDen: 1001, outputWidth: 1500, outputHeight: 1000, scaleType: 'lanczos' });
+
+  noobs.StartRecording(0);
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+  noobs.StopRecording();
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+
   noobs.Shutdown();
   console.log('Test Done');
 }
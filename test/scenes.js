@@ -0,0 +1,58 @@
+const noobs = require('../index.js');
+const path = require('path');
+
+async function test() {
+  console.log('Starting obs...');
+
+  const cb = (msg) => {
+    if (msg.type !== 'volmeter') {
+      console.log('Callback received:', msg);
+    }
+  };
+
+  const distPath = path.resolve(__dirname, '../dist');
+  const logPath = path.resolve(__dirname, '../logs');
+  const recordingPath = path.resolve(__dirname, '../recordings');
+
+  noobs.Init(distPath, logPath, cb);
+  noobs.SetRecordingDir(recordingPath);
+
+  // The base scene shows the whole monitor.
+  noobs.CreateSource('Test Monitor', 'monitor_capture');
+  noobs.AddSourceToScene('Test Monitor');
+
+  // A second layout with the monitor shrunk into a corner.
+  noobs.CreateScene('Test Layout');
+  noobs.SelectScene('Test Layout');
+  noobs.AddSourceToScene('Test Monitor');
+  noobs.SetSourcePos('Test Monitor', { x: 100, y: 100, scaleX: 0.5, scaleY: 0.5, cropLeft: 0, cropRight: 0, cropTop: 0, cropBottom: 0 });
+  noobs.SelectScene('Base Scene');
+
+  console.log('Scenes:', noobs.ListScenes());
+
+  // Switch every second while recording, the file should show both
+  // layouts with no gap or freeze at the switches.
+  noobs.StartRecording(0);
+
+  for (let i = 0; i < 6; i++) {
+    await new Promise((resolve) => setTimeout(resolve, 1000));
+    noobs.SelectScene(i % 2 ? 'Base Scene' : 'Test Layout');
+    console.log('Current scene:', noobs.GetCurrentScene());
+  }
+
+  // Deleting the selected scene falls back to the base scene.
+  noobs.SelectScene('Test Layout');
+  noobs.DeleteScene('Test Layout');
+  console.log('After delete:', noobs.ListScenes(), noobs.GetCurrentScene());
+  await new Promise((resolve) => setTimeout(resolve, 1000));
+
+  noobs.StopRecording();
+  await new Promise((resolve) => setTimeout(resolve, 2000));
+
+  noobs.Shutdown();
+  console.log('Test Done');
+}
+
+console.log('Starting test...');
+test();
+console.log('Test now running async');
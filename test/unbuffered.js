@@ -45,6 +45,9 @@ async function test() {
   console.log('Adding source to scene...');
   noobs.AddSourceToScene('Test Source');
 
+  // Poster frames every 2 seconds, plus one at the start.
+  noobs.SetSnapshotInterval(2);
+
   const recordingNames = new Set();
   for (let i = 0; i < 2; i++) {
     // Start the recording, with 1s offset into the past.
@@ -70,6 +73,12 @@ async function test() {
     if (last.endsWith('noobs.mp4')) {
       throw new Error(`Last recording name not correct - ${last}`);
     }
+
+    const snapshots = noobs.GetLastSnapshots();
+    console.log('Snapshots:', snapshots);
+    if (snapshots.length < 2) {
+      throw new Error(`Expected at least 2 snapshots, got ${snapshots.length}`);
+    }
   }
 
   console.log('Stopping obs...');